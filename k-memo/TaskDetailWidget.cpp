@@ -286,6 +286,13 @@ void TaskDetailWidget::onStatusChanged()
 {
     if (m_hasValidTask) {
         TaskStatus newStatus = static_cast<TaskStatus>(m_statusCombo->currentData().toInt());
+        if (newStatus != m_currentTask.status() && !m_currentTask.isValidTransition(newStatus)) {
+            // 不允许的状态转换，恢复原来的选项
+            m_statusCombo->blockSignals(true);
+            m_statusCombo->setCurrentIndex(static_cast<int>(m_currentTask.status()));
+            m_statusCombo->blockSignals(false);
+            return;
+        }
         m_currentTask.setStatus(newStatus);
         emit taskUpdated(m_currentTask);
         updateTaskDisplay();
@@ -298,4 +305,4 @@ void TaskDetailWidget::onDescriptionChanged()
         m_currentTask.setDescription(m_descriptionEdit->toPlainText());
         emit taskUpdated(m_currentTask);
     }
-}
\ No newline at end of file
+}
@@ -208,7 +208,7 @@ void TaskStatsWidget::setTaskModel(TaskModel* model)
     m_taskModel = model;
 
     if (m_taskModel) {
-        connect(m_taskModel, &TaskModel::taskCountChanged, this, &TaskStatsWidget::onTaskModelChanged);
+        connect(m_taskModel, &TaskModel::facetsChanged, this, &TaskStatsWidget::onFacetsChanged);
         refreshStats();
         m_refreshTimer->start();
     } else {
@@ -232,6 +232,17 @@ void TaskStatsWidget::onTaskModelChanged()
     refreshStats();
 }
 
+void TaskStatsWidget::onFacetsChanged(TaskModel::Facets changed)
+{
+    if (changed & (TaskModel::StatusFacet | TaskModel::OverdueFacet)) {
+        updateStatistics();
+        updateProgressBars();
+    }
+    if (changed & TaskModel::CategoryFacet) {
+        updateCategoriesDisplay();
+    }
+}
+
 void TaskStatsWidget::onShowAllClicked()
 {
     emit showAllTasksRequested();
@@ -270,32 +281,12 @@ void TaskStatsWidget::updateStatistics()
         return;
     }
 
-    auto tasks = m_taskModel->getAllTasks();
-    m_totalTasks = tasks.size();
-    m_completedTasks = 0;
-    m_pendingTasks = 0;
-    m_inProgressTasks = 0;
-    m_overdueTasks = 0;
-
-    for (const auto& task : tasks) {
-        switch (task.status()) {
-            case TaskStatus::Completed:
-                m_completedTasks++;
-                break;
-            case TaskStatus::Pending:
-                m_pendingTasks++;
-                break;
-            case TaskStatus::InProgress:
-                m_inProgressTasks++;
-                break;
-            case TaskStatus::Cancelled:
-                break;
-        }
-
-        if (task.isOverdue()) {
-            m_overdueTasks++;
-        }
-    }
+    // Counters maintained by the model
+    m_totalTasks = m_taskModel->getTaskCount();
+    m_completedTasks = m_taskModel->countByStatus(TaskStatus::Completed);
+    m_pendingTasks = m_taskModel->countByStatus(TaskStatus::Pending);
+    m_inProgressTasks = m_taskModel->countByStatus(TaskStatus::InProgress);
+    m_overdueTasks = m_taskModel->overdueCount();
 
     // Update labels
     m_totalTasksLabel->setText(QString::number(m_totalTasks));
@@ -374,13 +365,11 @@ void TaskStatsWidget::updateCategoriesDisplay()
         delete item;
     }
 
-    // Get all categories from tasks
+    // Category counts come from the model; QMap orders them by name
     QMap<QString, int> categoryCounts;
-    auto tasks = m_taskModel->getAllTasks();
-
-    for (const auto& task : tasks) {
-        QString category = task.category().isEmpty() ? "未分类" : task.category();
-        categoryCounts[category]++;
+    const QHash<QString, int>& counts = m_taskModel->categoryCounts();
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        categoryCounts[it.key().isEmpty() ? "未分类" : it.key()] += it.value();
     }
 
     // Create category buttons
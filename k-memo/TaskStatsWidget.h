@@ -10,10 +10,9 @@
 #include <QFrame>
 #include <QTimer>
 #include "models/task.h"
+#include "models/taskmodel.h"
 
 
-class TaskModel;
-
 class TaskStatsWidget : public QWidget
 {
     Q_OBJECT
@@ -26,6 +25,7 @@ public:
 
 public slots:
     void onTaskModelChanged();
+    void onFacetsChanged(TaskModel::Facets changed);
 
 signals:
     void filterRequested(const QString& category, TaskStatus status);
@@ -0,0 +1,433 @@
+#include "attachmentstore.h"
+#include "databasemanager.h"
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QVariant>
+#include <QDebug>
+#include <sqlite3.h>
+#include <limits>
+
+AttachmentStore::AttachmentStore(DatabaseManager* manager, const QSqlDatabase& database, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_database(database)
+    , m_blobIo(BlobIoUnknown)
+{
+}
+
+sqlite3* AttachmentStore::nativeHandle() const
+{
+    if (m_blobIo == BlobIoSql) {
+        return nullptr;
+    }
+
+    sqlite3* db = nullptr;
+    QVariant handle = m_database.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0) {
+        db = *static_cast<sqlite3**>(handle.data());
+    }
+
+    if (m_blobIo == BlobIoUnknown) {
+        m_blobIo = db && sharesSqliteLibrary() ? BlobIoNative : BlobIoSql;
+        if (m_blobIo == BlobIoSql) {
+            qWarning() << "QSQLITE uses its own SQLite library; attachments are streamed through SQL";
+        }
+    }
+    return m_blobIo == BlobIoNative ? db : nullptr;
+}
+
+bool AttachmentStore::sharesSqliteLibrary() const
+{
+    // Different builds give themselves away by version and source id
+    QSqlQuery query(m_database);
+    if (!query.exec("SELECT sqlite_version(), sqlite_source_id()") || !query.next()
+        || query.value(0).toString() != QLatin1String(sqlite3_libversion())
+        || query.value(1).toString() != QLatin1String(sqlite3_sourceid())) {
+        return false;
+    }
+
+    // Two copies of the same build don't; they do keep separate globals.
+    // The soft heap limit is one, settable from SQL and readable here.
+    const sqlite3_int64 limit = sqlite3_soft_heap_limit64(-1);
+    const sqlite3_int64 probe = limit + 4096;
+    if (!query.exec(QString("PRAGMA soft_heap_limit = %1").arg(probe))) {
+        return false;
+    }
+    const bool shared = sqlite3_soft_heap_limit64(-1) == probe;
+    query.exec(QString("PRAGMA soft_heap_limit = %1").arg(limit));
+    sqlite3_soft_heap_limit64(limit);
+    return shared;
+}
+
+QList<TaskAttachment> AttachmentStore::attachmentsForTask(const TaskId& taskId)
+{
+    QList<TaskAttachment> attachments;
+
+    if (taskId.isNull()) {
+        return attachments;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(R"(
+        SELECT id, task_id, file_name, mime_type, size, create_time
+        FROM task_attachments
+        WHERE task_id = ?
+        ORDER BY create_time ASC, id ASC
+    )");
+    query.addBindValue(taskId.toRfc4122());
+
+    if (!query.exec()) {
+        qWarning() << "Failed to get attachments:" << query.lastError().text();
+        return attachments;
+    }
+
+    while (query.next()) {
+        TaskAttachment attachment;
+        attachment.id = query.value("id").toLongLong();
+        attachment.taskId = TaskId::fromRfc4122(query.value("task_id").toByteArray());
+        attachment.fileName = query.value("file_name").toString();
+        attachment.mimeType = query.value("mime_type").toString();
+        attachment.size = query.value("size").toLongLong();
+        attachment.createTime = query.value("create_time").toDateTime();
+        attachments.append(attachment);
+    }
+
+    return attachments;
+}
+
+int AttachmentStore::attachmentCount(const TaskId& taskId)
+{
+    if (taskId.isNull()) {
+        return 0;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("SELECT COUNT(*) FROM task_attachments WHERE task_id = ?");
+    query.addBindValue(taskId.toRfc4122());
+
+    if (query.exec() && query.next()) {
+        return query.value(0).toInt();
+    }
+
+    return 0;
+}
+
+qint64 AttachmentStore::attachmentBytes(const TaskId& taskId)
+{
+    if (taskId.isNull()) {
+        return 0;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("SELECT TOTAL(size) FROM task_attachments WHERE task_id = ?");
+    query.addBindValue(taskId.toRfc4122());
+
+    if (query.exec() && query.next()) {
+        return query.value(0).toLongLong();
+    }
+
+    return 0;
+}
+
+qint64 AttachmentStore::addAttachment(const TaskId& taskId, const QString& fileName,
+                                      const QString& mimeType, QIODevice* source)
+{
+    TaskAttachment attachment;
+    attachment.taskId = taskId;
+    attachment.fileName = fileName;
+    attachment.mimeType = mimeType;
+    return insertAttachment(attachment, source);
+}
+
+bool AttachmentStore::restoreAttachment(const TaskAttachment& attachment, QIODevice* source)
+{
+    if (attachment.id < 0 || !attachment.createTime.isValid()) {
+        return false;
+    }
+    return insertAttachment(attachment, source) == attachment.id;
+}
+
+// A new attachment when attachment.id is -1; otherwise that id and
+// createTime are kept
+qint64 AttachmentStore::insertAttachment(const TaskAttachment& attachment, QIODevice* source)
+{
+    const TaskId& taskId = attachment.taskId;
+    if (taskId.isNull() || attachment.fileName.isEmpty() || !source || !source->isReadable()) {
+        return -1;
+    }
+
+    // zeroblob() needs the final size up front
+    if (source->isSequential()) {
+        qWarning() << "Cannot add attachment from a sequential device";
+        return -1;
+    }
+
+    qint64 size = source->size() - source->pos();
+    if (size < 0 || size > std::numeric_limits<int>::max()) {
+        qWarning() << "Attachment size not supported:" << size;
+        return -1;
+    }
+
+    // Without blob I/O the content is bound whole, so it has to fit in memory
+    const bool blobIo = nativeHandle() != nullptr;
+    if (!blobIo && size > SQL_MAX_ATTACHMENT_SIZE) {
+        qWarning() << "Attachment too large without SQLite blob I/O:" << size;
+        return -1;
+    }
+
+    // Nests inside a caller's transaction
+    if (!m_manager->beginTransaction()) {
+        return -1;
+    }
+
+    QSqlQuery query(m_database);
+    if (attachment.id < 0) {
+        query.prepare(R"(
+            INSERT INTO task_attachments (task_id, file_name, mime_type, size)
+            VALUES (?, ?, ?, ?)
+        )");
+    } else {
+        query.prepare(R"(
+            INSERT INTO task_attachments (id, task_id, file_name, mime_type, size, create_time)
+            VALUES (?, ?, ?, ?, ?, ?)
+        )");
+        query.addBindValue(attachment.id);
+    }
+    query.addBindValue(taskId.toRfc4122());
+    query.addBindValue(attachment.fileName);
+    query.addBindValue(attachment.mimeType);
+    query.addBindValue(size);
+    if (attachment.id >= 0) {
+        // CURRENT_TIMESTAMP's format, so the listing order is unchanged
+        query.addBindValue(attachment.createTime.toString(QStringLiteral("yyyy-MM-dd HH:mm:ss")));
+    }
+
+    if (!query.exec()) {
+        qWarning() << "Failed to insert attachment:" << query.lastError().text();
+        m_manager->rollbackTransaction();
+        return -1;
+    }
+
+    qint64 attachmentId = query.lastInsertId().toLongLong();
+
+    // Reserve the space, then stream the content into it; without blob
+    // I/O the content goes in with the row, in one statement
+    QSqlQuery dataQuery(m_database);
+    dataQuery.prepare(blobIo ? "INSERT INTO attachment_data (attachment_id, data) VALUES (?, zeroblob(?))"
+                             : "INSERT INTO attachment_data (attachment_id, data) VALUES (?, ?)");
+    dataQuery.addBindValue(attachmentId);
+    if (blobIo) {
+        dataQuery.addBindValue(size);
+    } else {
+        const QByteArray content = source->read(size);
+        if (content.size() != size) {
+            qWarning() << "Attachment source ended early at" << content.size() << "of" << size;
+            m_manager->rollbackTransaction();
+            return -1;
+        }
+        dataQuery.addBindValue(content);
+    }
+
+    if (!dataQuery.exec() || (blobIo && !writeContent(attachmentId, source, size))) {
+        qWarning() << "Failed to store attachment content:" << dataQuery.lastError().text();
+        m_manager->rollbackTransaction();
+        return -1;
+    }
+
+    if (!m_manager->commitTransaction()) {
+        return -1;
+    }
+
+    emit attachmentsChanged(taskId);
+    return attachmentId;
+}
+
+qint64 AttachmentStore::addAttachmentFromFile(const TaskId& taskId, const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open attachment file:" << filePath << file.errorString();
+        return -1;
+    }
+
+    QFileInfo info(filePath);
+    QString mimeType = QMimeDatabase().mimeTypeForFile(info).name();
+
+    return addAttachment(taskId, info.fileName(), mimeType, &file);
+}
+
+bool AttachmentStore::writeContent(qint64 attachmentId, QIODevice* source, qint64 size)
+{
+    if (size == 0) {
+        return true;
+    }
+
+    sqlite3* db = nativeHandle();
+    if (!db) {
+        qWarning() << "SQLite handle not available for blob I/O";
+        return false;
+    }
+
+    sqlite3_blob* blob = nullptr;
+    if (sqlite3_blob_open(db, "main", "attachment_data", "data", attachmentId, 1, &blob) != SQLITE_OK) {
+        qWarning() << "Failed to open attachment blob:" << sqlite3_errmsg(db);
+        return false;
+    }
+
+    QByteArray buffer(CHUNK_SIZE, Qt::Uninitialized);
+    qint64 offset = 0;
+    bool ok = true;
+
+    while (offset < size) {
+        qint64 chunk = qMin<qint64>(CHUNK_SIZE, size - offset);
+        qint64 read = source->read(buffer.data(), chunk);
+        if (read <= 0) {
+            qWarning() << "Attachment source ended early at" << offset << "of" << size;
+            ok = false;
+            break;
+        }
+
+        if (sqlite3_blob_write(blob, buffer.constData(), static_cast<int>(read),
+                               static_cast<int>(offset)) != SQLITE_OK) {
+            qWarning() << "Failed to write attachment chunk:" << sqlite3_errmsg(db);
+            ok = false;
+            break;
+        }
+        offset += read;
+    }
+
+    sqlite3_blob_close(blob);
+    return ok;
+}
+
+bool AttachmentStore::readAttachment(qint64 attachmentId, QIODevice* sink)
+{
+    if (attachmentId < 0 || !sink || !sink->isWritable()) {
+        return false;
+    }
+
+    sqlite3* db = nativeHandle();
+    if (!db) {
+        return readContent(attachmentId, sink);
+    }
+
+    sqlite3_blob* blob = nullptr;
+    if (sqlite3_blob_open(db, "main", "attachment_data", "data", attachmentId, 0, &blob) != SQLITE_OK) {
+        qWarning() << "Failed to open attachment blob:" << sqlite3_errmsg(db);
+        return false;
+    }
+
+    const int size = sqlite3_blob_bytes(blob);
+    QByteArray buffer(CHUNK_SIZE, Qt::Uninitialized);
+    int offset = 0;
+    bool ok = true;
+
+    while (offset < size) {
+        int chunk = qMin(CHUNK_SIZE, size - offset);
+        if (sqlite3_blob_read(blob, buffer.data(), chunk, offset) != SQLITE_OK) {
+            qWarning() << "Failed to read attachment chunk:" << sqlite3_errmsg(db);
+            ok = false;
+            break;
+        }
+
+        if (sink->write(buffer.constData(), chunk) != chunk) {
+            qWarning() << "Failed to write attachment to sink:" << sink->errorString();
+            ok = false;
+            break;
+        }
+        offset += chunk;
+    }
+
+    sqlite3_blob_close(blob);
+    return ok;
+}
+
+bool AttachmentStore::readContent(qint64 attachmentId, QIODevice* sink)
+{
+    QSqlQuery sizeQuery(m_database);
+    sizeQuery.prepare("SELECT length(data) FROM attachment_data WHERE attachment_id = ?");
+    sizeQuery.addBindValue(attachmentId);
+    if (!sizeQuery.exec() || !sizeQuery.next()) {
+        qWarning() << "Failed to open attachment content:" << sizeQuery.lastError().text();
+        return false;
+    }
+    const qint64 size = sizeQuery.value(0).toLongLong();
+
+    // substr() counts blob bytes from 1
+    QSqlQuery query(m_database);
+    query.prepare("SELECT substr(data, ?, ?) FROM attachment_data WHERE attachment_id = ?");
+    qint64 offset = 0;
+    while (offset < size) {
+        const qint64 chunk = qMin<qint64>(SQL_CHUNK_SIZE, size - offset);
+        query.bindValue(0, offset + 1);
+        query.bindValue(1, chunk);
+        query.bindValue(2, attachmentId);
+        if (!query.exec() || !query.next()) {
+            qWarning() << "Failed to read attachment chunk:" << query.lastError().text();
+            return false;
+        }
+
+        const QByteArray buffer = query.value(0).toByteArray();
+        query.finish();
+        if (buffer.size() != chunk || sink->write(buffer) != chunk) {
+            qWarning() << "Failed to write attachment to sink:" << sink->errorString();
+            return false;
+        }
+        offset += chunk;
+    }
+    return true;
+}
+
+bool AttachmentStore::saveAttachmentToFile(qint64 attachmentId, const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open attachment destination:" << filePath << file.errorString();
+        return false;
+    }
+
+    if (!readAttachment(attachmentId, &file)) {
+        file.remove();
+        return false;
+    }
+
+    return true;
+}
+
+bool AttachmentStore::removeAttachment(qint64 attachmentId)
+{
+    TaskId taskId = taskIdForAttachment(attachmentId);
+    if (taskId.isNull()) {
+        return false;
+    }
+
+    // Content is removed by the ON DELETE CASCADE on attachment_data
+    QSqlQuery query(m_database);
+    query.prepare("DELETE FROM task_attachments WHERE id = ?");
+    query.addBindValue(attachmentId);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to remove attachment:" << query.lastError().text();
+        return false;
+    }
+
+    emit attachmentsChanged(taskId);
+    return true;
+}
+
+TaskId AttachmentStore::taskIdForAttachment(qint64 attachmentId)
+{
+    QSqlQuery query(m_database);
+    query.prepare("SELECT task_id FROM task_attachments WHERE id = ?");
+    query.addBindValue(attachmentId);
+
+    if (query.exec() && query.next()) {
+        return TaskId::fromRfc4122(query.value(0).toByteArray());
+    }
+
+    return TaskId();
+}
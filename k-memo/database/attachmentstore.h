@@ -0,0 +1,87 @@
+#ifndef ATTACHMENTSTORE_H
+#define ATTACHMENTSTORE_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QDateTime>
+#include <QList>
+#include "models/taskid.h"
+
+class QIODevice;
+class DatabaseManager;
+struct sqlite3;
+
+// Metadata for one attachment; the content itself is only ever streamed
+struct TaskAttachment {
+    qint64 id;
+    TaskId taskId;
+    QString fileName;
+    QString mimeType;
+    qint64 size;
+    QDateTime createTime;
+
+    TaskAttachment() : id(-1), size(0) {}
+};
+
+// Stores task attachments outside the tasks table. Content lives in its own
+// table and is written/read in fixed-size chunks through SQLite incremental
+// blob I/O, so neither side ever holds a whole file in memory.
+//
+// Blob I/O calls the SQLite library this program links on the QSQLITE
+// driver's connection, which is only sound when the driver uses that same
+// library. Official Qt builds bundle their own copy, so with a stock Qt the
+// store falls back to plain SQL, decided at run time: content is written
+// with one bound INSERT, which holds the file in memory and is refused past
+// SQL_MAX_ATTACHMENT_SIZE, and read back through substr() in chunks. Only a
+// Qt whose SQLite plugin is built with -system-sqlite gets streaming writes.
+class AttachmentStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    AttachmentStore(DatabaseManager* manager, const QSqlDatabase& database, QObject *parent = nullptr);
+
+    // Metadata only - never touches attachment content
+    QList<TaskAttachment> attachmentsForTask(const TaskId& taskId);
+    int attachmentCount(const TaskId& taskId);
+    qint64 attachmentBytes(const TaskId& taskId);
+
+    // Content streaming
+    qint64 addAttachment(const TaskId& taskId, const QString& fileName,
+                         const QString& mimeType, QIODevice* source);
+    qint64 addAttachmentFromFile(const TaskId& taskId, const QString& filePath);
+    // Puts back an attachment deleted with its task, under its old id and
+    // time; for undo
+    bool restoreAttachment(const TaskAttachment& attachment, QIODevice* source);
+    bool readAttachment(qint64 attachmentId, QIODevice* sink);
+    bool saveAttachmentToFile(qint64 attachmentId, const QString& filePath);
+    bool removeAttachment(qint64 attachmentId);
+
+signals:
+    void attachmentsChanged(const TaskId& taskId);
+
+private:
+    enum BlobIo {
+        BlobIoUnknown,
+        BlobIoNative,
+        BlobIoSql
+    };
+
+    sqlite3* nativeHandle() const;
+    bool sharesSqliteLibrary() const;
+    qint64 insertAttachment(const TaskAttachment& attachment, QIODevice* source);
+    bool writeContent(qint64 attachmentId, QIODevice* source, qint64 size);
+    bool readContent(qint64 attachmentId, QIODevice* sink);
+    TaskId taskIdForAttachment(qint64 attachmentId);
+
+    DatabaseManager* m_manager;
+    QSqlDatabase m_database;
+    mutable BlobIo m_blobIo;        // Decided on first use
+
+    static constexpr int CHUNK_SIZE = 64 * 1024;
+    static constexpr int SQL_CHUNK_SIZE = 4 * 1024 * 1024;
+    static constexpr qint64 SQL_MAX_ATTACHMENT_SIZE = 64 * 1024 * 1024;
+};
+
+#endif // ATTACHMENTSTORE_H
@@ -1,16 +1,100 @@
 #include "databasemanager.h"
+#include "integrityservice.h"
+#include "attachmentstore.h"
+#include "taskquery.h"
+#include "models/tasksorter.h"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QStandardPaths>
 #include <QDir>
 #include <QDebug>
+#include <QTimer>
 
-const int DatabaseManager::DATABASE_VERSION = 1;
+const int DatabaseManager::DATABASE_VERSION = 6;
 const QString DatabaseManager::DATABASE_NAME = "kmemo.db";
+const int DatabaseManager::DESCRIPTION_COMPRESSION_THRESHOLD = 1024;
 
 DatabaseManager* DatabaseManager::m_instance = nullptr;
 
+namespace {
+// Schemas of the tables keyed by task id, with the table name as %1 so the
+// id migration can build the new tables side by side with the old ones.
+// Task ids are 16-byte RFC 4122 blobs; WITHOUT ROWID stores each row once,
+// inside the primary key b-tree, instead of a rowid table plus a key index.
+const char TASKS_TABLE_SCHEMA[] = R"(
+    CREATE TABLE IF NOT EXISTS %1 (
+        id BLOB PRIMARY KEY NOT NULL,
+        title TEXT NOT NULL,
+        title_key TEXT NOT NULL DEFAULT '',
+        description TEXT,
+        create_time DATETIME DEFAULT CURRENT_TIMESTAMP,
+        due_time DATETIME,
+        priority INTEGER DEFAULT 2,
+        status INTEGER DEFAULT 0,
+        category TEXT DEFAULT 'default',
+        reminder_enabled BOOLEAN DEFAULT 0,
+        reminder_minutes INTEGER DEFAULT 15,
+        recurrence TEXT
+    ) WITHOUT ROWID
+)";
+
+const char TASK_TAGS_TABLE_SCHEMA[] = R"(
+    CREATE TABLE IF NOT EXISTS %1 (
+        task_id BLOB NOT NULL,
+        tag TEXT NOT NULL,
+        PRIMARY KEY(task_id, tag),
+        FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE
+    ) WITHOUT ROWID
+)";
+
+// Task hierarchy as a closure table: one row per (ancestor, descendant)
+// pair including each task with itself at depth 0. Keyed by ancestor and
+// depth, so a node's children and its whole subtree are both range scans;
+// the descendant index answers "who are my ancestors" the same way.
+const char TASK_CLOSURE_TABLE_SCHEMA[] = R"(
+    CREATE TABLE IF NOT EXISTS %1 (
+        ancestor BLOB NOT NULL,
+        depth INTEGER NOT NULL,
+        descendant BLOB NOT NULL,
+        PRIMARY KEY(ancestor, depth, descendant),
+        FOREIGN KEY(ancestor) REFERENCES tasks(id) ON DELETE CASCADE,
+        FOREIGN KEY(descendant) REFERENCES tasks(id) ON DELETE CASCADE
+    ) WITHOUT ROWID
+)";
+
+// Title order for SQL-side paging; see TaskSorter::titleSortKey()
+const char TITLE_KEY_INDEX[] =
+    "CREATE INDEX IF NOT EXISTS idx_tasks_title_key ON tasks(title_key, id)";
+
+// "Blocked by" edges: task_id can't be worked on until blocker_id is done.
+// addTaskDependency() refuses an edge that would close a cycle.
+const char TASK_DEPENDENCIES_TABLE_SCHEMA[] = R"(
+    CREATE TABLE IF NOT EXISTS %1 (
+        task_id BLOB NOT NULL,
+        blocker_id BLOB NOT NULL,
+        PRIMARY KEY(task_id, blocker_id),
+        FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE,
+        FOREIGN KEY(blocker_id) REFERENCES tasks(id) ON DELETE CASCADE
+    ) WITHOUT ROWID
+)";
+
+// Attachment metadata is kept apart from the content so listing a task's
+// attachments never walks the blob overflow pages. It keeps its rowid: the
+// AUTOINCREMENT id is what attachment_data is keyed by.
+const char TASK_ATTACHMENTS_TABLE_SCHEMA[] = R"(
+    CREATE TABLE IF NOT EXISTS %1 (
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        task_id BLOB NOT NULL,
+        file_name TEXT NOT NULL,
+        mime_type TEXT,
+        size INTEGER NOT NULL DEFAULT 0,
+        create_time DATETIME DEFAULT CURRENT_TIMESTAMP,
+        FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE
+    )
+)";
+}
+
 DatabaseManager* DatabaseManager::instance()
 {
     if (!m_instance) {
@@ -22,6 +106,13 @@ DatabaseManager* DatabaseManager::instance()
 DatabaseManager::DatabaseManager(QObject *parent)
     : QObject(parent)
     , m_initialized(false)
+    , m_integrityService(nullptr)
+    , m_attachmentStore(nullptr)
+    , m_batchDepth(0)
+    , m_idleBatchPending(false)
+    , m_transactionDepth(0)
+    , m_changesSignalled(false)
+    , m_signalsRolledBack(false)
 {
 }
 
@@ -54,6 +145,13 @@ bool DatabaseManager::initialize()
         qWarning() << "Failed to open database:" << m_database.lastError().text();
         return false;
     }
+
+    // SQLite ships with foreign keys disabled per connection; without this the
+    // ON DELETE CASCADE on task_tags never fires and orphaned tags accumulate.
+    QSqlQuery pragmaQuery(m_database);
+    if (!pragmaQuery.exec("PRAGMA foreign_keys = ON")) {
+        qWarning() << "Failed to enable foreign keys:" << pragmaQuery.lastError().text();
+    }
     
     if (!createTables()) {
         qWarning() << "Failed to create database tables";
@@ -75,6 +173,14 @@ bool DatabaseManager::initialize()
     }
     
     m_initialized = true;
+
+    m_attachmentStore = new AttachmentStore(this, m_database, this);
+
+    // Verification and orphan cleanup run in small steps once the app is idle,
+    // so they never delay startup
+    m_integrityService = new IntegrityService(this, this);
+    m_integrityService->start();
+
     return true;
 }
 
@@ -83,41 +189,29 @@ bool DatabaseManager::createTables()
     QSqlQuery query(m_database);
     
     // Create tasks table
-    QString createTasksTable = R"(
-        CREATE TABLE IF NOT EXISTS tasks (
-            id TEXT PRIMARY KEY,
-            title TEXT NOT NULL,
-            description TEXT,
-            create_time DATETIME DEFAULT CURRENT_TIMESTAMP,
-            due_time DATETIME,
-            priority INTEGER DEFAULT 2,
-            status INTEGER DEFAULT 0,
-            category TEXT DEFAULT 'default',
-            reminder_enabled BOOLEAN DEFAULT 0,
-            reminder_minutes INTEGER DEFAULT 15
-        )
-    )";
-    
-    if (!query.exec(createTasksTable)) {
+    if (!query.exec(QString(TASKS_TABLE_SCHEMA).arg("tasks"))) {
         qWarning() << "Failed to create tasks table:" << query.lastError().text();
         return false;
     }
     
     // Create task_tags table
-    QString createTagsTable = R"(
-        CREATE TABLE IF NOT EXISTS task_tags (
-            task_id TEXT,
-            tag TEXT,
-            PRIMARY KEY(task_id, tag),
-            FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE
-        )
-    )";
-    
-    if (!query.exec(createTagsTable)) {
+    if (!query.exec(QString(TASK_TAGS_TABLE_SCHEMA).arg("task_tags"))) {
         qWarning() << "Failed to create task_tags table:" << query.lastError().text();
         return false;
     }
     
+    // Create task_closure table
+    if (!query.exec(QString(TASK_CLOSURE_TABLE_SCHEMA).arg("task_closure"))) {
+        qWarning() << "Failed to create task_closure table:" << query.lastError().text();
+        return false;
+    }
+    
+    // Create task_dependencies table
+    if (!query.exec(QString(TASK_DEPENDENCIES_TABLE_SCHEMA).arg("task_dependencies"))) {
+        qWarning() << "Failed to create task_dependencies table:" << query.lastError().text();
+        return false;
+    }
+    
     // Create app_config table
     QString createConfigTable = R"(
         CREATE TABLE IF NOT EXISTS app_config (
@@ -130,6 +224,26 @@ bool DatabaseManager::createTables()
         qWarning() << "Failed to create app_config table:" << query.lastError().text();
         return false;
     }
+
+    // Create task_attachments table
+    if (!query.exec(QString(TASK_ATTACHMENTS_TABLE_SCHEMA).arg("task_attachments"))) {
+        qWarning() << "Failed to create task_attachments table:" << query.lastError().text();
+        return false;
+    }
+
+    // attachment_id aliases the rowid, which sqlite3_blob_open needs
+    QString createAttachmentDataTable = R"(
+        CREATE TABLE IF NOT EXISTS attachment_data (
+            attachment_id INTEGER PRIMARY KEY,
+            data BLOB,
+            FOREIGN KEY(attachment_id) REFERENCES task_attachments(id) ON DELETE CASCADE
+        )
+    )";
+
+    if (!query.exec(createAttachmentDataTable)) {
+        qWarning() << "Failed to create attachment_data table:" << query.lastError().text();
+        return false;
+    }
     
     return true;
 }
@@ -147,14 +261,28 @@ bool DatabaseManager::createIndexes()
         "CREATE INDEX IF NOT EXISTS idx_tasks_create_time ON tasks(create_time)",
         "CREATE INDEX IF NOT EXISTS idx_tasks_status_due_time ON tasks(status, due_time)",
 
-        // Performance indexes for task_tags table
-        "CREATE INDEX IF NOT EXISTS idx_task_tags_task_id ON task_tags(task_id)",
+        // Performance indexes for task_tags table (lookups by task_id use
+        // the primary key, which leads with it)
         "CREATE INDEX IF NOT EXISTS idx_task_tags_tag ON task_tags(tag)",
 
+        // Performance indexes for task_closure table
+        "CREATE INDEX IF NOT EXISTS idx_task_closure_descendant ON task_closure(descendant, ancestor)",
+
+        // Performance indexes for task_dependencies table
+        "CREATE INDEX IF NOT EXISTS idx_task_dependencies_blocker ON task_dependencies(blocker_id, task_id)",
+
+        // Performance indexes for task_attachments table
+        "CREATE INDEX IF NOT EXISTS idx_task_attachments_task_id ON task_attachments(task_id)",
+
         // Performance indexes for app_config table
         "CREATE INDEX IF NOT EXISTS idx_app_config_key ON app_config(key)"
     };
 
+    // Databases from before version 6 get the column in their migration
+    if (!columnType("tasks", "title_key").isEmpty()) {
+        indexQueries << TITLE_KEY_INDEX;
+    }
+
     for (const QString& indexQuery : indexQueries) {
         if (!query.exec(indexQuery)) {
             qWarning() << "Failed to create index:" << query.lastError().text();
@@ -172,16 +300,39 @@ bool DatabaseManager::insertTask(const Task& task)
         return false;
     }
     
+    // The task row, its closure row and its tags land together or not at all
+    if (!beginTransaction()) {
+        return false;
+    }
+    if (!writeNewTask(task)) {
+        rollbackTransaction();
+        return false;
+    }
+    if (!commitTransaction()) {
+        return false;
+    }
+    
+    Task savedTask = task;
+    savedTask.markClean();
+    noteChangeSignalled();
+    emit taskInserted(savedTask);
+    return true;
+}
+
+bool DatabaseManager::writeNewTask(const Task& task)
+{
     QSqlQuery query(m_database);
     query.prepare(R"(
-        INSERT INTO tasks (id, title, description, create_time, due_time, 
-                          priority, status, category, reminder_enabled, reminder_minutes)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO tasks (id, title, title_key, description, create_time, due_time, 
+                          priority, status, category, reminder_enabled, reminder_minutes,
+                          recurrence)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     )");
     
-    query.addBindValue(task.id());
+    query.addBindValue(task.id().toRfc4122());
     query.addBindValue(task.title());
-    query.addBindValue(task.description());
+    query.addBindValue(QString::fromUtf8(TaskSorter::titleSortKey(task.title())));
+    query.addBindValue(descriptionValue(task));
     query.addBindValue(task.createTime());
     query.addBindValue(task.dueTime());
     query.addBindValue(static_cast<int>(task.priority()));
@@ -189,24 +340,37 @@ bool DatabaseManager::insertTask(const Task& task)
     query.addBindValue(task.category());
     query.addBindValue(task.reminderEnabled());
     query.addBindValue(task.reminderMinutes());
+    query.addBindValue(recurrenceValue(task));
     
     if (!query.exec()) {
         qWarning() << "Failed to insert task:" << query.lastError().text();
         return false;
     }
     
+    // New tasks start as roots of their own subtree
+    QSqlQuery closureQuery(m_database);
+    closureQuery.prepare("INSERT INTO task_closure (ancestor, depth, descendant) VALUES (?, 0, ?)");
+    closureQuery.addBindValue(task.id().toRfc4122());
+    closureQuery.addBindValue(task.id().toRfc4122());
+    if (!closureQuery.exec()) {
+        qWarning() << "Failed to insert task hierarchy row:" << closureQuery.lastError().text();
+        return false;
+    }
+    
     // Insert tags
     for (const QString& tag : task.tags()) {
-        addTagToTask(task.id(), tag);
+        if (!addTagToTask(task.id(), tag)) {
+            qWarning() << "Failed to insert task tag:" << tag;
+            return false;
+        }
     }
     
-    emit taskInserted(task);
     return true;
 }
 
-QList<Task> DatabaseManager::getAllTasks()
+QVector<Task> DatabaseManager::getAllTasks()
 {
-    QList<Task> tasks;
+    QVector<Task> tasks;
     
     if (!m_initialized) {
         return tasks;
@@ -221,317 +385,1333 @@ QList<Task> DatabaseManager::getAllTasks()
     }
     
     while (query.next()) {
-        Task task;
-        task.setId(query.value("id").toString());
-        task.setTitle(query.value("title").toString());
-        task.setDescription(query.value("description").toString());
-        task.setCreateTime(query.value("create_time").toDateTime());
-        task.setDueTime(query.value("due_time").toDateTime());
-        task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
-        task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
-        task.setCategory(query.value("category").toString());
-        task.setReminderEnabled(query.value("reminder_enabled").toBool());
-        task.setReminderMinutes(query.value("reminder_minutes").toInt());
-        
-        // Load tags
-        task.setTags(getTaskTags(task.id()));
-        
-        tasks.append(task);
+        tasks.append(taskFromQuery(query));
     }
     
     return tasks;
 }
 
-bool DatabaseManager::addTagToTask(const QString& taskId, const QString& tag)
+QVector<Task> DatabaseManager::queryTasks(const TaskQuery& taskQuery)
 {
-    if (!m_initialized || taskId.isEmpty() || tag.isEmpty()) {
-        return false;
+    QVector<Task> tasks;
+
+    if (!m_initialized) {
+        return tasks;
     }
-    
+
+    QVariantList values;
     QSqlQuery query(m_database);
-    query.prepare("INSERT OR IGNORE INTO task_tags (task_id, tag) VALUES (?, ?)");
-    query.addBindValue(taskId);
-    query.addBindValue(tag);
-    
-    return query.exec();
-}
+    query.prepare(taskQuery.selectSql(&values));
+    for (const QVariant& value : qAsConst(values)) {
+        query.addBindValue(value);
+    }
 
-QStringList DatabaseManager::getTaskTags(const QString& taskId)
-{
-    QStringList tags;
-    
-    if (!m_initialized || taskId.isEmpty()) {
-        return tags;
+    if (!query.exec()) {
+        qWarning() << "Failed to query tasks:" << query.lastError().text();
+        return tasks;
     }
-    
-    QSqlQuery query(m_database);
-    query.prepare("SELECT tag FROM task_tags WHERE task_id = ?");
-    query.addBindValue(taskId);
-    
-    if (query.exec()) {
-        while (query.next()) {
-            tags.append(query.value("tag").toString());
-        }
+
+    if (taskQuery.limit() > 0) {
+        tasks.reserve(taskQuery.limit());
     }
-    
-    return tags;
+    while (query.next()) {
+        tasks.append(taskFromQuery(query));
+    }
+
+    return tasks;
 }
 
-int DatabaseManager::getDatabaseVersion()
+int DatabaseManager::countTasks(const TaskQuery& taskQuery)
 {
+    if (!m_initialized) {
+        return 0;
+    }
+
+    QVariantList values;
     QSqlQuery query(m_database);
-    query.prepare("SELECT value FROM app_config WHERE key = 'database_version'");
-    
+    query.prepare(taskQuery.countSql(&values));
+    for (const QVariant& value : qAsConst(values)) {
+        query.addBindValue(value);
+    }
+
     if (query.exec() && query.next()) {
         return query.value(0).toInt();
     }
-    
-    return 0; // Default version for new database
+
+    qWarning() << "Failed to count tasks:" << query.lastError().text();
+    return 0;
 }
 
-void DatabaseManager::setDatabaseVersion(int version)
+void DatabaseManager::beginBatch()
 {
-    QSqlQuery query(m_database);
-    query.prepare("INSERT OR REPLACE INTO app_config (key, value) VALUES ('database_version', ?)");
-    query.addBindValue(version);
-    query.exec();
+    if (m_batchDepth++ == 0) {
+        emit batchStarted();
+    }
 }
 
-bool DatabaseManager::migrateDatabase(int fromVersion, int toVersion)
+void DatabaseManager::endBatch()
 {
-    if (fromVersion == toVersion) {
-        return true;
+    if (m_batchDepth == 0) {
+        qWarning() << "endBatch() without beginBatch()";
+        return;
     }
 
-    qDebug() << "Migrating database from version" << fromVersion << "to version" << toVersion;
+    if (--m_batchDepth == 0) {
+        emit batchFinished();
+    }
+}
 
-    // Execute migrations step by step
-    for (int version = fromVersion; version < toVersion; version++) {
-        if (!executeMigrationStep(version, version + 1)) {
-            qWarning() << "Failed to migrate from version" << version << "to" << (version + 1);
+bool DatabaseManager::beginTransaction()
+{
+    if (m_transactionDepth == 0) {
+        if (!m_database.transaction()) {
+            qWarning() << "Failed to begin transaction:" << m_database.lastError().text();
+            return false;
+        }
+    } else {
+        QSqlQuery query(m_database);
+        if (!query.exec(QString("SAVEPOINT sp%1").arg(m_transactionDepth))) {
+            qWarning() << "Failed to create savepoint:" << query.lastError().text();
             return false;
         }
-        qDebug() << "Successfully migrated to version" << (version + 1);
     }
 
-    setDatabaseVersion(toVersion);
-    qDebug() << "Database migration completed successfully";
+    ++m_transactionDepth;
     return true;
 }
 
-bool DatabaseManager::executeMigrationStep(int fromVersion, int toVersion)
+bool DatabaseManager::commitTransaction()
 {
-    // Define migration steps for each version transition
-    switch (fromVersion) {
-    case 0:
-        // Migration from version 0 to 1 (initial schema creation)
-        if (toVersion == 1) {
-            // Indexes are already created in createIndexes()
-            // Any additional version 1 specific changes would go here
-            return true;
-        }
-        break;
+    if (m_transactionDepth == 0) {
+        qWarning() << "commitTransaction() without a matching beginTransaction()";
+        return false;
+    }
 
-    case 1:
-        // Migration from version 1 to 2 (future schema changes)
-        if (toVersion == 2) {
-            // Example: Add new column to tasks table
-            // QSqlQuery query(m_database);
-            // query.exec("ALTER TABLE tasks ADD COLUMN new_field TEXT DEFAULT ''");
-            return true;
+    if (m_transactionDepth == 1) {
+        if (!m_database.commit()) {
+            qWarning() << "Failed to commit transaction:" << m_database.lastError().text();
+            rollbackTransaction();
+            return false;
         }
-        break;
+        m_transactionDepth = 0;
+        finishTransaction(false);
+        return true;
+    }
 
-    // Add more migration cases as needed
-    default:
-        qWarning() << "No migration path defined from version" << fromVersion << "to" << toVersion;
+    QSqlQuery query(m_database);
+    if (!query.exec(QString("RELEASE sp%1").arg(m_transactionDepth - 1))) {
+        qWarning() << "Failed to release savepoint:" << query.lastError().text();
+        rollbackTransaction();
         return false;
     }
-
-    return false;
+    --m_transactionDepth;
+    return true;
 }
 
-bool DatabaseManager::validateDatabaseIntegrity()
+bool DatabaseManager::rollbackTransaction()
 {
-    if (!m_initialized) {
+    if (m_transactionDepth == 0) {
+        qWarning() << "rollbackTransaction() without a matching beginTransaction()";
         return false;
     }
 
-    QSqlQuery query(m_database);
+    --m_transactionDepth;
+    if (m_transactionDepth == 0) {
+        const bool rolledBack = m_database.rollback();
+        finishTransaction(true);
+        return rolledBack;
+    }
 
-    // Check that all required tables exist
-    QStringList requiredTables = {"tasks", "task_tags", "app_config"};
+    // Undo the savepoint's work but leave the outer transaction open; any
+    // signals sent so far may describe it, so listeners reload at the end
+    m_signalsRolledBack = m_signalsRolledBack || m_changesSignalled;
+    QSqlQuery query(m_database);
+    return query.exec(QString("ROLLBACK TO sp%1").arg(m_transactionDepth))
+        && query.exec(QString("RELEASE sp%1").arg(m_transactionDepth));
+}
 
-    for (const QString& tableName : requiredTables) {
-        query.prepare("SELECT name FROM sqlite_master WHERE type='table' AND name=?");
-        query.addBindValue(tableName);
+void DatabaseManager::noteChangeSignalled()
+{
+    if (m_transactionDepth > 0) {
+        m_changesSignalled = true;
+    }
+}
 
-        if (!query.exec() || !query.next()) {
-            qWarning() << "Required table" << tableName << "is missing";
-            return false;
-        }
+void DatabaseManager::finishTransaction(bool rolledBack)
+{
+    // Listeners only need to reload if they were told about work that
+    // didn't stick
+    const bool stale = m_signalsRolledBack || (rolledBack && m_changesSignalled);
+    m_changesSignalled = false;
+    m_signalsRolledBack = false;
+    if (stale) {
+        emit changesRolledBack();
     }
+}
 
-    // Check foreign key constraints
-    query.exec("PRAGMA foreign_key_check");
-    if (query.next()) {
-        qWarning() << "Foreign key constraint violations detected";
-        return false;
+void DatabaseManager::batchUntilIdle()
+{
+    if (m_idleBatchPending) {
+        return;
     }
 
-    // Check for orphaned records in task_tags
-    query.exec(R"(
-        SELECT COUNT(*) FROM task_tags tt
-        LEFT JOIN tasks t ON tt.task_id = t.id
-        WHERE t.id IS NULL
-    )");
+    m_idleBatchPending = true;
+    beginBatch();
+    QTimer::singleShot(0, this, [this]() {
+        m_idleBatchPending = false;
+        endBatch();
+    });
+}
 
-    if (query.next() && query.value(0).toInt() > 0) {
-        qWarning() << "Orphaned task_tags records detected";
-        return false;
+Task DatabaseManager::taskFromQuery(const QSqlQuery& query)
+{
+    Task task;
+    task.setId(TaskId::fromRfc4122(query.value("id").toByteArray()));
+    task.setTitle(query.value("title").toString());
+
+    // Large descriptions are stored compressed and only inflated when read
+    QVariant description = query.value("description");
+    if (description.userType() == QMetaType::QByteArray
+        && isCompressedDescription(description.toByteArray())) {
+        task.setCompressedDescription(description.toByteArray());
+    } else {
+        task.setDescription(description.toString());
     }
 
-    return true;
+    task.setCreateTime(query.value("create_time").toDateTime());
+    task.setDueTime(query.value("due_time").toDateTime());
+    task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
+    task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
+    task.setCategory(query.value("category").toString());
+    task.setReminderEnabled(query.value("reminder_enabled").toBool());
+    task.setReminderMinutes(query.value("reminder_minutes").toInt());
+    task.setRecurrence(RecurrenceRule::fromString(query.value("recurrence").toString()));
+
+    // Load tags
+    task.setTags(getTaskTags(task.id()));
+
+    // Freshly loaded rows match the database
+    task.markClean();
+
+    return task;
 }
 
-bool DatabaseManager::repairDatabase()
+QVariant DatabaseManager::descriptionValue(const Task& task) const
 {
-    if (!m_initialized) {
-        return false;
+    // Already-compressed descriptions are written back as-is
+    if (task.hasCompressedDescription()) {
+        return task.compressedDescription();
     }
 
-    QSqlQuery query(m_database);
+    QString description = task.description();
+    if (description.toUtf8().size() > DESCRIPTION_COMPRESSION_THRESHOLD) {
+        return compressDescription(description);
+    }
 
-    // Remove orphaned task_tags records
-    query.exec(R"(
-        DELETE FROM task_tags
-        WHERE task_id NOT IN (SELECT id FROM tasks)
-    )");
+    return description;
+}
 
-    if (query.numRowsAffected() > 0) {
-        qDebug() << "Removed" << query.numRowsAffected() << "orphaned task_tags records";
-    }
+QVariant DatabaseManager::recurrenceValue(const Task& task) const
+{
+    // A null QString binds as SQL NULL on Qt 5 and 6 alike
+    return task.isRecurring() ? QVariant(task.recurrence().toString()) : QVariant(QString());
+}
 
-    // Recreate indexes if missing
-    if (!createIndexes()) {
-        qWarning() << "Failed to recreate indexes during repair";
+bool DatabaseManager::setTaskParent(const TaskId& taskId, const TaskId& parentId)
+{
+    if (!m_initialized || taskId.isNull() || taskId == parentId) {
         return false;
     }
 
-    // Run database integrity check
-    query.exec("PRAGMA integrity_check");
-    if (query.next()) {
-        QString result = query.value(0).toString();
-        if (result != "ok") {
-            qWarning() << "Database integrity check failed:" << result;
+    TaskId oldParentId = getParentTask(taskId);
+    if (oldParentId == parentId) {
+        return true;
+    }
+
+    QSqlQuery query(m_database);
+
+    // A task can't move below itself or its own descendants
+    if (!parentId.isNull()) {
+        query.prepare("SELECT 1 FROM task_closure WHERE descendant = ? AND ancestor = ?");
+        query.addBindValue(parentId.toRfc4122());
+        query.addBindValue(taskId.toRfc4122());
+        if (!query.exec()) {
+            qWarning() << "Failed to check task hierarchy:" << query.lastError().text();
+            return false;
+        }
+        if (query.next()) {
+            qWarning() << "Cannot move a task below its own subtree";
             return false;
         }
     }
 
-    return true;
-}
-
-// CRUD method implementations
-bool DatabaseManager::updateTask(const Task& task)
-{
-    if (!m_initialized || !task.isValid()) {
+    if (!beginTransaction()) {
         return false;
     }
 
-    QSqlQuery query(m_database);
+    // Detach the subtree: drop every link from outside it to inside it
     query.prepare(R"(
-        UPDATE tasks SET
-            title = ?, description = ?, due_time = ?,
-            priority = ?, status = ?, category = ?,
-            reminder_enabled = ?, reminder_minutes = ?
-        WHERE id = ?
+        DELETE FROM task_closure
+        WHERE descendant IN (SELECT descendant FROM task_closure WHERE ancestor = ?)
+          AND ancestor NOT IN (SELECT descendant FROM task_closure WHERE ancestor = ?)
     )");
-
-    query.addBindValue(task.title());
-    query.addBindValue(task.description());
-    query.addBindValue(task.dueTime());
-    query.addBindValue(static_cast<int>(task.priority()));
-    query.addBindValue(static_cast<int>(task.status()));
-    query.addBindValue(task.category());
-    query.addBindValue(task.reminderEnabled());
-    query.addBindValue(task.reminderMinutes());
-    query.addBindValue(task.id());
-
+    query.addBindValue(taskId.toRfc4122());
+    query.addBindValue(taskId.toRfc4122());
     if (!query.exec()) {
-        qWarning() << "Failed to update task:" << query.lastError().text();
+        qWarning() << "Failed to detach subtree:" << query.lastError().text();
+        rollbackTransaction();
         return false;
     }
 
-    // Update tags - remove old ones and add new ones
-    QSqlQuery deleteTagsQuery(m_database);
-    deleteTagsQuery.prepare("DELETE FROM task_tags WHERE task_id = ?");
-    deleteTagsQuery.addBindValue(task.id());
-    deleteTagsQuery.exec();
+    // Attach it: link every ancestor of the new parent (itself included)
+    // to every node of the subtree
+    if (!parentId.isNull()) {
+        query.prepare(R"(
+            INSERT INTO task_closure (ancestor, depth, descendant)
+            SELECT above.ancestor, above.depth + below.depth + 1, below.descendant
+            FROM task_closure above, task_closure below
+            WHERE above.descendant = ? AND below.ancestor = ?
+        )");
+        query.addBindValue(parentId.toRfc4122());
+        query.addBindValue(taskId.toRfc4122());
+        if (!query.exec()) {
+            qWarning() << "Failed to attach subtree:" << query.lastError().text();
+            rollbackTransaction();
+            return false;
+        }
+    }
 
-    // Add new tags
-    for (const QString& tag : task.tags()) {
-        addTagToTask(task.id(), tag);
+    if (!commitTransaction()) {
+        return false;
     }
 
-    emit taskUpdated(task);
+    noteChangeSignalled();
+    emit taskMoved(taskId, oldParentId, parentId);
     return true;
 }
 
-bool DatabaseManager::deleteTask(const QString& taskId)
+TaskId DatabaseManager::getParentTask(const TaskId& taskId)
 {
-    if (!m_initialized || taskId.isEmpty()) {
-        return false;
+    if (!m_initialized || taskId.isNull()) {
+        return TaskId();
     }
 
     QSqlQuery query(m_database);
-    query.prepare("DELETE FROM tasks WHERE id = ?");
-    query.addBindValue(taskId);
+    query.prepare("SELECT ancestor FROM task_closure WHERE descendant = ? AND depth = 1");
+    query.addBindValue(taskId.toRfc4122());
 
-    if (!query.exec()) {
-        qWarning() << "Failed to delete task:" << query.lastError().text();
-        return false;
+    if (query.exec() && query.next()) {
+        return TaskId::fromRfc4122(query.value(0).toByteArray());
     }
 
-    // Tags will be automatically deleted due to CASCADE foreign key
-    emit taskDeleted(taskId);
-    return true;
+    return TaskId();
 }
 
-Task DatabaseManager::getTask(const QString& taskId)
+QVector<Task> DatabaseManager::getChildTasks(const TaskId& parentId, QVector<int>* childCounts)
 {
-    Task task;
+    QVector<Task> tasks;
+    if (childCounts) {
+        childCounts->clear();
+    }
+
+    if (!m_initialized) {
+        return tasks;
+    }
+
+    // Each child comes with its own child count, so a tree can show
+    // expanders without loading grandchildren
+    const QString childCount = R"(
+        (SELECT COUNT(*) FROM task_closure g WHERE g.ancestor = t.id AND g.depth = 1) AS child_count
+    )";
+
+    QSqlQuery query(m_database);
+    if (parentId.isNull()) {
+        query.prepare(QString(R"(
+            SELECT t.*, %1 FROM tasks t
+            WHERE NOT EXISTS (SELECT 1 FROM task_closure p WHERE p.descendant = t.id AND p.depth = 1)
+            ORDER BY t.create_time DESC
+        )").arg(childCount));
+    } else {
+        query.prepare(QString(R"(
+            SELECT t.*, %1 FROM task_closure c
+            JOIN tasks t ON t.id = c.descendant
+            WHERE c.ancestor = ? AND c.depth = 1
+            ORDER BY t.create_time DESC
+        )").arg(childCount));
+        query.addBindValue(parentId.toRfc4122());
+    }
+
+    if (!query.exec()) {
+        qWarning() << "Failed to get child tasks:" << query.lastError().text();
+        return tasks;
+    }
+
+    while (query.next()) {
+        tasks.append(taskFromQuery(query));
+        if (childCounts) {
+            childCounts->append(query.value("child_count").toInt());
+        }
+    }
+
+    return tasks;
+}
+
+QVector<Task> DatabaseManager::getDescendantTasks(const TaskId& taskId)
+{
+    QVector<Task> tasks;
+
+    if (!m_initialized || taskId.isNull()) {
+        return tasks;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(R"(
+        SELECT t.* FROM task_closure c
+        JOIN tasks t ON t.id = c.descendant
+        WHERE c.ancestor = ? AND c.depth > 0
+        ORDER BY c.depth, t.create_time DESC
+    )");
+    query.addBindValue(taskId.toRfc4122());
+
+    if (!query.exec()) {
+        qWarning() << "Failed to get descendant tasks:" << query.lastError().text();
+        return tasks;
+    }
+
+    while (query.next()) {
+        tasks.append(taskFromQuery(query));
+    }
+
+    return tasks;
+}
+
+int DatabaseManager::getChildTaskCount(const TaskId& taskId)
+{
+    if (!m_initialized || taskId.isNull()) {
+        return 0;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("SELECT COUNT(*) FROM task_closure WHERE ancestor = ? AND depth = 1");
+    query.addBindValue(taskId.toRfc4122());
+
+    if (query.exec() && query.next()) {
+        return query.value(0).toInt();
+    }
+
+    return 0;
+}
+
+bool DatabaseManager::getSubtreeProgress(const TaskId& taskId, int* total, int* completed)
+{
+    if (!m_initialized || taskId.isNull() || !total || !completed) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(R"(
+        SELECT COUNT(*), COALESCE(SUM(t.status = ?), 0) FROM task_closure c
+        JOIN tasks t ON t.id = c.descendant
+        WHERE c.ancestor = ? AND c.depth > 0
+    )");
+    query.addBindValue(static_cast<int>(TaskStatus::Completed));
+    query.addBindValue(taskId.toRfc4122());
+
+    if (!query.exec() || !query.next()) {
+        qWarning() << "Failed to get subtree progress:" << query.lastError().text();
+        return false;
+    }
+
+    *total = query.value(0).toInt();
+    *completed = query.value(1).toInt();
+    return true;
+}
+
+bool DatabaseManager::addTaskDependency(const TaskId& taskId, const TaskId& blockerId)
+{
+    if (!m_initialized || taskId.isNull() || blockerId.isNull() || taskId == blockerId) {
+        return false;
+    }
+
+    // The edge closes a cycle if the blocker already waits on the task,
+    // directly or through other blockers
+    QSqlQuery cycleQuery(m_database);
+    cycleQuery.prepare(R"(
+        WITH RECURSIVE waits_on(id) AS (
+            SELECT ?
+            UNION
+            SELECT d.blocker_id FROM task_dependencies d JOIN waits_on w ON d.task_id = w.id
+        )
+        SELECT 1 FROM waits_on WHERE id = ? LIMIT 1
+    )");
+    cycleQuery.addBindValue(blockerId.toRfc4122());
+    cycleQuery.addBindValue(taskId.toRfc4122());
+    if (!cycleQuery.exec()) {
+        qWarning() << "Failed to check task dependency:" << cycleQuery.lastError().text();
+        return false;
+    }
+    if (cycleQuery.next()) {
+        qWarning() << "Refused task dependency that would create a cycle:"
+                   << taskId.toString() << "blocked by" << blockerId.toString();
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("INSERT OR IGNORE INTO task_dependencies (task_id, blocker_id) VALUES (?, ?)");
+    query.addBindValue(taskId.toRfc4122());
+    query.addBindValue(blockerId.toRfc4122());
+
+    if (!query.exec()) {
+        qWarning() << "Failed to add task dependency:" << query.lastError().text();
+        return false;
+    }
+
+    if (query.numRowsAffected() > 0) {
+        noteChangeSignalled();
+        emit taskDependencyAdded(taskId, blockerId);
+    }
+    return true;
+}
+
+bool DatabaseManager::removeTaskDependency(const TaskId& taskId, const TaskId& blockerId)
+{
+    if (!m_initialized) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("DELETE FROM task_dependencies WHERE task_id = ? AND blocker_id = ?");
+    query.addBindValue(taskId.toRfc4122());
+    query.addBindValue(blockerId.toRfc4122());
+
+    if (!query.exec()) {
+        qWarning() << "Failed to remove task dependency:" << query.lastError().text();
+        return false;
+    }
+
+    if (query.numRowsAffected() > 0) {
+        noteChangeSignalled();
+        emit taskDependencyRemoved(taskId, blockerId);
+    }
+    return true;
+}
+
+QVector<QPair<TaskId, TaskId>> DatabaseManager::getAllTaskDependencies()
+{
+    QVector<QPair<TaskId, TaskId>> dependencies;
+
+    if (!m_initialized) {
+        return dependencies;
+    }
+
+    QSqlQuery query(m_database);
+    if (!query.exec("SELECT task_id, blocker_id FROM task_dependencies")) {
+        qWarning() << "Failed to get task dependencies:" << query.lastError().text();
+        return dependencies;
+    }
+
+    while (query.next()) {
+        dependencies.append(qMakePair(TaskId::fromRfc4122(query.value(0).toByteArray()),
+                                      TaskId::fromRfc4122(query.value(1).toByteArray())));
+    }
+
+    return dependencies;
+}
+
+QHash<TaskId, TaskStatus> DatabaseManager::getTaskStatuses()
+{
+    QHash<TaskId, TaskStatus> statuses;
+
+    if (!m_initialized) {
+        return statuses;
+    }
+
+    QSqlQuery query(m_database);
+    if (!query.exec("SELECT id, status FROM tasks")) {
+        qWarning() << "Failed to get task statuses:" << query.lastError().text();
+        return statuses;
+    }
+
+    while (query.next()) {
+        statuses.insert(TaskId::fromRfc4122(query.value(0).toByteArray()),
+                        static_cast<TaskStatus>(query.value(1).toInt()));
+    }
+
+    return statuses;
+}
+
+QVector<TaskSearchText> DatabaseManager::getTaskSearchTexts()
+{
+    QVector<TaskSearchText> texts;
+
+    if (!m_initialized) {
+        return texts;
+    }
+
+    // Only the indexed columns; descriptions are never read
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (!query.exec(R"(
+            SELECT t.id, t.title, group_concat(tt.tag, char(31))
+            FROM tasks t LEFT JOIN task_tags tt ON tt.task_id = t.id
+            GROUP BY t.id
+        )")) {
+        qWarning() << "Failed to get task search texts:" << query.lastError().text();
+        return texts;
+    }
+
+    while (query.next()) {
+        TaskSearchText text;
+        text.taskId = TaskId::fromRfc4122(query.value(0).toByteArray());
+        text.title = query.value(1).toString();
+        const QString tags = query.value(2).toString();
+        if (!tags.isEmpty()) {
+            text.tags = tags.split(QChar(0x1F));
+        }
+        texts.append(text);
+    }
+
+    return texts;
+}
+
+bool DatabaseManager::addTagToTask(const TaskId& taskId, const QString& tag)
+{
+    if (!m_initialized || taskId.isNull() || tag.isEmpty()) {
+        return false;
+    }
+    
+    QSqlQuery query(m_database);
+    query.prepare("INSERT OR IGNORE INTO task_tags (task_id, tag) VALUES (?, ?)");
+    query.addBindValue(taskId.toRfc4122());
+    query.addBindValue(tag);
+    
+    return query.exec();
+}
+
+QStringList DatabaseManager::getTaskTags(const TaskId& taskId)
+{
+    QStringList tags;
+    
+    if (!m_initialized || taskId.isNull()) {
+        return tags;
+    }
+    
+    QSqlQuery query(m_database);
+    query.prepare("SELECT tag FROM task_tags WHERE task_id = ?");
+    query.addBindValue(taskId.toRfc4122());
+    
+    if (query.exec()) {
+        while (query.next()) {
+            tags.append(query.value("tag").toString());
+        }
+    }
+    
+    return tags;
+}
+
+int DatabaseManager::getDatabaseVersion()
+{
+    QSqlQuery query(m_database);
+    query.prepare("SELECT value FROM app_config WHERE key = 'database_version'");
+    
+    if (query.exec() && query.next()) {
+        return query.value(0).toInt();
+    }
+    
+    return 0; // Default version for new database
+}
+
+void DatabaseManager::setDatabaseVersion(int version)
+{
+    QSqlQuery query(m_database);
+    query.prepare("INSERT OR REPLACE INTO app_config (key, value) VALUES ('database_version', ?)");
+    query.addBindValue(version);
+    query.exec();
+}
+
+bool DatabaseManager::migrateDatabase(int fromVersion, int toVersion)
+{
+    if (fromVersion == toVersion) {
+        return true;
+    }
+
+    qDebug() << "Migrating database from version" << fromVersion << "to version" << toVersion;
+
+    // Execute migrations step by step
+    for (int version = fromVersion; version < toVersion; version++) {
+        if (!executeMigrationStep(version, version + 1)) {
+            qWarning() << "Failed to migrate from version" << version << "to" << (version + 1);
+            return false;
+        }
+        qDebug() << "Successfully migrated to version" << (version + 1);
+    }
+
+    setDatabaseVersion(toVersion);
+    qDebug() << "Database migration completed successfully";
+    return true;
+}
+
+bool DatabaseManager::executeMigrationStep(int fromVersion, int toVersion)
+{
+    // Define migration steps for each version transition
+    switch (fromVersion) {
+    case 0:
+        // Migration from version 0 to 1 (initial schema creation)
+        if (toVersion == 1) {
+            // Indexes are already created in createIndexes()
+            // Any additional version 1 specific changes would go here
+            return true;
+        }
+        break;
+
+    case 1:
+        // Migration from version 1 to 2 (TEXT UUID keys to 16-byte BLOB keys)
+        if (toVersion == 2) {
+            return migrateToBinaryTaskIds();
+        }
+        break;
+
+    case 2:
+        // Migration from version 2 to 3 (recurrence rules)
+        if (toVersion == 3) {
+            if (!columnType("tasks", "recurrence").isEmpty()) {
+                return true;  // Created with the current schema
+            }
+            QSqlQuery query(m_database);
+            if (!query.exec("ALTER TABLE tasks ADD COLUMN recurrence TEXT")) {
+                qWarning() << "Failed to add recurrence column:" << query.lastError().text();
+                return false;
+            }
+            return true;
+        }
+        break;
+
+    case 3:
+        // Migration from version 3 to 4 (task hierarchy): every existing
+        // task becomes a root, i.e. just its own depth-0 closure row
+        if (toVersion == 4) {
+            QSqlQuery query(m_database);
+            if (!query.exec("INSERT OR IGNORE INTO task_closure (ancestor, depth, descendant) "
+                            "SELECT id, 0, id FROM tasks")) {
+                qWarning() << "Failed to seed task_closure:" << query.lastError().text();
+                return false;
+            }
+            return true;
+        }
+        break;
+
+    case 4:
+        // Migration from version 4 to 5 (task dependencies)
+        if (toVersion == 5) {
+            // The table is created in createTables(); existing tasks have no blockers
+            return true;
+        }
+        break;
+
+    case 5:
+        // Migration from version 5 to 6 (title sort keys)
+        if (toVersion == 6) {
+            return addTitleSortKeys();
+        }
+        break;
+
+    // Add more migration cases as needed
+    default:
+        qWarning() << "No migration path defined from version" << fromVersion << "to" << toVersion;
+        return false;
+    }
+
+    return false;
+}
+
+bool DatabaseManager::addTitleSortKeys()
+{
+    QSqlQuery query(m_database);
+    if (columnType("tasks", "title_key").isEmpty()
+        && !query.exec("ALTER TABLE tasks ADD COLUMN title_key TEXT NOT NULL DEFAULT ''")) {
+        qWarning() << "Failed to add title_key column:" << query.lastError().text();
+        return false;
+    }
+
+    // Keys come from C++, so every row is read and written back once
+    if (!beginTransaction()) {
+        return false;
+    }
+
+    QVector<QPair<QByteArray, QString>> keys;
+    if (!query.exec("SELECT id, title FROM tasks")) {
+        qWarning() << "Failed to read task titles:" << query.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    while (query.next()) {
+        keys.append({query.value(0).toByteArray(),
+                     QString::fromUtf8(TaskSorter::titleSortKey(query.value(1).toString()))});
+    }
+
+    QSqlQuery update(m_database);
+    update.prepare("UPDATE tasks SET title_key = ? WHERE id = ?");
+    for (const auto& key : qAsConst(keys)) {
+        update.bindValue(0, key.second);
+        update.bindValue(1, key.first);
+        if (!update.exec()) {
+            qWarning() << "Failed to store title key:" << update.lastError().text();
+            rollbackTransaction();
+            return false;
+        }
+    }
+
+    if (!query.exec(TITLE_KEY_INDEX)) {
+        qWarning() << "Failed to create title key index:" << query.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    return commitTransaction();
+}
+
+bool DatabaseManager::migrateToBinaryTaskIds()
+{
+    // Tables are rebuilt, which SQLite only allows with foreign keys off;
+    // the pragma is a no-op inside a transaction, so it goes first
+    QSqlQuery query(m_database);
+    query.exec("PRAGMA foreign_keys = OFF");
+
+    if (!m_database.transaction()) {
+        qWarning() << "Failed to begin id migration:" << m_database.lastError().text();
+        query.exec("PRAGMA foreign_keys = ON");
+        return false;
+    }
+
+    // Parents first, so the rebuilt child tables reference the new tasks table
+    bool success = rebuildWithBinaryTaskIds("tasks", TASKS_TABLE_SCHEMA, "id",
+                       {"id", "title", "description", "create_time", "due_time", "priority",
+                        "status", "category", "reminder_enabled", "reminder_minutes"})
+        && rebuildWithBinaryTaskIds("task_tags", TASK_TAGS_TABLE_SCHEMA, "task_id",
+                       {"task_id", "tag"})
+        && rebuildWithBinaryTaskIds("task_attachments", TASK_ATTACHMENTS_TABLE_SCHEMA, "task_id",
+                       {"id", "task_id", "file_name", "mime_type", "size", "create_time"});
+
+    if (success && query.exec("PRAGMA foreign_key_check") && query.next()) {
+        qWarning() << "Id migration left foreign key violations in" << query.value(0).toString();
+        success = false;
+    }
+
+    if (success && !m_database.commit()) {
+        qWarning() << "Failed to commit id migration:" << m_database.lastError().text();
+        success = false;
+    }
+
+    if (!success) {
+        m_database.rollback();
+    }
+
+    query.exec("PRAGMA foreign_keys = ON");
+
+    // Dropping the old tables dropped their indexes too
+    return success && createIndexes();
+}
+
+bool DatabaseManager::rebuildWithBinaryTaskIds(const QString& tableName, const char* schema,
+                                               const QString& idColumn, const QStringList& columns)
+{
+    QSqlQuery query(m_database);
+
+    // Tables created by this version already use the new layout
+    if (columnType(tableName, idColumn).compare("BLOB", Qt::CaseInsensitive) == 0) {
+        return true;
+    }
+
+    const QString newTableName = tableName + "_new";
+    if (!query.exec(QString(schema).arg(newTableName))) {
+        qWarning() << "Failed to create" << newTableName << ":" << query.lastError().text();
+        return false;
+    }
+
+    QSqlQuery select(m_database);
+    select.setForwardOnly(true);
+    if (!select.exec(QString("SELECT %1 FROM %2").arg(columns.join(", "), tableName))) {
+        qWarning() << "Failed to read" << tableName << ":" << select.lastError().text();
+        return false;
+    }
+
+    QStringList placeholders;
+    for (int i = 0; i < columns.size(); ++i) {
+        placeholders.append("?");
+    }
+
+    // OR IGNORE drops rows the new NOT NULL keys reject instead of failing
+    QSqlQuery insert(m_database);
+    insert.prepare(QString("INSERT OR IGNORE INTO %1 (%2) VALUES (%3)")
+                       .arg(newTableName, columns.join(", "), placeholders.join(", ")));
+
+    const int idIndex = columns.indexOf(idColumn);
+    int skipped = 0;
+
+    while (select.next()) {
+        TaskId taskId = TaskId::fromString(select.value(idIndex).toString());
+        if (taskId.isNull()) {
+            skipped++;
+            continue;
+        }
+
+        for (int i = 0; i < columns.size(); ++i) {
+            insert.bindValue(i, i == idIndex ? QVariant(taskId.toRfc4122()) : select.value(i));
+        }
+
+        if (!insert.exec()) {
+            qWarning() << "Failed to copy row into" << newTableName << ":" << insert.lastError().text();
+            return false;
+        }
+    }
+
+    if (skipped > 0) {
+        qWarning() << "Dropped" << skipped << "rows with malformed task ids from" << tableName;
+    }
+
+    if (!query.exec(QString("DROP TABLE %1").arg(tableName))
+        || !query.exec(QString("ALTER TABLE %1 RENAME TO %2").arg(newTableName, tableName))) {
+        qWarning() << "Failed to replace" << tableName << ":" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+QString DatabaseManager::columnType(const QString& tableName, const QString& columnName)
+{
+    QSqlQuery query(m_database);
+    query.exec(QString("PRAGMA table_info(%1)").arg(tableName));
+    while (query.next()) {
+        if (query.value("name").toString() == columnName) {
+            return query.value("type").toString();
+        }
+    }
+    return QString();  // No such column
+}
+
+bool DatabaseManager::validateDatabaseIntegrity()
+{
+    if (!m_initialized) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+
+    // Check that all required tables exist
+    QStringList requiredTables = {"tasks", "task_tags", "task_closure", "task_dependencies", "app_config",
+                                  "task_attachments", "attachment_data"};
+
+    for (const QString& tableName : requiredTables) {
+        query.prepare("SELECT name FROM sqlite_master WHERE type='table' AND name=?");
+        query.addBindValue(tableName);
+
+        if (!query.exec() || !query.next()) {
+            qWarning() << "Required table" << tableName << "is missing";
+            return false;
+        }
+    }
+
+    // Check foreign key constraints
+    query.exec("PRAGMA foreign_key_check");
+    if (query.next()) {
+        qWarning() << "Foreign key constraint violations detected";
+        return false;
+    }
+
+    // Check for orphaned records in task_tags
+    query.exec(R"(
+        SELECT COUNT(*) FROM task_tags tt
+        LEFT JOIN tasks t ON tt.task_id = t.id
+        WHERE t.id IS NULL
+    )");
+
+    if (query.next() && query.value(0).toInt() > 0) {
+        qWarning() << "Orphaned task_tags records detected";
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabaseManager::repairDatabase()
+{
+    if (!m_initialized) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+
+    // Remove orphaned task_tags records
+    int removed = 0;
+    int batch = 0;
+    while ((batch = removeOrphanedTags(500)) > 0) {
+        removed += batch;
+    }
+
+    if (removed > 0) {
+        qDebug() << "Removed" << removed << "orphaned task_tags records";
+    }
+
+    // Recreate indexes if missing
+    if (!createIndexes()) {
+        qWarning() << "Failed to recreate indexes during repair";
+        return false;
+    }
+
+    // Run database integrity check
+    query.exec("PRAGMA integrity_check");
+    if (query.next()) {
+        QString result = query.value(0).toString();
+        if (result != "ok") {
+            qWarning() << "Database integrity check failed:" << result;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QStringList DatabaseManager::integrityCheckTables()
+{
+    QStringList tables;
+
+    if (!m_initialized) {
+        return tables;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("SELECT name FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%' ORDER BY name");
+
+    if (query.exec()) {
+        while (query.next()) {
+            tables.append(query.value(0).toString());
+        }
+    }
+
+    return tables;
+}
+
+bool DatabaseManager::quickCheckTable(const QString& tableName, QStringList* problems)
+{
+    if (!m_initialized || tableName.isEmpty()) {
+        return false;
+    }
+
+    // PRAGMA arguments cannot be bound, so quote the identifier ourselves.
+    // Checking one table (and its indexes) at a time keeps each step short.
+    QString quotedName = tableName;
+    quotedName.replace("'", "''");
+
+    QSqlQuery query(m_database);
+    if (!query.exec(QString("PRAGMA quick_check('%1')").arg(quotedName))) {
+        qWarning() << "Failed to run quick_check on" << tableName << ":" << query.lastError().text();
+        if (problems) {
+            problems->append(query.lastError().text());
+        }
+        return false;
+    }
+
+    bool ok = true;
+    while (query.next()) {
+        QString result = query.value(0).toString();
+        if (result != "ok") {
+            ok = false;
+            if (problems) {
+                problems->append(QString("%1: %2").arg(tableName, result));
+            }
+        }
+    }
+
+    return ok;
+}
+
+bool DatabaseManager::reindexTable(const QString& tableName)
+{
+    if (!m_initialized || tableName.isEmpty()) {
+        return false;
+    }
+
+    // Rebuilds the table's indexes from its rows, which is what a failed
+    // quick_check most often needs
+    QString quotedName = tableName;
+    quotedName.replace("\"", "\"\"");
+
+    QSqlQuery query(m_database);
+    if (!query.exec(QString("REINDEX \"%1\"").arg(quotedName))) {
+        qWarning() << "Failed to reindex" << tableName << ":" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+int DatabaseManager::removeOrphanedTags(int batchSize)
+{
+    if (!m_initialized || batchSize <= 0) {
+        return -1;
+    }
+
+    // Delete orphans a bounded number of tasks at a time so a large backlog
+    // never holds the write lock for long
+    QSqlQuery query(m_database);
+    query.prepare(R"(
+        DELETE FROM task_tags
+        WHERE task_id IN (
+            SELECT DISTINCT tt.task_id FROM task_tags tt
+            LEFT JOIN tasks t ON tt.task_id = t.id
+            WHERE t.id IS NULL
+            LIMIT ?
+        )
+    )");
+    query.addBindValue(batchSize);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to remove orphaned tags:" << query.lastError().text();
+        return -1;
+    }
+
+    return query.numRowsAffected();
+}
+
+// CRUD method implementations
+bool DatabaseManager::updateTask(const Task& task, TaskId* spawnedId)
+{
+    return writeTaskUpdate(task, false, spawnedId);
+}
+
+bool DatabaseManager::restoreTask(const Task& task)
+{
+    return writeTaskUpdate(task, true, nullptr);
+}
+
+bool DatabaseManager::writeTaskUpdate(const Task& task, bool restoring, TaskId* spawnedId)
+{
+    if (spawnedId) {
+        *spawnedId = TaskId();
+    }
+    if (!m_initialized || !task.isValid()) {
+        return false;
+    }
+
+    if (task.dirtyFields() == Task::NoField) {
+        return true; // Nothing changed since the task was loaded
+    }
+
+    // Dependents are released on the strength of a status, so every edit
+    // path goes through the same transition rules
+    if (!restoring && task.dirtyFields().testFlag(Task::StatusField)) {
+        QSqlQuery statusQuery(m_database);
+        statusQuery.prepare("SELECT status FROM tasks WHERE id = ?");
+        statusQuery.addBindValue(task.id().toRfc4122());
+        if (!statusQuery.exec() || !statusQuery.next()) {
+            qWarning() << "Failed to read task status:" << statusQuery.lastError().text();
+            return false;
+        }
+
+        const TaskStatus storedStatus = static_cast<TaskStatus>(statusQuery.value(0).toInt());
+        if (storedStatus != task.status() && !Task::isValidTransition(storedStatus, task.status())) {
+            qWarning() << "Refused status transition" << static_cast<int>(storedStatus)
+                       << "->" << static_cast<int>(task.status()) << "for task" << task.id().toString();
+            return false;
+        }
+    }
+
+    // Completing a recurring task hands its rule on to the series' next
+    // instance, so only the live instance of a series ever carries it
+    Task savedTask = task;
+    Task nextTask;
+    bool createNext = false;
+    if (!restoring && task.dirtyFields().testFlag(Task::StatusField)
+        && task.status() == TaskStatus::Completed && task.isRecurring()) {
+        createNext = task.nextOccurrence(&nextTask);
+        savedTask.setRecurrence(RecurrenceRule());
+    }
+
+    Task::Fields fields = savedTask.dirtyFields();
+
+    // Only write the columns that actually changed
+    QStringList assignments;
+    QVariantList values;
+
+    if (fields & Task::TitleField) {
+        assignments << "title = ?, title_key = ?";
+        values << task.title() << QString::fromUtf8(TaskSorter::titleSortKey(task.title()));
+    }
+    if (fields & Task::DescriptionField) {
+        assignments << "description = ?";
+        values << descriptionValue(task);
+    }
+    if (fields & Task::CreateTimeField) {
+        assignments << "create_time = ?";
+        values << task.createTime();
+    }
+    if (fields & Task::DueTimeField) {
+        assignments << "due_time = ?";
+        values << task.dueTime();
+    }
+    if (fields & Task::PriorityField) {
+        assignments << "priority = ?";
+        values << static_cast<int>(task.priority());
+    }
+    if (fields & Task::StatusField) {
+        assignments << "status = ?";
+        values << static_cast<int>(task.status());
+    }
+    if (fields & Task::CategoryField) {
+        assignments << "category = ?";
+        values << task.category();
+    }
+    if (fields & Task::ReminderEnabledField) {
+        assignments << "reminder_enabled = ?";
+        values << task.reminderEnabled();
+    }
+    if (fields & Task::ReminderMinutesField) {
+        assignments << "reminder_minutes = ?";
+        values << task.reminderMinutes();
+    }
+    if (fields & Task::RecurrenceField) {
+        assignments << "recurrence = ?";
+        values << recurrenceValue(savedTask);
+    }
+
+    // A tag diff or a follow-up instance is several statements; keep them
+    // atomic with the column update
+    bool useTransaction = fields.testFlag(Task::TagsField) || createNext;
+    if (useTransaction && !beginTransaction()) {
+        return false;
+    }
+
+    if (!assignments.isEmpty()) {
+        QSqlQuery query(m_database);
+        query.prepare(QString("UPDATE tasks SET %1 WHERE id = ?").arg(assignments.join(", ")));
+        for (const QVariant& value : values) {
+            query.addBindValue(value);
+        }
+        query.addBindValue(task.id().toRfc4122());
+
+        if (!query.exec()) {
+            qWarning() << "Failed to update task:" << query.lastError().text();
+            if (useTransaction) {
+                rollbackTransaction();
+            }
+            return false;
+        }
+    }
+
+    if (fields.testFlag(Task::TagsField) && !updateTaskTags(task.id(), task.tags())) {
+        rollbackTransaction();
+        return false;
+    }
+
+    if (createNext && !writeNewTask(nextTask)) {
+        rollbackTransaction();
+        return false;
+    }
+
+    if (useTransaction && !commitTransaction()) {
+        return false;
+    }
+
+    savedTask.markClean();
+    noteChangeSignalled();
+    emit taskUpdated(savedTask, fields);
+
+    if (createNext) {
+        nextTask.markClean();
+        noteChangeSignalled();
+        emit taskInserted(nextTask);
+        if (spawnedId) {
+            *spawnedId = nextTask.id();
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::updateTaskTags(const TaskId& taskId, const QStringList& tags)
+{
+    // Apply only the set difference against what is stored
+    QStringList storedTags = getTaskTags(taskId);
+
+    for (const QString& tag : storedTags) {
+        if (!tags.contains(tag) && !removeTagFromTask(taskId, tag)) {
+            qWarning() << "Failed to remove tag" << tag << "from task" << taskId.toString();
+            return false;
+        }
+    }
+
+    for (const QString& tag : tags) {
+        if (!storedTags.contains(tag) && !addTagToTask(taskId, tag)) {
+            qWarning() << "Failed to add tag" << tag << "to task" << taskId.toString();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DatabaseManager::deleteTask(const TaskId& taskId)
+{
+    if (!m_initialized || taskId.isNull()) {
+        return false;
+    }
+
+    // Subtasks go with their parent; collect them first so every removed
+    // task is reported, deepest first
+    QVector<TaskId> removedIds;
+    QSqlQuery subtreeQuery(m_database);
+    subtreeQuery.prepare("SELECT descendant FROM task_closure WHERE ancestor = ? ORDER BY depth DESC");
+    subtreeQuery.addBindValue(taskId.toRfc4122());
+    if (subtreeQuery.exec()) {
+        while (subtreeQuery.next()) {
+            removedIds.append(TaskId::fromRfc4122(subtreeQuery.value(0).toByteArray()));
+        }
+    }
+    if (removedIds.isEmpty()) {
+        removedIds.append(taskId);
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(R"(
+        DELETE FROM tasks
+        WHERE id IN (SELECT descendant FROM task_closure WHERE ancestor = ?) OR id = ?
+    )");
+    query.addBindValue(taskId.toRfc4122());
+    query.addBindValue(taskId.toRfc4122());
+
+    if (!query.exec()) {
+        qWarning() << "Failed to delete task:" << query.lastError().text();
+        return false;
+    }
+
+    // Tags and hierarchy rows will be automatically deleted due to CASCADE foreign keys
+    TaskChangeBatch batch(this);
+    for (const TaskId& removedId : removedIds) {
+        noteChangeSignalled();
+        emit taskDeleted(removedId);
+    }
+    return true;
+}
 
-    if (!m_initialized || taskId.isEmpty()) {
+Task DatabaseManager::getTask(const TaskId& taskId)
+{
+    Task task;
+
+    if (!m_initialized || taskId.isNull()) {
         return task;
     }
 
     QSqlQuery query(m_database);
     query.prepare("SELECT * FROM tasks WHERE id = ?");
-    query.addBindValue(taskId);
+    query.addBindValue(taskId.toRfc4122());
 
     if (!query.exec() || !query.next()) {
         return task;
     }
 
-    task.setId(query.value("id").toString());
-    task.setTitle(query.value("title").toString());
-    task.setDescription(query.value("description").toString());
-    task.setCreateTime(query.value("create_time").toDateTime());
-    task.setDueTime(query.value("due_time").toDateTime());
-    task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
-    task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
-    task.setCategory(query.value("category").toString());
-    task.setReminderEnabled(query.value("reminder_enabled").toBool());
-    task.setReminderMinutes(query.value("reminder_minutes").toInt());
-
-    // Load tags
-    task.setTags(getTaskTags(task.id()));
-
-    return task;
+    return taskFromQuery(query);
 }
-QList<Task> DatabaseManager::getTasksByCategory(const QString& category)
+QVector<Task> DatabaseManager::getTasksByCategory(const QString& category)
 {
-    QList<Task> tasks;
+    QVector<Task> tasks;
 
     if (!m_initialized || category.isEmpty()) {
         return tasks;
@@ -547,28 +1727,15 @@ QList<Task> DatabaseManager::getTasksByCategory(const QString& category)
     }
 
     while (query.next()) {
-        Task task;
-        task.setId(query.value("id").toString());
-        task.setTitle(query.value("title").toString());
-        task.setDescription(query.value("description").toString());
-        task.setCreateTime(query.value("create_time").toDateTime());
-        task.setDueTime(query.value("due_time").toDateTime());
-        task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
-        task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
-        task.setCategory(query.value("category").toString());
-        task.setReminderEnabled(query.value("reminder_enabled").toBool());
-        task.setReminderMinutes(query.value("reminder_minutes").toInt());
-        task.setTags(getTaskTags(task.id()));
-
-        tasks.append(task);
+        tasks.append(taskFromQuery(query));
     }
 
     return tasks;
 }
 
-QList<Task> DatabaseManager::getTasksByStatus(TaskStatus status)
+QVector<Task> DatabaseManager::getTasksByStatus(TaskStatus status)
 {
-    QList<Task> tasks;
+    QVector<Task> tasks;
 
     if (!m_initialized) {
         return tasks;
@@ -584,28 +1751,15 @@ QList<Task> DatabaseManager::getTasksByStatus(TaskStatus status)
     }
 
     while (query.next()) {
-        Task task;
-        task.setId(query.value("id").toString());
-        task.setTitle(query.value("title").toString());
-        task.setDescription(query.value("description").toString());
-        task.setCreateTime(query.value("create_time").toDateTime());
-        task.setDueTime(query.value("due_time").toDateTime());
-        task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
-        task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
-        task.setCategory(query.value("category").toString());
-        task.setReminderEnabled(query.value("reminder_enabled").toBool());
-        task.setReminderMinutes(query.value("reminder_minutes").toInt());
-        task.setTags(getTaskTags(task.id()));
-
-        tasks.append(task);
+        tasks.append(taskFromQuery(query));
     }
 
     return tasks;
 }
 
-QList<Task> DatabaseManager::getTasksByPriority(TaskPriority priority)
+QVector<Task> DatabaseManager::getTasksByPriority(TaskPriority priority)
 {
-    QList<Task> tasks;
+    QVector<Task> tasks;
 
     if (!m_initialized) {
         return tasks;
@@ -621,28 +1775,15 @@ QList<Task> DatabaseManager::getTasksByPriority(TaskPriority priority)
     }
 
     while (query.next()) {
-        Task task;
-        task.setId(query.value("id").toString());
-        task.setTitle(query.value("title").toString());
-        task.setDescription(query.value("description").toString());
-        task.setCreateTime(query.value("create_time").toDateTime());
-        task.setDueTime(query.value("due_time").toDateTime());
-        task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
-        task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
-        task.setCategory(query.value("category").toString());
-        task.setReminderEnabled(query.value("reminder_enabled").toBool());
-        task.setReminderMinutes(query.value("reminder_minutes").toInt());
-        task.setTags(getTaskTags(task.id()));
-
-        tasks.append(task);
+        tasks.append(taskFromQuery(query));
     }
 
     return tasks;
 }
 
-QList<Task> DatabaseManager::getOverdueTasks()
+QVector<Task> DatabaseManager::getOverdueTasks()
 {
-    QList<Task> tasks;
+    QVector<Task> tasks;
 
     if (!m_initialized) {
         return tasks;
@@ -664,28 +1805,15 @@ QList<Task> DatabaseManager::getOverdueTasks()
     }
 
     while (query.next()) {
-        Task task;
-        task.setId(query.value("id").toString());
-        task.setTitle(query.value("title").toString());
-        task.setDescription(query.value("description").toString());
-        task.setCreateTime(query.value("create_time").toDateTime());
-        task.setDueTime(query.value("due_time").toDateTime());
-        task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
-        task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
-        task.setCategory(query.value("category").toString());
-        task.setReminderEnabled(query.value("reminder_enabled").toBool());
-        task.setReminderMinutes(query.value("reminder_minutes").toInt());
-        task.setTags(getTaskTags(task.id()));
-
-        tasks.append(task);
+        tasks.append(taskFromQuery(query));
     }
 
     return tasks;
 }
 
-QList<Task> DatabaseManager::getTodayTasks()
+QVector<Task> DatabaseManager::getTodayTasks()
 {
-    QList<Task> tasks;
+    QVector<Task> tasks;
 
     if (!m_initialized) {
         return tasks;
@@ -705,33 +1833,20 @@ QList<Task> DatabaseManager::getTodayTasks()
     }
 
     while (query.next()) {
-        Task task;
-        task.setId(query.value("id").toString());
-        task.setTitle(query.value("title").toString());
-        task.setDescription(query.value("description").toString());
-        task.setCreateTime(query.value("create_time").toDateTime());
-        task.setDueTime(query.value("due_time").toDateTime());
-        task.setPriority(static_cast<TaskPriority>(query.value("priority").toInt()));
-        task.setStatus(static_cast<TaskStatus>(query.value("status").toInt()));
-        task.setCategory(query.value("category").toString());
-        task.setReminderEnabled(query.value("reminder_enabled").toBool());
-        task.setReminderMinutes(query.value("reminder_minutes").toInt());
-        task.setTags(getTaskTags(task.id()));
-
-        tasks.append(task);
+        tasks.append(taskFromQuery(query));
     }
 
     return tasks;
 }
-bool DatabaseManager::removeTagFromTask(const QString& taskId, const QString& tag)
+bool DatabaseManager::removeTagFromTask(const TaskId& taskId, const QString& tag)
 {
-    if (!m_initialized || taskId.isEmpty() || tag.isEmpty()) {
+    if (!m_initialized || taskId.isNull() || tag.isEmpty()) {
         return false;
     }
 
     QSqlQuery query(m_database);
     query.prepare("DELETE FROM task_tags WHERE task_id = ? AND tag = ?");
-    query.addBindValue(taskId);
+    query.addBindValue(taskId.toRfc4122());
     query.addBindValue(tag);
 
     return query.exec();
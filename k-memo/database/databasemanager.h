@@ -6,9 +6,22 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QString>
-#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
 #include "models/task.h"
 
+class IntegrityService;
+class TaskQuery;
+class AttachmentStore;
+
+// What TaskSearchIndex indexes for one task
+struct TaskSearchText {
+    TaskId taskId;
+    QString title;
+    QStringList tags;
+};
+
 class DatabaseManager : public QObject
 {
     Q_OBJECT
@@ -19,22 +32,53 @@ public:
     bool initialize();
     bool isInitialized() const { return m_initialized; }
     
+    // Longer descriptions are stored compressed
+    static const int DESCRIPTION_COMPRESSION_THRESHOLD;  // UTF-8 bytes
+
     // Task operations
     bool insertTask(const Task& task);
-    bool updateTask(const Task& task);
-    bool deleteTask(const QString& taskId);
-    Task getTask(const QString& taskId);
-    QList<Task> getAllTasks();
-    QList<Task> getTasksByCategory(const QString& category);
-    QList<Task> getTasksByStatus(TaskStatus status);
-    QList<Task> getTasksByPriority(TaskPriority priority);
-    QList<Task> getOverdueTasks();
-    QList<Task> getTodayTasks();
+    // Completing a recurring task also inserts the series' next instance,
+    // whose id is returned through spawnedId (null if none was made).
+    // Status changes Task::isValidTransition() forbids are refused.
+    bool updateTask(const Task& task, TaskId* spawnedId = nullptr);
+    // For undo: writes a task back to an earlier state, so its status may
+    // move against the transition rules and no next instance is made
+    bool restoreTask(const Task& task);
+    bool deleteTask(const TaskId& taskId);
+    Task getTask(const TaskId& taskId);
+    QVector<Task> getAllTasks();
+    QVector<Task> getTasksByCategory(const QString& category);
+    QVector<Task> getTasksByStatus(TaskStatus status);
+    QVector<Task> getTasksByPriority(TaskPriority priority);
+    QVector<Task> getOverdueTasks();
+    QVector<Task> getTodayTasks();
+
+    // Filtered, sorted and limited in SQL (see TaskQuery)
+    QVector<Task> queryTasks(const TaskQuery& query);
+    int countTasks(const TaskQuery& query);
+    
+    // Hierarchy operations (closure table; a null parent means a root task)
+    bool setTaskParent(const TaskId& taskId, const TaskId& parentId);
+    TaskId getParentTask(const TaskId& taskId);
+    QVector<Task> getChildTasks(const TaskId& parentId, QVector<int>* childCounts = nullptr);
+    QVector<Task> getDescendantTasks(const TaskId& taskId);
+    int getChildTaskCount(const TaskId& taskId);
+    bool getSubtreeProgress(const TaskId& taskId, int* total, int* completed);
+    
+    // Dependency operations ("task is blocked by blocker"). An edge that
+    // would close a cycle is refused; DependencyGraph checks in memory first
+    bool addTaskDependency(const TaskId& taskId, const TaskId& blockerId);
+    bool removeTaskDependency(const TaskId& taskId, const TaskId& blockerId);
+    QVector<QPair<TaskId, TaskId>> getAllTaskDependencies();
+    QHash<TaskId, TaskStatus> getTaskStatuses();
+
+    // Title and tags of every task, for building the search index
+    QVector<TaskSearchText> getTaskSearchTexts();
     
     // Tag operations
-    bool addTagToTask(const QString& taskId, const QString& tag);
-    bool removeTagFromTask(const QString& taskId, const QString& tag);
-    QStringList getTaskTags(const QString& taskId);
+    bool addTagToTask(const TaskId& taskId, const QString& tag);
+    bool removeTagFromTask(const TaskId& taskId, const QString& tag);
+    QStringList getTaskTags(const TaskId& taskId);
     QStringList getAllTags();
     
     // Category operations
@@ -55,10 +99,49 @@ public:
     bool restore(const QString& backupPath);
     bool vacuum();
 
+    // Change batching: between beginBatch() and the matching endBatch(),
+    // listeners may hold back per-task notifications and apply them at once
+    // when batchFinished() is emitted. Batches nest.
+    void beginBatch();
+    void endBatch();
+    bool isBatching() const { return m_batchDepth > 0; }
+
+    // A batch that ends when control returns to the event loop
+    void batchUntilIdle();
+
+    // Transactions nest: the outermost call opens a real transaction and
+    // inner ones a savepoint, so operations that need several statements
+    // can run inside a caller's transaction and roll back with it
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+    bool inTransaction() const { return m_transactionDepth > 0; }
+
+    // Attachments (content is streamed separately from task rows)
+    AttachmentStore* attachmentStore() const { return m_attachmentStore; }
+
+    // Integrity maintenance (driven incrementally by IntegrityService)
+    bool validateDatabaseIntegrity();
+    bool repairDatabase();
+    QStringList integrityCheckTables();
+    bool quickCheckTable(const QString& tableName, QStringList* problems = nullptr);
+    bool reindexTable(const QString& tableName);
+    int removeOrphanedTags(int batchSize);
+    IntegrityService* integrityService() const { return m_integrityService; }
+
 signals:
     void taskInserted(const Task& task);
-    void taskUpdated(const Task& task);
-    void taskDeleted(const QString& taskId);
+    void taskUpdated(const Task& task, Task::Fields changedFields);
+    void taskDeleted(const TaskId& taskId);
+    void taskMoved(const TaskId& taskId, const TaskId& oldParentId, const TaskId& newParentId);
+    void taskDependencyAdded(const TaskId& taskId, const TaskId& blockerId);
+    void taskDependencyRemoved(const TaskId& taskId, const TaskId& blockerId);
+    void batchStarted();
+    void batchFinished();
+    // Work that change signals were already sent for was rolled back, by
+    // the outermost transaction or a savepoint inside it; listeners should
+    // reload
+    void changesRolledBack();
     void databaseError(const QString& error);
 
 private:
@@ -69,20 +152,55 @@ private:
     bool createIndexes();
     bool migrateDatabase(int fromVersion, int toVersion);
     bool executeMigrationStep(int fromVersion, int toVersion);
-    bool validateDatabaseIntegrity();
-    bool repairDatabase();
     int getDatabaseVersion();
     void setDatabaseVersion(int version);
+    bool migrateToBinaryTaskIds();
+    bool addTitleSortKeys();
+    QString columnType(const QString& tableName, const QString& columnName);
+    bool rebuildWithBinaryTaskIds(const QString& tableName, const char* schema,
+                                  const QString& idColumn, const QStringList& columns);
     
+    Task taskFromQuery(const QSqlQuery& query);
+    QVariant descriptionValue(const Task& task) const;
+    QVariant recurrenceValue(const Task& task) const;
+    bool writeNewTask(const Task& task);
+    bool writeTaskUpdate(const Task& task, bool restoring, TaskId* spawnedId);
+    bool updateTaskTags(const TaskId& taskId, const QStringList& tags);
+    void noteChangeSignalled();
+    void finishTransaction(bool rolledBack);
+
     bool executeQuery(const QString& query, const QVariantList& params = QVariantList());
     QSqlQuery prepareQuery(const QString& query);
     
     static DatabaseManager* m_instance;
     QSqlDatabase m_database;
     bool m_initialized;
+    IntegrityService* m_integrityService;
+    AttachmentStore* m_attachmentStore;
+    int m_batchDepth;
+    bool m_idleBatchPending;
+    int m_transactionDepth;
+    bool m_changesSignalled;        // A change signal went out in this transaction
+    bool m_signalsRolledBack;       // ...and a savepoint then discarded work
     
     static const int DATABASE_VERSION;
     static const QString DATABASE_NAME;
 };
 
+// Scoped DatabaseManager batch for bulk operations
+class TaskChangeBatch
+{
+public:
+    explicit TaskChangeBatch(DatabaseManager* database = DatabaseManager::instance())
+        : m_database(database)
+    {
+        m_database->beginBatch();
+    }
+    ~TaskChangeBatch() { m_database->endBatch(); }
+
+private:
+    Q_DISABLE_COPY(TaskChangeBatch)
+    DatabaseManager* m_database;
+};
+
 #endif // DATABASEMANAGER_H
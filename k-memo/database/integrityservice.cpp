@@ -0,0 +1,160 @@
+#include "integrityservice.h"
+#include "databasemanager.h"
+#include <QDateTime>
+#include <QDebug>
+
+IntegrityService::IntegrityService(DatabaseManager* database, QObject *parent)
+    : QObject(parent)
+    , m_database(database)
+    , m_stepTimer(new QTimer(this))
+    , m_phase(Phase::Stopped)
+    , m_orphansRemoved(0)
+    , m_orphanCleanupFailed(false)
+    , m_lastCheckPassed(true)
+{
+    m_stepTimer->setSingleShot(true);
+    connect(m_stepTimer, &QTimer::timeout, this, &IntegrityService::runStep);
+
+    // Any write means the user is active; back off until things are quiet
+    connect(m_database, &DatabaseManager::taskInserted, this, &IntegrityService::onDatabaseActivity);
+    connect(m_database, &DatabaseManager::taskUpdated, this, &IntegrityService::onDatabaseActivity);
+    connect(m_database, &DatabaseManager::taskDeleted, this, &IntegrityService::onDatabaseActivity);
+}
+
+void IntegrityService::start()
+{
+    if (isRunning() && m_phase != Phase::Finished) {
+        return;
+    }
+
+    m_phase = Phase::CollectOrphans;
+    m_pendingTables.clear();
+    m_damagedTables.clear();
+    m_problems.clear();
+    m_repairedProblems.clear();
+    m_orphansRemoved = 0;
+    m_orphanCleanupFailed = false;
+
+    scheduleNextStep(IDLE_DELAY);
+}
+
+void IntegrityService::stop()
+{
+    m_stepTimer->stop();
+    m_phase = Phase::Stopped;
+}
+
+void IntegrityService::onDatabaseActivity()
+{
+    if (m_phase != Phase::Stopped && m_phase != Phase::Finished) {
+        scheduleNextStep(IDLE_DELAY);
+    }
+}
+
+void IntegrityService::scheduleNextStep(int delayMs)
+{
+    m_stepTimer->start(delayMs);
+}
+
+void IntegrityService::runStep()
+{
+    if (!m_database || !m_database->isInitialized()) {
+        stop();
+        return;
+    }
+
+    switch (m_phase) {
+    case Phase::CollectOrphans: {
+        int removed = m_database->removeOrphanedTags(ORPHAN_BATCH_SIZE);
+        if (removed > 0) {
+            m_orphansRemoved += removed;
+            scheduleNextStep(STEP_INTERVAL);
+            return;
+        }
+
+        m_orphanCleanupFailed = removed < 0;
+        if (m_orphansRemoved > 0) {
+            qDebug() << "Removed" << m_orphansRemoved << "orphaned task_tags records";
+            emit orphansRemoved(m_orphansRemoved);
+        }
+
+        m_pendingTables = m_database->integrityCheckTables();
+        m_phase = Phase::QuickCheck;
+        scheduleNextStep(STEP_INTERVAL);
+        return;
+    }
+
+    case Phase::QuickCheck:
+        if (!m_pendingTables.isEmpty()) {
+            const QString table = m_pendingTables.takeFirst();
+            if (!m_database->quickCheckTable(table, &m_problems)) {
+                m_damagedTables.append(table);
+            }
+            scheduleNextStep(STEP_INTERVAL);
+            return;
+        }
+        if (m_damagedTables.isEmpty()) {
+            finishPass();
+            return;
+        }
+
+        // Damaged indexes are the common case; rebuild them table by table
+        qWarning() << "Database integrity problems detected:" << m_problems;
+        m_pendingTables = m_damagedTables;
+        m_phase = Phase::Repair;
+        scheduleNextStep(STEP_INTERVAL);
+        return;
+
+    case Phase::Repair:
+        if (!m_pendingTables.isEmpty()) {
+            m_database->reindexTable(m_pendingTables.takeFirst());
+            scheduleNextStep(STEP_INTERVAL);
+            return;
+        }
+
+        // What the second check still finds is what gets reported
+        m_repairedProblems = m_problems;
+        m_problems.clear();
+        m_pendingTables = m_damagedTables;
+        m_phase = Phase::Verify;
+        scheduleNextStep(STEP_INTERVAL);
+        return;
+
+    case Phase::Verify:
+        if (!m_pendingTables.isEmpty()) {
+            m_database->quickCheckTable(m_pendingTables.takeFirst(), &m_problems);
+            scheduleNextStep(STEP_INTERVAL);
+            return;
+        }
+        if (m_problems.isEmpty()) {
+            qDebug() << "Database repaired after integrity check";
+            emit tablesRepaired(m_repairedProblems);
+        }
+        finishPass();
+        return;
+
+    case Phase::Stopped:
+    case Phase::Finished:
+        return;
+    }
+}
+
+void IntegrityService::finishPass()
+{
+    m_phase = Phase::Finished;
+
+    if (m_orphanCleanupFailed) {
+        m_problems.prepend("Failed to remove orphaned task_tags records");
+    }
+    if (!m_problems.isEmpty()) {
+        qWarning() << "Database integrity problems remain:" << m_problems;
+    }
+
+    m_lastCheckPassed = m_problems.isEmpty();
+    m_lastProblems = m_problems;
+
+    m_database->setConfig("integrity_last_check", QDateTime::currentDateTime().toString(Qt::ISODate));
+    m_database->setConfig("integrity_last_result", m_lastCheckPassed ? "ok" : m_problems.join("; "));
+
+    emit checkCompleted(m_lastCheckPassed, m_lastProblems);
+}
@@ -0,0 +1,72 @@
+#ifndef INTEGRITYSERVICE_H
+#define INTEGRITYSERVICE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QStringList>
+
+class DatabaseManager;
+
+// Runs database verification and orphan cleanup in small steps while the
+// application is idle. Each step is one bounded unit of work (one batch of
+// orphaned tags, or one table's quick_check or REINDEX), and any database
+// write pushes the next step back until activity settles again.
+//
+// Tables that fail quick_check are reindexed one per step and checked
+// again; what is still wrong afterwards is reported by checkCompleted().
+class IntegrityService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit IntegrityService(DatabaseManager* database, QObject *parent = nullptr);
+
+    void start();
+    void stop();
+    bool isRunning() const { return m_phase != Phase::Stopped; }
+
+    bool lastCheckPassed() const { return m_lastCheckPassed; }
+    QStringList lastProblems() const { return m_lastProblems; }
+
+signals:
+    void orphansRemoved(int count);
+    void tablesRepaired(const QStringList& problems);
+    void checkCompleted(bool ok, const QStringList& problems);
+
+private slots:
+    void onDatabaseActivity();
+    void runStep();
+
+private:
+    enum class Phase {
+        Stopped,
+        CollectOrphans,
+        QuickCheck,
+        Repair,
+        Verify,
+        Finished
+    };
+
+    void scheduleNextStep(int delayMs);
+    void finishPass();
+
+    DatabaseManager* m_database;
+    QTimer* m_stepTimer;
+    Phase m_phase;
+
+    QStringList m_pendingTables;
+    QStringList m_damagedTables;    // Failed quick_check this pass
+    QStringList m_problems;
+    QStringList m_repairedProblems; // Found before the REINDEX cleared them
+    int m_orphansRemoved;
+    bool m_orphanCleanupFailed;
+
+    bool m_lastCheckPassed;
+    QStringList m_lastProblems;
+
+    static const int IDLE_DELAY = 5000;        // Wait for 5s without writes before working
+    static const int STEP_INTERVAL = 50;       // Gap between consecutive steps
+    static const int ORPHAN_BATCH_SIZE = 200;  // Orphaned task ids removed per step
+};
+
+#endif // INTEGRITYSERVICE_H
@@ -0,0 +1,139 @@
+#include "taskquery.h"
+#include <QStringList>
+
+namespace {
+// "column IN (?, ?, ...)" for the set bits of a mask whose bit 0 is `firstValue`
+QString inClause(const char* column, quint8 mask, quint8 allBits, int firstValue, QVariantList* values)
+{
+    if ((mask & allBits) == allBits) {
+        return QString();
+    }
+
+    QStringList placeholders;
+    for (int bit = 0; bit < 8; ++bit) {
+        if (mask & allBits & (1 << bit)) {
+            placeholders << "?";
+            values->append(firstValue + bit);
+        }
+    }
+
+    // An empty set matches nothing
+    return placeholders.isEmpty() ? QStringLiteral("0")
+                                  : QString("%1 IN (%2)").arg(column, placeholders.join(", "));
+}
+}
+
+TaskQuery::TaskQuery()
+    : m_sort{{SortByCreateTime, Qt::DescendingOrder}}
+    , m_limit(-1)
+    , m_offset(0)
+{
+}
+
+TaskQuery::TaskQuery(const TaskFilter& filter)
+    : TaskQuery()
+{
+    m_filter = filter;
+}
+
+void TaskQuery::setSort(SortKey key, Qt::SortOrder order)
+{
+    m_sort = {{key, order}};
+}
+
+void TaskQuery::addSort(SortKey key, Qt::SortOrder order)
+{
+    m_sort.append({key, order});
+}
+
+void TaskQuery::setLimit(int limit, int offset)
+{
+    m_limit = limit;
+    m_offset = qMax(0, offset);
+}
+
+QString TaskQuery::selectSql(QVariantList* values) const
+{
+    QString sql = "SELECT * FROM tasks" + whereClause(values) + orderByClause(values);
+    if (m_limit >= 0) {
+        sql += " LIMIT ? OFFSET ?";
+        values->append(m_limit);
+        values->append(m_offset);
+    }
+    return sql;
+}
+
+QString TaskQuery::countSql(QVariantList* values) const
+{
+    return "SELECT COUNT(*) FROM tasks" + whereClause(values);
+}
+
+QString TaskQuery::whereClause(QVariantList* values) const
+{
+    QStringList predicates;
+
+    if (!m_filter.category.isEmpty()) {
+        predicates << "category = ?";
+        values->append(m_filter.category);
+    }
+
+    QString status = inClause("status", m_filter.statuses, TaskFilter::ALL_STATUSES,
+                              static_cast<int>(TaskStatus::Pending), values);
+    if (!status.isEmpty()) {
+        predicates << status;
+    }
+
+    QString priority = inClause("priority", m_filter.priorities, TaskFilter::ALL_PRIORITIES,
+                                static_cast<int>(TaskPriority::Low), values);
+    if (!priority.isEmpty()) {
+        predicates << priority;
+    }
+
+    return predicates.isEmpty() ? QString() : " WHERE " + predicates.join(" AND ");
+}
+
+QString TaskQuery::orderByClause(QVariantList* values) const
+{
+    // Same ordering as TaskModel, including the id tie-break, which
+    // TaskSorter keeps ascending whatever the columns' directions
+    QStringList keys;
+    for (const SortColumn& column : m_sort) {
+        const bool ascending = column.order == Qt::AscendingOrder;
+        const QString dir = ascending ? "ASC" : "DESC";
+
+        switch (column.key) {
+        case SortByTitle:
+            // TaskSorter::titleSortKey(), so the page matches the model's order
+            keys << "title_key " + dir;
+            break;
+        case SortByCreateTime:
+            keys << "create_time " + dir;
+            break;
+        case SortByDueTime:
+            keys << QString("due_time IS NULL %1, due_time %1").arg(dir);
+            break;
+        case SortByPriority:
+            keys << QString("priority %1").arg(ascending ? "DESC" : "ASC");
+            break;
+        case SortByStatus:
+            keys << "status " + dir;
+            break;
+        case SortByCategory:
+            if (m_categoryRanks.isEmpty()) {
+                keys << "category " + dir;
+            } else {
+                QString ranked = "CASE category";
+                for (auto it = m_categoryRanks.cbegin(); it != m_categoryRanks.cend(); ++it) {
+                    ranked += " WHEN ? THEN ?";
+                    values->append(it.key());
+                    values->append(it.value());
+                }
+                keys << QString("%1 ELSE %2 END %3").arg(ranked).arg(m_categoryRanks.size()).arg(dir);
+            }
+            break;
+        }
+    }
+    keys << "id ASC";
+
+    return " ORDER BY " + keys.join(", ");
+}
@@ -0,0 +1,70 @@
+#ifndef TASKQUERY_H
+#define TASKQUERY_H
+
+#include <QHash>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+#include "models/taskfilter.h"
+
+// Parameterized SELECT over the tasks table, for databases too large to
+// filter and sort in memory.
+//
+// Every predicate compares a bare column against bound values (category =,
+// status IN, priority IN), so SQLite can satisfy it from the idx_tasks_*
+// indexes. Ordered by a single indexed column, LIMIT lets it stop after the
+// first page instead of sorting the table; further sort keys, which a
+// TaskModel sorted by several columns adds, cost a top-N sort of the rows
+// that match.
+class TaskQuery
+{
+public:
+    enum SortKey {
+        SortByTitle,
+        SortByCreateTime,
+        SortByDueTime,      // Tasks without a due time last
+        SortByPriority,     // Highest priority first
+        SortByStatus,
+        SortByCategory
+    };
+
+    TaskQuery();
+    explicit TaskQuery(const TaskFilter& filter);
+
+    void setFilter(const TaskFilter& filter) { m_filter = filter; }
+    // setSort() replaces the sort with one key; addSort() appends a key that
+    // breaks the ties of the ones before it. The id breaks the last ties.
+    void setSort(SortKey key, Qt::SortOrder order = Qt::AscendingOrder);
+    void addSort(SortKey key, Qt::SortOrder order = Qt::AscendingOrder);
+    void clearSort() { m_sort.clear(); }
+
+    // SQLite compares categories byte by byte. With ranks from
+    // TaskSorter::categoryRanks() they sort as the model collates them;
+    // categories without a rank follow the ranked ones.
+    void setCategoryRanks(const QHash<QString, int>& ranks) { m_categoryRanks = ranks; }
+    void setLimit(int limit, int offset = 0);
+
+    const TaskFilter& filter() const { return m_filter; }
+    int limit() const { return m_limit; }
+
+    // SQL text and its bind values, in placeholder order
+    QString selectSql(QVariantList* values) const;
+    QString countSql(QVariantList* values) const;
+
+private:
+    struct SortColumn {
+        SortKey key;
+        Qt::SortOrder order;
+    };
+
+    QString whereClause(QVariantList* values) const;
+    QString orderByClause(QVariantList* values) const;
+
+    TaskFilter m_filter;
+    QVector<SortColumn> m_sort;
+    QHash<QString, int> m_categoryRanks;
+    int m_limit;        // -1 for no limit
+    int m_offset;
+};
+
+#endif // TASKQUERY_H
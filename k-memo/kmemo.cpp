@@ -9,11 +9,17 @@
 #include <QDesktopWidget>
 #include "models/taskmodel.h"
 #include "models/task.h"
+#include "managers/undomanager.h"
+#include "models/tasksearchindex.h"
+#include "models/dependencygraph.h"
 
 kmemo::kmemo(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::kmemo)
     , m_taskModel(nullptr)
+    , m_undoManager(nullptr)
+    , m_searchIndex(nullptr)
+    , m_dependencyGraph(nullptr)
 {
     ui->setupUi(this);
     setupSimpleUI();
@@ -44,6 +50,32 @@ void kmemo::setupTaskModel()
 {
     m_taskModel = new TaskModel(this);
     // 暂时不连接到视图，等待后续集成
+    m_searchIndex = new TaskSearchIndex(this);
+    // 依赖图随数据库信号更新，维护可开始的任务集合
+    m_dependencyGraph = new DependencyGraph(this);
+
+    // 撤销/重做：Ctrl+Z / Ctrl+Shift+Z
+    m_undoManager = new UndoManager(this);
+    QAction* undoAction = new QAction(tr("Undo"), this);
+    undoAction->setShortcut(QKeySequence::Undo);
+    connect(undoAction, &QAction::triggered, m_undoManager, &UndoManager::undo);
+    connect(m_undoManager->stack(), &QUndoStack::canUndoChanged, undoAction, &QAction::setEnabled);
+    undoAction->setEnabled(false);
+    addAction(undoAction);
+
+    QAction* redoAction = new QAction(tr("Redo"), this);
+    redoAction->setShortcut(QKeySequence::Redo);
+    connect(redoAction, &QAction::triggered, m_undoManager, &UndoManager::redo);
+    connect(m_undoManager->stack(), &QUndoStack::canRedoChanged, redoAction, &QAction::setEnabled);
+    redoAction->setEnabled(false);
+    addAction(redoAction);
+
+    // 计数标签只关心状态计数的变化
+    connect(m_taskModel, &TaskModel::facetsChanged, this, [this](TaskModel::Facets changed) {
+        if (changed & TaskModel::StatusFacet) {
+            updateTaskCount();
+        }
+    });
 }
 
 void kmemo::setupSimpleConnections()
@@ -84,8 +116,9 @@ void kmemo::setupSimpleConnections()
 void kmemo::updateTaskCount()
 {
     if (ui->taskCountLabel) {
-        // 临时显示默认值
-        ui->taskCountLabel->setText("0 tasks");
+        const int total = m_taskModel ? m_taskModel->getTaskCount() : 0;
+        const int completed = m_taskModel ? m_taskModel->getCompletedCount() : 0;
+        ui->taskCountLabel->setText(QString("%1 tasks (%2 completed)").arg(total).arg(completed));
     }
 }
 
@@ -135,9 +168,9 @@ void kmemo::onSortTasksClicked()
 void kmemo::addNewTask(const QString &title)
 {
     // 临时的任务添加逻辑
-    if (m_taskModel) {
+    if (m_undoManager) {
         Task newTask(title);
-        m_taskModel->addTask(newTask);
+        m_undoManager->addTask(newTask);
         updateTaskCount();
     }
 }
@@ -223,8 +256,19 @@ void kmemo::onToggleDetailPanel()
 
 void kmemo::onSearchTextChanged(const QString &text)
 {
-    // 临时实现
-    Q_UNUSED(text)
+    // 结果列表尚未接入界面，暂时只显示匹配数
+    m_searchResults.clear();
+    if (!m_searchIndex || text.trimmed().isEmpty()) {
+        updateStatusBar();
+        return;
+    }
+
+    const QVector<TaskSearchIndex::Hit> hits = m_searchIndex->search(text);
+    m_searchResults.reserve(hits.size());
+    for (const TaskSearchIndex::Hit& hit : hits) {
+        m_searchResults.append(hit.taskId);
+    }
+    statusBar()->showMessage(tr("%n match(es)", nullptr, m_searchResults.size()));
 }
 
 void kmemo::setupFramelessWindow()
@@ -13,6 +13,10 @@
 #include <QPushButton>
 #include "models/taskmodel.h"
 
+class UndoManager;
+class TaskSearchIndex;
+class DependencyGraph;
+
 QT_BEGIN_NAMESPACE
 namespace Ui {
 class kmemo;
@@ -89,6 +93,10 @@ private:
 
     // 数据模型
     TaskModel *m_taskModel;
+    UndoManager *m_undoManager;     // 撤销/重做历史
+    TaskSearchIndex *m_searchIndex; // 标题/标签搜索索引
+    DependencyGraph *m_dependencyGraph; // 阻塞关系与可开始的任务
+    QVector<TaskId> m_searchResults;
 
     // UI组件引用（来自ui文件）
     QStackedWidget *m_contentStack;
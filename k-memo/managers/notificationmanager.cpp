@@ -34,7 +34,7 @@ void NotificationManager::scheduleTaskReminder(const Task& task)
     // Calculate reminder time
     QDateTime reminderTime = task.dueTime().addSecs(-task.reminderMinutes() * 60);
     
-    if (reminderTime <= QDateTime::currentDateTime()) {
+    if (reminderTime.toMSecsSinceEpoch() <= TaskClock::currentMSecsSinceEpoch()) {
         // If reminder time has passed, show notification immediately
         showTaskDueNotification(task);
         return;
@@ -52,7 +52,7 @@ void NotificationManager::scheduleTaskReminder(const Task& task)
     addNotification(item);
 }
 
-void NotificationManager::cancelTaskReminder(const QString& taskId)
+void NotificationManager::cancelTaskReminder(const TaskId& taskId)
 {
     removeNotification(taskId);
 }
@@ -104,14 +104,15 @@ void NotificationManager::onTaskUpdated(const Task& task)
     updateTaskReminder(task);
 }
 
-void NotificationManager::onTaskDeleted(const QString& taskId)
+void NotificationManager::onTaskDeleted(const TaskId& taskId)
 {
     cancelTaskReminder(taskId);
 }
 
 void NotificationManager::processNotifications()
 {
-    QDateTime currentTime = QDateTime::currentDateTime();
+    // One clock reading for the whole scan
+    const qint64 nowMs = TaskClock::currentMSecsSinceEpoch();
     
     for (auto it = m_notifications.begin(); it != m_notifications.end();) {
         NotificationItem& item = *it;
@@ -121,14 +122,14 @@ void NotificationManager::processNotifications()
             continue;
         }
         
-        if (item.scheduledTime <= currentTime) {
+        if (item.scheduledTime.toMSecsSinceEpoch() <= nowMs) {
             // Show notification
             showTaskNotification(item.title, item.message, QSystemTrayIcon::Information);
             emit notificationShown(item.taskId, item.message);
             
             if (item.isRepeating && item.repeatIntervalMinutes > 0) {
                 // Schedule next repeat
-                item.scheduledTime = currentTime.addSecs(item.repeatIntervalMinutes * 60);
+                item.scheduledTime = QDateTime::fromMSecsSinceEpoch(nowMs + qint64(item.repeatIntervalMinutes) * 60 * 1000);
                 ++it;
             } else {
                 // Remove one-time notification
@@ -145,7 +146,7 @@ void NotificationManager::addNotification(const NotificationItem& item)
     m_notifications.append(item);
 }
 
-void NotificationManager::removeNotification(const QString& taskId)
+void NotificationManager::removeNotification(const TaskId& taskId)
 {
     m_notifications.erase(
         std::remove_if(m_notifications.begin(), m_notifications.end(),
@@ -155,7 +156,7 @@ void NotificationManager::removeNotification(const QString& taskId)
         m_notifications.end());
 }
 
-NotificationItem* NotificationManager::findNotification(const QString& taskId)
+NotificationItem* NotificationManager::findNotification(const TaskId& taskId)
 {
     for (auto& item : m_notifications) {
         if (item.taskId == taskId) {
@@ -6,12 +6,13 @@
 #include <QDateTime>
 #include <QList>
 #include <QSystemTrayIcon>
+#include "models/taskid.h"
 
 class Task;
 class TrayManager;
 
 struct NotificationItem {
-    QString taskId;
+    TaskId taskId;
     QString title;
     QString message;
     QDateTime scheduledTime;
@@ -32,7 +33,7 @@ public:
     
     // Notification scheduling
     void scheduleTaskReminder(const Task& task);
-    void cancelTaskReminder(const QString& taskId);
+    void cancelTaskReminder(const TaskId& taskId);
     void updateTaskReminder(const Task& task);
     
     // Immediate notifications
@@ -58,19 +59,19 @@ public:
 public slots:
     void checkPendingNotifications();
     void onTaskUpdated(const Task& task);
-    void onTaskDeleted(const QString& taskId);
+    void onTaskDeleted(const TaskId& taskId);
 
 signals:
-    void notificationShown(const QString& taskId, const QString& message);
-    void reminderTriggered(const QString& taskId);
+    void notificationShown(const TaskId& taskId, const QString& message);
+    void reminderTriggered(const TaskId& taskId);
 
 private slots:
     void processNotifications();
 
 private:
     void addNotification(const NotificationItem& item);
-    void removeNotification(const QString& taskId);
-    NotificationItem* findNotification(const QString& taskId);
+    void removeNotification(const TaskId& taskId);
+    NotificationItem* findNotification(const TaskId& taskId);
     void playNotificationSound();
     
     TrayManager* m_trayManager;
@@ -0,0 +1,466 @@
+#include "undomanager.h"
+#include "database/databasemanager.h"
+#include "database/attachmentstore.h"
+#include "models/taskdelta.h"
+#include "models/recurrencerule.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QSet>
+
+// Base of the recorded operations. The manager applies a command once when
+// it is recorded, so the redo() QUndoStack::push() makes right after is
+// skipped.
+class TaskCommand : public QUndoCommand
+{
+public:
+    TaskCommand(UndoManager* manager, const QString& text, QUndoCommand* parent)
+        : QUndoCommand(text, parent)
+        , m_manager(manager)
+        , m_database(manager->m_database)
+        , m_skipRedo(false)
+    {
+    }
+
+    bool applyFirst()
+    {
+        m_skipRedo = forward();
+        return m_skipRedo;
+    }
+
+    void redo() override
+    {
+        if (m_skipRedo) {
+            m_skipRedo = false;
+        } else if (!forward()) {
+            m_manager->noteFailure();
+        }
+    }
+
+    void undo() override
+    {
+        if (!backward()) {
+            m_manager->noteFailure();
+        }
+    }
+
+protected:
+    virtual bool forward() = 0;
+    virtual bool backward() = 0;
+
+    // Copies kept for undo hold long descriptions compressed
+    static Task compactCopy(const Task& task)
+    {
+        Task copy = task;
+        if (!copy.hasCompressedDescription()) {
+            const QString description = copy.description();
+            if (description.toUtf8().size() > DatabaseManager::DESCRIPTION_COMPRESSION_THRESHOLD) {
+                copy.setCompressedDescription(compressDescription(description));
+            }
+        }
+        return copy;
+    }
+
+    UndoManager* m_manager;
+    DatabaseManager* m_database;
+
+private:
+    bool m_skipRedo;
+};
+
+namespace {
+enum CommandId {
+    EditTaskCommandId = 1
+};
+
+class EditTaskCommand : public TaskCommand
+{
+public:
+    EditTaskCommand(UndoManager* manager, const TaskId& taskId, const TaskDelta& delta, QUndoCommand* parent)
+        : TaskCommand(manager, delta.fields() == Task::StatusField ? QStringLiteral("Change task status")
+                                                                   : QStringLiteral("Edit task"), parent)
+        , m_taskId(taskId)
+        , m_delta(delta)
+    {
+    }
+
+    int id() const override { return EditTaskCommandId; }
+
+    bool mergeWith(const QUndoCommand* other) override
+    {
+        // A completion that spawned a recurring task's next instance stays
+        // a step of its own, so undoing it can take the instance back
+        const EditTaskCommand* next = static_cast<const EditTaskCommand*>(other);
+        if (next->m_taskId != m_taskId || !m_spawnedId.isNull() || !next->m_spawnedId.isNull()
+            || !m_delta.mergeWith(next->m_delta)) {
+            return false;
+        }
+        // Edited back to where it started
+        setObsolete(m_delta.isEmpty());
+        return true;
+    }
+
+protected:
+    bool forward() override { return change(true); }
+    bool backward() override { return change(false); }
+
+private:
+    bool change(bool forward)
+    {
+        Task task = m_database->getTask(m_taskId);
+        if (task.id().isNull() || !(forward ? m_delta.apply(&task) : m_delta.revert(&task))) {
+            qWarning() << "Task changed outside the undo history:" << m_taskId.toString();
+            return false;
+        }
+
+        if (!forward && !m_spawnedId.isNull()) {
+            // Completing the task handed its rule on to a new instance
+            if (!m_database->getTask(m_spawnedId).id().isNull() && !m_database->deleteTask(m_spawnedId)) {
+                return false;
+            }
+            task.setRecurrence(m_rule);
+            m_spawnedId = TaskId();
+        }
+
+        // Undo returns to a state the task was in, which the transition
+        // rules may not lead back to
+        const RecurrenceRule rule = task.recurrence();
+        if (forward ? !m_database->updateTask(task, &m_spawnedId) : !m_database->restoreTask(task)) {
+            return false;
+        }
+        if (!m_spawnedId.isNull()) {
+            m_rule = rule;
+        }
+        return true;
+    }
+
+    TaskId m_taskId;
+    TaskDelta m_delta;
+    TaskId m_spawnedId;         // Next instance the last apply created
+    RecurrenceRule m_rule;      // The rule it took from this task
+};
+
+class AddTaskCommand : public TaskCommand
+{
+public:
+    AddTaskCommand(UndoManager* manager, const Task& task, QUndoCommand* parent)
+        : TaskCommand(manager, QStringLiteral("Add task"), parent)
+        , m_task(compactCopy(task))
+    {
+    }
+
+protected:
+    bool forward() override { return m_database->insertTask(m_task); }
+    bool backward() override { return m_database->deleteTask(m_task.id()); }
+
+private:
+    Task m_task;
+};
+
+// Deleting a task takes its subtasks, dependency edges and attachments with
+// it; all of them are captured so undo can put the subtree back as it was.
+// Attachment content is held only while the delete is the applied state.
+class RemoveTaskCommand : public TaskCommand
+{
+public:
+    RemoveTaskCommand(UndoManager* manager, const TaskId& taskId, QUndoCommand* parent)
+        : TaskCommand(manager, QStringLiteral("Delete task"), parent)
+        , m_taskId(taskId)
+    {
+    }
+
+protected:
+    bool forward() override
+    {
+        const Task task = m_database->getTask(m_taskId);
+        if (task.id().isNull()) {
+            return false;
+        }
+
+        // Root first, then by depth, so parents exist before their children
+        m_tasks.clear();
+        m_parents.clear();
+        m_tasks.append(compactCopy(task));
+        for (const Task& descendant : m_database->getDescendantTasks(m_taskId)) {
+            m_tasks.append(compactCopy(descendant));
+        }
+
+        QSet<TaskId> ids;
+        for (const Task& removed : qAsConst(m_tasks)) {
+            ids.insert(removed.id());
+            m_parents.append(m_database->getParentTask(removed.id()));
+        }
+
+        m_dependencies.clear();
+        for (const auto& edge : m_database->getAllTaskDependencies()) {
+            if (ids.contains(edge.first) || ids.contains(edge.second)) {
+                m_dependencies.append(edge);
+            }
+        }
+
+        AttachmentStore* store = m_database->attachmentStore();
+        m_attachments.clear();
+        for (const Task& removed : qAsConst(m_tasks)) {
+            for (const TaskAttachment& attachment : store->attachmentsForTask(removed.id())) {
+                AttachmentCopy copy;
+                copy.attachment = attachment;
+                QBuffer buffer(&copy.content);
+                if (!buffer.open(QIODevice::WriteOnly) || !store->readAttachment(attachment.id, &buffer)) {
+                    return false;
+                }
+                buffer.close();
+                m_attachments.append(copy);
+            }
+        }
+
+        return m_database->deleteTask(m_taskId);
+    }
+
+    bool backward() override
+    {
+        for (const Task& task : qAsConst(m_tasks)) {
+            if (!m_database->insertTask(task)) {
+                return false;
+            }
+        }
+        for (int i = 0; i < m_tasks.size(); ++i) {
+            if (!m_parents.at(i).isNull() && !m_database->setTaskParent(m_tasks.at(i).id(), m_parents.at(i))) {
+                return false;
+            }
+        }
+        for (const auto& edge : qAsConst(m_dependencies)) {
+            if (!m_database->addTaskDependency(edge.first, edge.second)) {
+                return false;
+            }
+        }
+
+        AttachmentStore* store = m_database->attachmentStore();
+        for (AttachmentCopy& copy : m_attachments) {
+            QBuffer buffer(&copy.content);
+            if (!buffer.open(QIODevice::ReadOnly) || !store->restoreAttachment(copy.attachment, &buffer)) {
+                return false;
+            }
+        }
+        // Redo reads them back from the database
+        m_attachments.clear();
+        return true;
+    }
+
+private:
+    struct AttachmentCopy {
+        TaskAttachment attachment;
+        QByteArray content;
+    };
+
+    TaskId m_taskId;
+    QVector<Task> m_tasks;
+    QVector<TaskId> m_parents;      // Parallel to m_tasks
+    QVector<QPair<TaskId, TaskId>> m_dependencies;
+    QVector<AttachmentCopy> m_attachments;
+};
+}
+
+UndoManager::UndoManager(QObject *parent)
+    : QObject(parent)
+    , m_database(DatabaseManager::instance())
+    , m_stack(new QUndoStack(this))
+    , m_group(nullptr)
+    , m_groupDepth(0)
+    , m_failed(false)
+{
+    m_stack->setUndoLimit(UNDO_LIMIT);
+}
+
+bool UndoManager::addTask(const Task& task)
+{
+    if (!task.isValid()) {
+        return false;
+    }
+    return record(new AddTaskCommand(this, task, m_group));
+}
+
+bool UndoManager::updateTask(const Task& task)
+{
+    const Task stored = m_database->getTask(task.id());
+    if (stored.id().isNull()) {
+        return false;
+    }
+
+    const TaskDelta delta = TaskDelta::between(stored, task);
+    if (delta.isEmpty()) {
+        return true;
+    }
+    return record(new EditTaskCommand(this, task.id(), delta, m_group));
+}
+
+bool UndoManager::setTaskStatus(const TaskId& taskId, TaskStatus status)
+{
+    Task task = m_database->getTask(taskId);
+    if (task.id().isNull()) {
+        return false;
+    }
+
+    task.setStatus(status);
+    return updateTask(task);
+}
+
+bool UndoManager::removeTask(const TaskId& taskId)
+{
+    if (attachmentBytes(taskId) <= MAX_UNDO_ATTACHMENT_BYTES) {
+        return record(new RemoveTaskCommand(this, taskId, m_group));
+    }
+
+    // Too much to keep for undo. Alone it is deleted for good, and the
+    // steps before it, which may need the task, go with it; a group can't
+    // be left half undoable, so there it fails.
+    if (m_group) {
+        qWarning() << "Attachments too large to delete as part of a group:" << taskId.toString();
+        m_failed = true;
+        return false;
+    }
+    if (!runStep(QStringLiteral("Delete task"), [this, taskId]() {
+            if (!m_database->deleteTask(taskId)) {
+                noteFailure();
+            }
+        })) {
+        return false;
+    }
+    m_stack->clear();
+    return true;
+}
+
+void UndoManager::beginGroup(const QString& text)
+{
+    if (m_groupDepth++ > 0) {
+        return;
+    }
+
+    // The group's transaction and batch stay open until endGroup()
+    m_failed = false;
+    m_group = new QUndoCommand(text);
+    m_database->beginBatch();
+    if (!m_database->beginTransaction()) {
+        m_failed = true;
+    }
+}
+
+bool UndoManager::endGroup()
+{
+    if (m_groupDepth == 0) {
+        qWarning() << "UndoManager::endGroup() without beginGroup()";
+        return false;
+    }
+    if (--m_groupDepth > 0) {
+        return !m_failed;
+    }
+
+    QUndoCommand* group = m_group;
+    m_group = nullptr;
+    const QString text = group->text();
+
+    bool ok = !m_failed;
+    if (ok) {
+        ok = m_database->commitTransaction();
+    } else if (m_database->inTransaction()) {
+        m_database->rollbackTransaction();
+    }
+
+    if (ok && group->childCount() > 0) {
+        m_stack->push(group);
+    } else {
+        delete group;
+    }
+    m_database->endBatch();
+
+    if (!ok) {
+        emit operationFailed(text);
+    }
+    return ok;
+}
+
+bool UndoManager::undo()
+{
+    if (isGrouping() || !m_stack->canUndo()) {
+        return false;
+    }
+
+    const QString text = m_stack->undoText();
+    if (!runStep(text, [this]() { m_stack->undo(); })) {
+        // The stack has moved past a step the database didn't take
+        m_stack->clear();
+        return false;
+    }
+    return true;
+}
+
+bool UndoManager::redo()
+{
+    if (isGrouping() || !m_stack->canRedo()) {
+        return false;
+    }
+
+    const QString text = m_stack->redoText();
+    if (!runStep(text, [this]() { m_stack->redo(); })) {
+        m_stack->clear();
+        return false;
+    }
+    return true;
+}
+
+qint64 UndoManager::attachmentBytes(const TaskId& taskId) const
+{
+    AttachmentStore* store = m_database->attachmentStore();
+    qint64 bytes = store->attachmentBytes(taskId);
+    for (const Task& descendant : m_database->getDescendantTasks(taskId)) {
+        bytes += store->attachmentBytes(descendant.id());
+    }
+    return bytes;
+}
+
+bool UndoManager::record(TaskCommand* command)
+{
+    // Inside a group the command is a child of the group and runs in the
+    // group's transaction
+    if (m_group) {
+        if (!command->applyFirst()) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    if (!runStep(command->text(), [this, command]() {
+            if (!command->applyFirst()) {
+                noteFailure();
+            }
+        })) {
+        delete command;
+        return false;
+    }
+
+    m_stack->push(command);
+    return true;
+}
+
+bool UndoManager::runStep(const QString& text, const std::function<void()>& step)
+{
+    TaskChangeBatch batch(m_database);
+
+    m_failed = false;
+    if (!m_database->beginTransaction()) {
+        emit operationFailed(text);
+        return false;
+    }
+
+    step();
+
+    if (m_failed) {
+        m_database->rollbackTransaction();
+        emit operationFailed(text);
+        return false;
+    }
+    if (!m_database->commitTransaction()) {
+        emit operationFailed(text);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef UNDOMANAGER_H
+#define UNDOMANAGER_H
+
+#include <QObject>
+#include <QUndoStack>
+#include <functional>
+#include "models/task.h"
+
+class DatabaseManager;
+class TaskCommand;
+
+// Undoable task edits on top of DatabaseManager.
+//
+// Each operation is applied right away and recorded on a QUndoStack.
+// Edits are recorded as TaskDeltas, not Task copies. Consecutive edits of
+// the same fields of one task merge into a single step. Operations between
+// beginGroup() and endGroup() form one step. Every step, whether applied,
+// undone or redone, runs in one database transaction and one change batch.
+// On failure the transaction is rolled back and the history is cleared.
+//
+// Undoing a delete needs the deleted attachments' content, which is kept in
+// memory. Deleting a subtree with more than MAX_UNDO_ATTACHMENT_BYTES of
+// attachments is not undoable: it clears the history, or fails in a group.
+class UndoManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 MAX_UNDO_ATTACHMENT_BYTES = 64 * 1024 * 1024;
+
+    explicit UndoManager(QObject *parent = nullptr);
+
+    QUndoStack* stack() const { return m_stack; }
+
+    bool addTask(const Task& task);
+    bool updateTask(const Task& task);
+    bool setTaskStatus(const TaskId& taskId, TaskStatus status);
+    bool removeTask(const TaskId& taskId);
+
+    // Groups nest; the outermost endGroup() closes the step
+    void beginGroup(const QString& text);
+    bool endGroup();
+    bool isGrouping() const { return m_groupDepth > 0; }
+
+    bool undo();
+    bool redo();
+
+signals:
+    void operationFailed(const QString& text);
+
+private:
+    friend class TaskCommand;
+
+    bool record(TaskCommand* command);
+    bool runStep(const QString& text, const std::function<void()>& step);
+    qint64 attachmentBytes(const TaskId& taskId) const;
+    void noteFailure() { m_failed = true; }
+
+    DatabaseManager* m_database;
+    QUndoStack* m_stack;
+    QUndoCommand* m_group;          // Open group, parent of its commands
+    int m_groupDepth;
+    bool m_failed;                  // Set by a command that couldn't apply
+
+    static const int UNDO_LIMIT = 200;
+};
+
+#endif // UNDOMANAGER_H
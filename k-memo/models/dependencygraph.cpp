@@ -0,0 +1,397 @@
+#include "dependencygraph.h"
+#include "database/databasemanager.h"
+#include <QDebug>
+#include <algorithm>
+
+DependencyGraph::DependencyGraph(QObject *parent)
+    : QObject(parent)
+    , m_nextOrder(0)
+    , m_database(DatabaseManager::instance())
+{
+    connect(m_database, &DatabaseManager::taskInserted, this, &DependencyGraph::onTaskInserted);
+    connect(m_database, &DatabaseManager::taskUpdated, this, &DependencyGraph::onTaskUpdated);
+    connect(m_database, &DatabaseManager::taskDeleted, this, &DependencyGraph::onTaskDeleted);
+    connect(m_database, &DatabaseManager::taskDependencyAdded, this, &DependencyGraph::onDependencyAdded);
+    connect(m_database, &DatabaseManager::taskDependencyRemoved, this, &DependencyGraph::onDependencyRemoved);
+    connect(m_database, &DatabaseManager::changesRolledBack, this, &DependencyGraph::reload);
+
+    reload();
+}
+
+bool DependencyGraph::addDependency(const TaskId& taskId, const TaskId& blockerId)
+{
+    const int dependent = m_index.value(taskId, -1);
+    const int blocker = m_index.value(blockerId, -1);
+    if (dependent < 0 || blocker < 0) {
+        return false;
+    }
+
+    if (m_nodes.at(dependent).blockers.contains(blocker)) {
+        return true;
+    }
+
+    // Applied in memory first so the database signal finds it already there
+    if (!insertEdge(blocker, dependent)) {
+        return false;
+    }
+
+    if (!m_database->addTaskDependency(taskId, blockerId)) {
+        eraseEdge(blocker, dependent);
+        return false;
+    }
+    return true;
+}
+
+bool DependencyGraph::removeDependency(const TaskId& taskId, const TaskId& blockerId)
+{
+    return m_database->removeTaskDependency(taskId, blockerId);
+}
+
+bool DependencyGraph::wouldCreateCycle(const TaskId& taskId, const TaskId& blockerId) const
+{
+    const int dependent = m_index.value(taskId, -1);
+    const int blocker = m_index.value(blockerId, -1);
+    if (dependent < 0 || blocker < 0) {
+        return false;
+    }
+    if (dependent == blocker) {
+        return true;
+    }
+
+    // Blockers come first in the order, so an edge that agrees with it
+    // can't close a cycle
+    const int upperOrder = m_nodes.at(blocker).order;
+    if (upperOrder < m_nodes.at(dependent).order) {
+        return false;
+    }
+
+    QVector<int> visited;
+    return reachableWithin(dependent, blocker, upperOrder, &visited);
+}
+
+QVector<TaskId> DependencyGraph::readyTasks() const
+{
+    QVector<TaskId> tasks;
+    tasks.reserve(m_ready.size());
+    for (int node : m_ready) {
+        tasks.append(m_nodes.at(node).id);
+    }
+    return tasks;
+}
+
+bool DependencyGraph::isReady(const TaskId& taskId) const
+{
+    const int node = m_index.value(taskId, -1);
+    return node >= 0 && m_nodes.at(node).readyIndex >= 0;
+}
+
+bool DependencyGraph::isBlocked(const TaskId& taskId) const
+{
+    const int node = m_index.value(taskId, -1);
+    return node >= 0 && m_nodes.at(node).openBlockers > 0;
+}
+
+QVector<TaskId> DependencyGraph::blockers(const TaskId& taskId) const
+{
+    QVector<TaskId> ids;
+    const int node = m_index.value(taskId, -1);
+    if (node >= 0) {
+        for (int blocker : m_nodes.at(node).blockers) {
+            ids.append(m_nodes.at(blocker).id);
+        }
+    }
+    return ids;
+}
+
+QVector<TaskId> DependencyGraph::dependents(const TaskId& taskId) const
+{
+    QVector<TaskId> ids;
+    const int node = m_index.value(taskId, -1);
+    if (node >= 0) {
+        for (int dependent : m_nodes.at(node).dependents) {
+            ids.append(m_nodes.at(dependent).id);
+        }
+    }
+    return ids;
+}
+
+void DependencyGraph::reload()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_index.clear();
+    m_ready.clear();
+    m_visited.clear();
+    m_nextOrder = 0;
+
+    const QHash<TaskId, TaskStatus> statuses = m_database->getTaskStatuses();
+    m_nodes.reserve(statuses.size());
+    for (auto it = statuses.constBegin(); it != statuses.constEnd(); ++it) {
+        addNode(it.key(), it.value());
+    }
+
+    const QVector<QPair<TaskId, TaskId>> edges = m_database->getAllTaskDependencies();
+    for (const auto& edge : edges) {
+        onDependencyAdded(edge.first, edge.second);
+    }
+}
+
+void DependencyGraph::onTaskInserted(const Task& task)
+{
+    if (!m_index.contains(task.id())) {
+        addNode(task.id(), task.status());
+    }
+}
+
+void DependencyGraph::onTaskUpdated(const Task& task, Task::Fields changedFields)
+{
+    if (!(changedFields & Task::StatusField)) {
+        return;
+    }
+
+    const int node = m_index.value(task.id(), -1);
+    if (node >= 0) {
+        setDone(node, isDoneStatus(task.status()));
+    }
+}
+
+void DependencyGraph::onTaskDeleted(const TaskId& taskId)
+{
+    const int node = m_index.value(taskId, -1);
+    if (node >= 0) {
+        removeNode(node);
+    }
+}
+
+void DependencyGraph::onDependencyAdded(const TaskId& taskId, const TaskId& blockerId)
+{
+    const int dependent = m_index.value(taskId, -1);
+    const int blocker = m_index.value(blockerId, -1);
+    if (dependent < 0 || blocker < 0 || m_nodes.at(dependent).blockers.contains(blocker)) {
+        return;
+    }
+
+    // The database refuses cycles, so this only happens with edges stored
+    // before it did
+    if (!insertEdge(blocker, dependent)) {
+        qWarning() << "Ignoring cyclic task dependency:" << taskId.toString()
+                   << "blocked by" << blockerId.toString();
+    }
+}
+
+void DependencyGraph::onDependencyRemoved(const TaskId& taskId, const TaskId& blockerId)
+{
+    const int dependent = m_index.value(taskId, -1);
+    const int blocker = m_index.value(blockerId, -1);
+    if (dependent >= 0 && blocker >= 0) {
+        eraseEdge(blocker, dependent);
+    }
+}
+
+bool DependencyGraph::isDoneStatus(TaskStatus status)
+{
+    return status == TaskStatus::Completed || status == TaskStatus::Cancelled;
+}
+
+int DependencyGraph::addNode(const TaskId& taskId, TaskStatus status)
+{
+    int node;
+    if (!m_freeNodes.isEmpty()) {
+        node = m_freeNodes.takeLast();
+        m_nodes[node] = Node();
+    } else {
+        node = m_nodes.size();
+        m_nodes.append(Node());
+        m_visited.append(false);
+    }
+
+    Node& entry = m_nodes[node];
+    entry.id = taskId;
+    entry.order = m_nextOrder++;
+    entry.done = isDoneStatus(status);
+    entry.alive = true;
+    m_index.insert(taskId, node);
+
+    updateReady(node);
+    return node;
+}
+
+void DependencyGraph::removeNode(int node)
+{
+    const QVector<int> blockers = m_nodes.at(node).blockers;
+    for (int blocker : blockers) {
+        eraseEdge(blocker, node);
+    }
+    const QVector<int> dependents = m_nodes.at(node).dependents;
+    for (int dependent : dependents) {
+        eraseEdge(node, dependent);
+    }
+
+    m_nodes[node].alive = false;
+    updateReady(node);
+
+    m_index.remove(m_nodes.at(node).id);
+    m_freeNodes.append(node);
+}
+
+bool DependencyGraph::insertEdge(int blocker, int dependent)
+{
+    if (blocker == dependent) {
+        return false;
+    }
+
+    const int lowerOrder = m_nodes.at(dependent).order;
+    const int upperOrder = m_nodes.at(blocker).order;
+
+    // Out of order: search only the tasks ordered between the two ends.
+    // Reaching the blocker from the dependent means the edge closes a cycle.
+    if (lowerOrder < upperOrder) {
+        QVector<int> forward;
+        if (reachableWithin(dependent, blocker, upperOrder, &forward)) {
+            qWarning() << "Dependency rejected, it would create a cycle:"
+                       << m_nodes.at(dependent).id.toString() << "<-" << m_nodes.at(blocker).id.toString();
+            return false;
+        }
+
+        QVector<int> backward;
+        collectBackward(blocker, lowerOrder, &backward);
+        reorder(backward, forward);
+    }
+
+    m_nodes[blocker].dependents.append(dependent);
+    m_nodes[dependent].blockers.append(blocker);
+    if (!m_nodes.at(blocker).done) {
+        ++m_nodes[dependent].openBlockers;
+        updateReady(dependent);
+    }
+    return true;
+}
+
+void DependencyGraph::eraseEdge(int blocker, int dependent)
+{
+    if (!m_nodes[blocker].dependents.removeOne(dependent)) {
+        return;
+    }
+    m_nodes[dependent].blockers.removeOne(blocker);
+
+    if (!m_nodes.at(blocker).done) {
+        --m_nodes[dependent].openBlockers;
+        updateReady(dependent);
+    }
+}
+
+bool DependencyGraph::reachableWithin(int from, int target, int upperOrder, QVector<int>* visited) const
+{
+    bool found = false;
+    QVector<int> stack{from};
+    m_visited[from] = true;
+    visited->append(from);
+
+    while (!stack.isEmpty() && !found) {
+        const int node = stack.takeLast();
+        for (int next : m_nodes.at(node).dependents) {
+            if (next == target) {
+                found = true;
+                break;
+            }
+            if (!m_visited.at(next) && m_nodes.at(next).order < upperOrder) {
+                m_visited[next] = true;
+                visited->append(next);
+                stack.append(next);
+            }
+        }
+    }
+
+    for (int node : *visited) {
+        m_visited[node] = false;
+    }
+    return found;
+}
+
+void DependencyGraph::collectBackward(int from, int lowerOrder, QVector<int>* visited) const
+{
+    QVector<int> stack{from};
+    m_visited[from] = true;
+    visited->append(from);
+
+    while (!stack.isEmpty()) {
+        const int node = stack.takeLast();
+        for (int previous : m_nodes.at(node).blockers) {
+            if (!m_visited.at(previous) && m_nodes.at(previous).order > lowerOrder) {
+                m_visited[previous] = true;
+                visited->append(previous);
+                stack.append(previous);
+            }
+        }
+    }
+
+    for (int node : *visited) {
+        m_visited[node] = false;
+    }
+}
+
+void DependencyGraph::reorder(QVector<int> backward, QVector<int> forward)
+{
+    // The affected tasks keep the same pool of order values; the blocker
+    // side takes the lowest ones, each side keeping its relative order
+    auto byOrder = [this](int a, int b) { return m_nodes.at(a).order < m_nodes.at(b).order; };
+    std::sort(backward.begin(), backward.end(), byOrder);
+    std::sort(forward.begin(), forward.end(), byOrder);
+
+    QVector<int> orders;
+    orders.reserve(backward.size() + forward.size());
+    for (int node : qAsConst(backward)) {
+        orders.append(m_nodes.at(node).order);
+    }
+    for (int node : qAsConst(forward)) {
+        orders.append(m_nodes.at(node).order);
+    }
+    std::sort(orders.begin(), orders.end());
+
+    int next = 0;
+    for (int node : qAsConst(backward)) {
+        m_nodes[node].order = orders.at(next++);
+    }
+    for (int node : qAsConst(forward)) {
+        m_nodes[node].order = orders.at(next++);
+    }
+}
+
+void DependencyGraph::setDone(int node, bool done)
+{
+    if (m_nodes.at(node).done == done) {
+        return;
+    }
+
+    m_nodes[node].done = done;
+    const QVector<int> dependents = m_nodes.at(node).dependents;
+    for (int dependent : dependents) {
+        m_nodes[dependent].openBlockers += done ? -1 : 1;
+        updateReady(dependent);
+    }
+    updateReady(node);
+}
+
+void DependencyGraph::updateReady(int node)
+{
+    Node& entry = m_nodes[node];
+    const bool ready = entry.alive && !entry.done && entry.openBlockers == 0;
+    if (ready == (entry.readyIndex >= 0)) {
+        return;
+    }
+
+    if (ready) {
+        entry.readyIndex = m_ready.size();
+        m_ready.append(node);
+    } else {
+        // Swap with the last slot so removal stays O(1)
+        const int last = m_ready.takeLast();
+        if (last != node) {
+            m_ready[entry.readyIndex] = last;
+            m_nodes[last].readyIndex = entry.readyIndex;
+        }
+        entry.readyIndex = -1;
+    }
+
+    emit readyChanged(entry.id, ready);
+}
@@ -0,0 +1,87 @@
+#ifndef DEPENDENCYGRAPH_H
+#define DEPENDENCYGRAPH_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include "task.h"
+
+class DatabaseManager;
+
+// In-memory "blocked by" graph over all tasks, kept in sync with the
+// database signals.
+//
+// Cycles are caught when an edge is added, without a full search: the
+// graph keeps a topological order (Pearce-Kelly), and an edge that already
+// agrees with it is accepted in O(1). Otherwise only the tasks ordered
+// between its two ends are visited, and they are reordered in place.
+//
+// The ready set (open tasks whose blockers are all completed or cancelled)
+// is maintained from per-task counts of open blockers, so readyTasks()
+// costs O(result) and a status change only touches the task's dependents.
+class DependencyGraph : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DependencyGraph(QObject *parent = nullptr);
+
+    // Stores the edge if it keeps the graph acyclic
+    bool addDependency(const TaskId& taskId, const TaskId& blockerId);
+    bool removeDependency(const TaskId& taskId, const TaskId& blockerId);
+    bool wouldCreateCycle(const TaskId& taskId, const TaskId& blockerId) const;
+
+    QVector<TaskId> readyTasks() const;
+    bool isReady(const TaskId& taskId) const;
+    bool isBlocked(const TaskId& taskId) const;
+    QVector<TaskId> blockers(const TaskId& taskId) const;
+    QVector<TaskId> dependents(const TaskId& taskId) const;
+
+    void reload();
+
+public slots:
+    void onTaskInserted(const Task& task);
+    void onTaskUpdated(const Task& task, Task::Fields changedFields = Task::AllFields);
+    void onTaskDeleted(const TaskId& taskId);
+    void onDependencyAdded(const TaskId& taskId, const TaskId& blockerId);
+    void onDependencyRemoved(const TaskId& taskId, const TaskId& blockerId);
+
+signals:
+    void readyChanged(const TaskId& taskId, bool ready);
+
+private:
+    struct Node {
+        TaskId id;
+        int order = 0;              // Position in the topological order
+        int openBlockers = 0;       // Blockers not yet completed or cancelled
+        int readyIndex = -1;        // Slot in m_ready, -1 when not ready
+        bool done = false;
+        bool alive = false;
+        QVector<int> blockers;      // Incoming edges
+        QVector<int> dependents;    // Outgoing edges
+    };
+
+    static bool isDoneStatus(TaskStatus status);
+
+    int addNode(const TaskId& taskId, TaskStatus status);
+    void removeNode(int node);
+    bool insertEdge(int blocker, int dependent);
+    void eraseEdge(int blocker, int dependent);
+    bool reachableWithin(int from, int target, int upperOrder, QVector<int>* visited) const;
+    void collectBackward(int from, int lowerOrder, QVector<int>* visited) const;
+    void reorder(QVector<int> backward, QVector<int> forward);
+    void setDone(int node, bool done);
+    void updateReady(int node);
+
+    QVector<Node> m_nodes;
+    QVector<int> m_freeNodes;
+    QHash<TaskId, int> m_index;
+    QVector<int> m_ready;           // Node indexes, unordered
+    int m_nextOrder;
+    DatabaseManager* m_database;
+
+    // Scratch marks for the bounded searches, reset after each use
+    mutable QVector<bool> m_visited;
+};
+
+#endif // DEPENDENCYGRAPH_H
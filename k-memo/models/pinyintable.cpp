@@ -0,0 +1,199 @@
+#include "pinyintable.h"
+#include <QFile>
+#include <QDebug>
+
+PinyinTable::PinyinTable()
+    : m_readings(LAST_CODE_POINT - FIRST_CODE_POINT + 1, 0)
+{
+    if (!load(QStringLiteral(":/data/data/pinyin.txt"))) {
+        qWarning() << "Pinyin search is unavailable";
+    }
+}
+
+PinyinTable* PinyinTable::instance()
+{
+    static PinyinTable table;
+    return &table;
+}
+
+bool PinyinTable::load(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open pinyin table:" << path << file.errorString();
+        return false;
+    }
+
+    // "syllable<TAB>characters" per line; '#' starts a comment. The first
+    // line a character is on gives its main reading.
+    QHash<QString, quint16> syllableIds;
+    const QStringList lines = QString::fromUtf8(file.readAll()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    for (const QString& line : lines) {
+        if (line.startsWith(QLatin1Char('#'))) {
+            continue;
+        }
+
+        const int tab = line.indexOf(QLatin1Char('\t'));
+        if (tab <= 0) {
+            qWarning() << "Malformed pinyin table line:" << line;
+            continue;
+        }
+
+        const QString syllable = line.left(tab);
+        quint16& reading = syllableIds[syllable];
+        if (reading == 0) {
+            m_syllables.append(syllable);
+            reading = static_cast<quint16>(m_syllables.size());
+        }
+
+        for (QChar ch : line.mid(tab + 1)) {
+            if (ch.unicode() < FIRST_CODE_POINT || ch.unicode() > LAST_CODE_POINT) {
+                continue;
+            }
+            quint16& main = m_readings[ch.unicode() - FIRST_CODE_POINT];
+            if (main == 0) {
+                main = reading;
+            } else if (main != reading) {
+                QVector<quint16>& others = m_otherReadings[ch.unicode()];
+                if (!others.contains(reading)) {
+                    others.append(reading);
+                }
+            }
+        }
+    }
+    return isLoaded();
+}
+
+QString PinyinTable::syllable(QChar ch) const
+{
+    if (ch.unicode() < FIRST_CODE_POINT || ch.unicode() > LAST_CODE_POINT) {
+        return QString();
+    }
+
+    const quint16 reading = m_readings.at(ch.unicode() - FIRST_CODE_POINT);
+    return reading ? m_syllables.at(reading - 1) : QString();
+}
+
+QStringList PinyinTable::syllables(QChar ch) const
+{
+    QStringList readings;
+    const QString main = syllable(ch);
+    if (main.isEmpty()) {
+        return readings;
+    }
+
+    readings.append(main);
+    const auto others = m_otherReadings.constFind(ch.unicode());
+    if (others != m_otherReadings.constEnd()) {
+        for (quint16 reading : others.value()) {
+            readings.append(m_syllables.at(reading - 1));
+        }
+    }
+    return readings;
+}
+
+bool PinyinTable::spell(const QString& text, Spelling* spelling) const
+{
+    spelling->pinyin.clear();
+    spelling->initials.clear();
+    spelling->starts.clear();
+
+    bool spelled = false;
+    int i = 0;
+    while (i < text.size()) {
+        const QChar ch = text.at(i);
+        const QString reading = syllable(ch);
+        if (!reading.isEmpty()) {
+            spelling->starts.append(spelling->pinyin.size());
+            spelling->pinyin += reading;
+            spelling->initials += reading.at(0);
+            spelled = true;
+            ++i;
+        } else if (ch.isLetterOrNumber() && ch.script() != QChar::Script_Han) {
+            spelling->starts.append(spelling->pinyin.size());
+            spelling->initials += ch;
+            while (i < text.size() && text.at(i).isLetterOrNumber()
+                   && text.at(i).script() != QChar::Script_Han) {
+                spelling->pinyin += text.at(i++);
+            }
+        } else {
+            ++i;
+        }
+    }
+
+    if (!spelled) {
+        spelling->pinyin.clear();
+        spelling->initials.clear();
+        spelling->starts.clear();
+    }
+    return spelled;
+}
+
+QVector<PinyinTable::Spelling> PinyinTable::spellings(const QString& text, int maxCount) const
+{
+    // The readings of each syllable, split the way spell() splits them
+    QVector<QStringList> syllables;
+    int combinations = 1;
+    bool spelled = false;
+    int i = 0;
+    while (i < text.size()) {
+        const QChar ch = text.at(i);
+        const QStringList readings = this->syllables(ch);
+        if (!readings.isEmpty()) {
+            syllables.append(readings);
+            combinations = qMin(combinations * readings.size(), maxCount + 1);
+            spelled = true;
+            ++i;
+        } else if (ch.isLetterOrNumber() && ch.script() != QChar::Script_Han) {
+            const int start = i;
+            while (i < text.size() && text.at(i).isLetterOrNumber()
+                   && text.at(i).script() != QChar::Script_Han) {
+                ++i;
+            }
+            syllables.append(QStringList(text.mid(start, i - start)));
+        } else {
+            ++i;
+        }
+    }
+
+    QVector<Spelling> result;
+    if (!spelled || maxCount <= 0) {
+        return result;
+    }
+
+    auto append = [&](const QVector<int>& choice) {
+        Spelling spelling;
+        for (int s = 0; s < syllables.size(); ++s) {
+            const QString& reading = syllables.at(s).at(choice.at(s));
+            spelling.starts.append(spelling.pinyin.size());
+            spelling.pinyin += reading;
+            spelling.initials += reading.at(0);
+        }
+        result.append(spelling);
+    };
+
+    QVector<int> choice(syllables.size(), 0);
+    append(choice);
+    if (combinations <= maxCount) {
+        // Every combination, counting through the choices like an odometer
+        for (;;) {
+            int s = syllables.size() - 1;
+            while (s >= 0 && ++choice[s] == syllables.at(s).size()) {
+                choice[s--] = 0;
+            }
+            if (s < 0) {
+                break;
+            }
+            append(choice);
+        }
+    } else {
+        for (int s = 0; s < syllables.size() && result.size() < maxCount; ++s) {
+            for (int other = 1; other < syllables.at(s).size() && result.size() < maxCount; ++other) {
+                choice[s] = other;
+                append(choice);
+            }
+            choice[s] = 0;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef PINYINTABLE_H
+#define PINYINTABLE_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Toneless pinyin of the common CJK ideographs, loaded once from the
+// :/data/data/pinyin.txt resource. Each character has a main reading, which
+// titles sort by, and common polyphonic ones (长 zhang/chang, 行 xing/hang)
+// have others. "v" stands for u-umlaut, the way pinyin input methods spell it.
+class PinyinTable
+{
+public:
+    // A title spelled in pinyin. Runs of other letters and digits are kept
+    // as one syllable each, so mixed titles can be searched as a whole.
+    struct Spelling {
+        QString pinyin;         // Syllables run together
+        QString initials;       // First letter of each syllable
+        QVector<int> starts;    // Offset of each syllable in pinyin
+    };
+
+    static PinyinTable* instance();
+
+    bool isLoaded() const { return !m_syllables.isEmpty(); }
+
+    // The main reading; empty for characters the table doesn't cover
+    QString syllable(QChar ch) const;
+
+    // Every reading, the main one first
+    QStringList syllables(QChar ch) const;
+
+    // Spelled with main readings. Returns false, leaving the spelling empty,
+    // unless the text has at least one ideograph with a reading. Expects
+    // case-folded text.
+    bool spell(const QString& text, Spelling* spelling) const;
+
+    // Up to maxCount ways of reading the text, the main spelling first; empty
+    // when spell() would fail. All combinations if they fit, otherwise each
+    // other reading of one character at a time.
+    QVector<Spelling> spellings(const QString& text, int maxCount) const;
+
+private:
+    PinyinTable();
+    bool load(const QString& path);
+
+    QStringList m_syllables;
+    QVector<quint16> m_readings;    // By code point from FIRST_CODE_POINT, syllable + 1 or 0
+    QHash<ushort, QVector<quint16>> m_otherReadings;    // Of polyphonic characters, syllable + 1
+
+    static const ushort FIRST_CODE_POINT = 0x3400;
+    static const ushort LAST_CODE_POINT = 0x9FFF;
+};
+
+#endif // PINYINTABLE_H
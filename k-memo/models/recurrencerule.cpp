@@ -0,0 +1,274 @@
+#include "recurrencerule.h"
+#include <QStringList>
+
+namespace {
+const int MAX_INTERVAL = 999;
+
+// Enough to reach any day-of-month that exists at all (Feb 29 needs up to
+// eight years at a 12-month interval); beyond it the rule never matches
+const int MAX_MONTHLY_ATTEMPTS = 100;
+
+const char* const WEEKDAY_CODES[] = {"MO", "TU", "WE", "TH", "FR", "SA", "SU"};
+
+qint64 roundUpToMultiple(qint64 value, qint64 multiple)
+{
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+}
+
+RecurrenceRule::RecurrenceRule()
+    : m_interval(1)
+    , m_frequency(NoRecurrence)
+    , m_weekdays(0)
+{
+}
+
+RecurrenceRule::RecurrenceRule(Frequency frequency, int interval)
+    : m_interval(1)
+    , m_frequency(frequency)
+    , m_weekdays(0)
+{
+    setInterval(interval);
+}
+
+void RecurrenceRule::setInterval(int interval)
+{
+    m_interval = static_cast<qint16>(qBound(1, interval, MAX_INTERVAL));
+}
+
+void RecurrenceRule::setWeekday(Qt::DayOfWeek day, bool enabled)
+{
+    if (enabled) {
+        m_weekdays |= weekdayBit(day);
+    } else {
+        m_weekdays &= ~weekdayBit(day);
+    }
+}
+
+QDateTime RecurrenceRule::nextOccurrence(const QDateTime& anchor, const QDateTime& after) const
+{
+    if (!isValid() || !anchor.isValid() || !after.isValid()) {
+        return QDateTime();
+    }
+
+    QDate date = firstDateOnOrAfter(anchor.date(), after.date());
+    if (date.isValid() && QDateTime(date, anchor.time()) <= after) {
+        date = firstDateOnOrAfter(anchor.date(), date.addDays(1));
+    }
+
+    return date.isValid() ? QDateTime(date, anchor.time()) : QDateTime();
+}
+
+QVector<QDateTime> RecurrenceRule::occurrencesBetween(const QDateTime& anchor, const QDateTime& from,
+                                                      const QDateTime& to, int maxCount) const
+{
+    QVector<QDateTime> occurrences;
+
+    if (!isValid() || !anchor.isValid() || !from.isValid() || !to.isValid() || from >= to) {
+        return occurrences;
+    }
+
+    // Jump straight to the window; nothing before it is visited
+    QDate date = firstDateOnOrAfter(anchor.date(), from.date());
+
+    while (date.isValid() && occurrences.size() < maxCount) {
+        QDateTime occurrence(date, anchor.time());
+        if (occurrence >= to) {
+            break;
+        }
+        if (occurrence >= from) {
+            occurrences.append(occurrence);
+        }
+        date = firstDateOnOrAfter(anchor.date(), date.addDays(1));
+    }
+
+    return occurrences;
+}
+
+QDate RecurrenceRule::firstDateOnOrAfter(const QDate& anchor, const QDate& date) const
+{
+    const QDate start = qMax(anchor, date);
+    QDate result;
+
+    switch (m_frequency) {
+    case Daily:
+        result = anchor.addDays(roundUpToMultiple(anchor.daysTo(start), m_interval));
+        break;
+    case Weekly:
+        result = firstWeeklyDate(anchor, start);
+        break;
+    case Monthly:
+        result = firstMonthlyDate(anchor, start);
+        break;
+    case NoRecurrence:
+        break;
+    }
+
+    if (result.isValid() && m_until.isValid() && result > m_until) {
+        return QDate();
+    }
+    return result;
+}
+
+QDate RecurrenceRule::firstWeeklyDate(const QDate& anchor, const QDate& date) const
+{
+    const quint8 weekdays = m_weekdays ? m_weekdays
+                                       : weekdayBit(static_cast<Qt::DayOfWeek>(anchor.dayOfWeek()));
+
+    // Weeks run Monday to Sunday; only every interval-th week from the
+    // anchor's week is active
+    const QDate anchorWeekStart = anchor.addDays(1 - anchor.dayOfWeek());
+    qint64 week = anchorWeekStart.daysTo(date) / 7;
+    QDate day = date;
+
+    // At most two weeks are scanned: the rest of the current active week and,
+    // failing that, the next active week, which contains every selected day
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (week % m_interval != 0) {
+            week = roundUpToMultiple(week, m_interval);
+            day = anchorWeekStart.addDays(week * 7);
+        }
+
+        const QDate weekEnd = anchorWeekStart.addDays(week * 7 + 6);
+        for (; day <= weekEnd; day = day.addDays(1)) {
+            if (weekdays & weekdayBit(static_cast<Qt::DayOfWeek>(day.dayOfWeek()))) {
+                return day;
+            }
+        }
+
+        week += m_interval;
+        day = anchorWeekStart.addDays(week * 7);
+    }
+
+    return QDate();
+}
+
+QDate RecurrenceRule::firstMonthlyDate(const QDate& anchor, const QDate& date) const
+{
+    const int dayOfMonth = anchor.day();
+    qint64 months = (date.year() - anchor.year()) * 12 + (date.month() - anchor.month());
+    months = roundUpToMultiple(qMax<qint64>(months, 0), m_interval);
+
+    for (int attempt = 0; attempt < MAX_MONTHLY_ATTEMPTS; ++attempt, months += m_interval) {
+        QDate monthStart = QDate(anchor.year(), anchor.month(), 1).addMonths(static_cast<int>(months));
+        if (!QDate::isValid(monthStart.year(), monthStart.month(), dayOfMonth)) {
+            continue;   // e.g. the 31st in a 30-day month
+        }
+
+        QDate candidate(monthStart.year(), monthStart.month(), dayOfMonth);
+        if (candidate >= date) {
+            return candidate;
+        }
+    }
+
+    return QDate();
+}
+
+QString RecurrenceRule::toString() const
+{
+    if (!isValid()) {
+        return QString();
+    }
+
+    QStringList parts;
+    switch (m_frequency) {
+    case Daily: parts << "FREQ=DAILY"; break;
+    case Weekly: parts << "FREQ=WEEKLY"; break;
+    case Monthly: parts << "FREQ=MONTHLY"; break;
+    case NoRecurrence: break;
+    }
+
+    if (m_interval > 1) {
+        parts << QString("INTERVAL=%1").arg(m_interval);
+    }
+
+    if (m_frequency == Weekly && m_weekdays) {
+        QStringList days;
+        for (int day = Qt::Monday; day <= Qt::Sunday; ++day) {
+            if (hasWeekday(static_cast<Qt::DayOfWeek>(day))) {
+                days << WEEKDAY_CODES[day - 1];
+            }
+        }
+        parts << "BYDAY=" + days.join(',');
+    }
+
+    if (m_until.isValid()) {
+        parts << "UNTIL=" + m_until.toString("yyyyMMdd");
+    }
+
+    return parts.join(';');
+}
+
+RecurrenceRule RecurrenceRule::fromString(const QString& rule)
+{
+    RecurrenceRule result;
+    if (rule.isEmpty()) {
+        return result;
+    }
+
+    // Anything outside the supported subset is rejected rather than
+    // silently reinterpreted
+    const QStringList parts = rule.split(';', Qt::SkipEmptyParts);
+    for (const QString& part : parts) {
+        const int separator = part.indexOf('=');
+        if (separator <= 0) {
+            return RecurrenceRule();
+        }
+
+        const QString key = part.left(separator).trimmed().toUpper();
+        const QString value = part.mid(separator + 1).trimmed().toUpper();
+
+        if (key == "FREQ") {
+            if (value == "DAILY") {
+                result.m_frequency = Daily;
+            } else if (value == "WEEKLY") {
+                result.m_frequency = Weekly;
+            } else if (value == "MONTHLY") {
+                result.m_frequency = Monthly;
+            } else {
+                return RecurrenceRule();
+            }
+        } else if (key == "INTERVAL") {
+            bool ok = false;
+            int interval = value.toInt(&ok);
+            if (!ok || interval < 1 || interval > MAX_INTERVAL) {
+                return RecurrenceRule();
+            }
+            result.setInterval(interval);
+        } else if (key == "BYDAY") {
+            for (const QString& code : value.split(',', Qt::SkipEmptyParts)) {
+                int day = 0;
+                while (day < 7 && code != WEEKDAY_CODES[day]) {
+                    ++day;
+                }
+                if (day == 7) {
+                    return RecurrenceRule();
+                }
+                result.setWeekday(static_cast<Qt::DayOfWeek>(day + 1));
+            }
+        } else if (key == "UNTIL") {
+            // Date form, or the date part of a date-time form
+            QDate until = QDate::fromString(value.left(8), "yyyyMMdd");
+            if (!until.isValid()) {
+                return RecurrenceRule();
+            }
+            result.m_until = until;
+        } else {
+            return RecurrenceRule();
+        }
+    }
+
+    if (result.m_weekdays && result.m_frequency != Weekly) {
+        return RecurrenceRule();
+    }
+
+    return result;
+}
+
+bool RecurrenceRule::operator==(const RecurrenceRule& other) const
+{
+    return m_frequency == other.m_frequency
+        && m_interval == other.m_interval
+        && m_weekdays == other.m_weekdays
+        && m_until == other.m_until;
+}
@@ -0,0 +1,75 @@
+#ifndef RECURRENCERULE_H
+#define RECURRENCERULE_H
+
+#include <QString>
+#include <QDate>
+#include <QDateTime>
+#include <QVector>
+
+// Recurrence for a task series, a subset of RFC 5545 RRULE:
+//   FREQ=DAILY|WEEKLY|MONTHLY, INTERVAL=n, BYDAY=MO,TU,... (weekly only),
+//   UNTIL=yyyyMMdd
+// e.g. "FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH".
+//
+// Occurrences are computed relative to an anchor (the live task's due time)
+// by arithmetic, never by stepping from the start of the series, so finding
+// the occurrences in a window costs the same however old the series is.
+// Monthly rules skip months that lack the anchor's day, as RRULE does.
+class RecurrenceRule
+{
+public:
+    enum Frequency : quint8 {
+        NoRecurrence,
+        Daily,
+        Weekly,
+        Monthly
+    };
+
+    RecurrenceRule();
+    explicit RecurrenceRule(Frequency frequency, int interval = 1);
+
+    Frequency frequency() const { return m_frequency; }
+    int interval() const { return m_interval; }
+    quint8 weekdays() const { return m_weekdays; }
+    QDate until() const { return m_until; }
+
+    void setFrequency(Frequency frequency) { m_frequency = frequency; }
+    void setInterval(int interval);
+    void setWeekdays(quint8 weekdays) { m_weekdays = weekdays & ALL_WEEKDAYS; }
+    void setWeekday(Qt::DayOfWeek day, bool enabled = true);
+    void setUntil(const QDate& until) { m_until = until; }
+
+    bool isValid() const { return m_frequency != NoRecurrence; }
+    bool hasWeekday(Qt::DayOfWeek day) const { return m_weekdays & weekdayBit(day); }
+
+    // First occurrence strictly after `after`; invalid once the series ends
+    QDateTime nextOccurrence(const QDateTime& anchor, const QDateTime& after) const;
+
+    // Occurrences in [from, to), at most maxCount of them
+    QVector<QDateTime> occurrencesBetween(const QDateTime& anchor, const QDateTime& from,
+                                          const QDateTime& to, int maxCount = 1000) const;
+
+    QString toString() const;
+    static RecurrenceRule fromString(const QString& rule);
+
+    bool operator==(const RecurrenceRule& other) const;
+    bool operator!=(const RecurrenceRule& other) const { return !(*this == other); }
+
+    static const quint8 ALL_WEEKDAYS = 0x7F;
+
+private:
+    static quint8 weekdayBit(Qt::DayOfWeek day) { return static_cast<quint8>(1 << (day - 1)); }
+
+    QDate firstDateOnOrAfter(const QDate& anchor, const QDate& date) const;
+    QDate firstWeeklyDate(const QDate& anchor, const QDate& date) const;
+    QDate firstMonthlyDate(const QDate& anchor, const QDate& date) const;
+
+    QDate m_until;
+    qint16 m_interval;
+    Frequency m_frequency;
+    quint8 m_weekdays;   // Bit (day - 1) per Qt::DayOfWeek; empty means the anchor's weekday
+};
+
+Q_DECLARE_TYPEINFO(RecurrenceRule, Q_MOVABLE_TYPE);
+
+#endif // RECURRENCERULE_H
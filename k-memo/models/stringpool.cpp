@@ -0,0 +1,61 @@
+#include "stringpool.h"
+
+StringPool::StringPool()
+{
+    m_strings.append(QString());
+    m_ids.insert(QString(), 0);
+}
+
+StringPool* StringPool::categories()
+{
+    static StringPool pool;
+    return &pool;
+}
+
+StringPool* StringPool::tags()
+{
+    static StringPool pool;
+    return &pool;
+}
+
+quint32 StringPool::intern(const QString& str)
+{
+    if (str.isEmpty()) {
+        return 0;
+    }
+
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_ids.constFind(str);
+        if (it != m_ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    // Another thread may have added it between the two locks
+    QWriteLocker locker(&m_lock);
+    auto it = m_ids.constFind(str);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+
+    quint32 id = static_cast<quint32>(m_strings.size());
+    m_strings.append(str);
+    m_ids.insert(str, id);
+    return id;
+}
+
+QString StringPool::string(quint32 id) const
+{
+    QReadLocker locker(&m_lock);
+    if (id >= static_cast<quint32>(m_strings.size())) {
+        return QString();
+    }
+    return m_strings.at(static_cast<int>(id));
+}
+
+int StringPool::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_strings.size();
+}
@@ -0,0 +1,32 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QReadWriteLock>
+
+// Interns frequently repeated strings (categories, tags) so every task refers
+// to one shared copy through a 32-bit id. Id 0 is always the empty string.
+// Entries are never removed; the pools only grow with distinct values.
+// Safe to use from several threads: task snapshots are read off the GUI
+// thread while it keeps interning new values.
+class StringPool
+{
+public:
+    static StringPool* categories();
+    static StringPool* tags();
+
+    quint32 intern(const QString& str);
+    QString string(quint32 id) const;
+    int size() const;
+
+private:
+    StringPool();
+
+    QHash<QString, quint32> m_ids;
+    QVector<QString> m_strings;
+    mutable QReadWriteLock m_lock;
+};
+
+#endif // STRINGPOOL_H
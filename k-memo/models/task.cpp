@@ -1,57 +1,349 @@
 #include "task.h"
-#include <QUuid>
+#include "stringpool.h"
 #include <QJsonDocument>
 #include <QDate>
 
+namespace {
+// Format marker prepended to compressed descriptions; the digit is the format version
+const char COMPRESSED_DESCRIPTION_MARKER[] = "KMZ1";
+const int COMPRESSED_DESCRIPTION_MARKER_SIZE = 4;
+
+const quint8 PRIORITY_MASK = 0x0F;
+const quint8 STATUS_SHIFT = 4;
+
+quint8 packEnums(TaskPriority priority, TaskStatus status)
+{
+    return static_cast<quint8>((static_cast<int>(priority) & PRIORITY_MASK)
+                               | (static_cast<int>(status) << STATUS_SHIFT));
+}
+
+qint64 toMsecs(const QDateTime& dateTime)
+{
+    return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : Task::NO_TIME;
+}
+
+QDateTime fromMsecs(qint64 msecs)
+{
+    return msecs == Task::NO_TIME ? QDateTime() : QDateTime::fromMSecsSinceEpoch(msecs);
+}
+}
+
+class TaskData : public QSharedData
+{
+public:
+    TaskData()
+        : createTimeMs(TaskClock::currentMSecsSinceEpoch())
+        , dueTimeMs(Task::NO_TIME)
+        , categoryId(StringPool::categories()->intern("default"))
+        , reminderMinutes(15)
+        , packedEnums(packEnums(TaskPriority::Normal, TaskStatus::Pending))
+        , flags(0)
+    {
+    }
+
+    enum Flag : quint8 {
+        ReminderEnabledFlag = 1 << 0
+    };
+
+    // Ordered by size so padding only falls at the tail.
+    // Id, timestamps, category and tags avoid per-task heap blocks entirely.
+    TaskId id;
+    QString title;
+    QString description;
+    QByteArray compressedDescription;  // Set instead of description for large texts
+    qint64 createTimeMs;               // Epoch msecs, NO_TIME when unset
+    qint64 dueTimeMs;
+    QVector<quint32> tagIds;           // Ids in StringPool::tags()
+    RecurrenceRule recurrence;         // Only set on the live instance of a series
+    quint32 categoryId;                // Id in StringPool::categories()
+    qint16 reminderMinutes;
+    quint8 packedEnums;                // Priority in the low nibble, status in the high nibble
+    quint8 flags;
+};
+
 Task::Task()
-    : m_priority(TaskPriority::Normal)
-    , m_status(TaskStatus::Pending)
-    , m_category("default")
-    , m_reminderEnabled(false)
-    , m_reminderMinutes(15)
+    : d(new TaskData)
+    , m_dirtyFields(NoField)
 {
     generateId();
-    m_createTime = QDateTime::currentDateTime();
 }
 
 Task::Task(const QString& title, const QString& description)
-    : m_title(title)
-    , m_description(description)
-    , m_priority(TaskPriority::Normal)
-    , m_status(TaskStatus::Pending)
-    , m_category("default")
-    , m_reminderEnabled(false)
-    , m_reminderMinutes(15)
+    : d(new TaskData)
+    , m_dirtyFields(NoField)
 {
+    d->title = title;
+    d->description = description;
     generateId();
-    m_createTime = QDateTime::currentDateTime();
 }
 
-bool Task::isValid() const
+Task::Task(const Task& other) = default;
+Task::Task(Task&& other) noexcept = default;
+Task& Task::operator=(const Task& other) = default;
+Task& Task::operator=(Task&& other) noexcept = default;
+Task::~Task() = default;
+
+// Getters read through the const pointer and never detach
+TaskId Task::id() const
 {
-    // Check basic required fields
-    if (m_id.isEmpty() || m_title.isEmpty()) {
-        return false;
+    return d->id;
+}
+
+QString Task::title() const
+{
+    return d->title;
+}
+
+QString Task::description() const
+{
+    if (!d->compressedDescription.isEmpty()) {
+        return decompressDescription(d->compressedDescription);
+    }
+    return d->description;
+}
+
+QDateTime Task::createTime() const
+{
+    return fromMsecs(d->createTimeMs);
+}
+
+QDateTime Task::dueTime() const
+{
+    return fromMsecs(d->dueTimeMs);
+}
+
+TaskPriority Task::priority() const
+{
+    return static_cast<TaskPriority>(d->packedEnums & PRIORITY_MASK);
+}
+
+TaskStatus Task::status() const
+{
+    return static_cast<TaskStatus>(d->packedEnums >> STATUS_SHIFT);
+}
+
+QString Task::category() const
+{
+    return StringPool::categories()->string(d->categoryId);
+}
+
+QStringList Task::tags() const
+{
+    QStringList tags;
+    tags.reserve(d->tagIds.size());
+
+    StringPool* pool = StringPool::tags();
+    for (quint32 tagId : d->tagIds) {
+        tags.append(pool->string(tagId));
+    }
+    return tags;
+}
+
+bool Task::reminderEnabled() const
+{
+    return d->flags & TaskData::ReminderEnabledFlag;
+}
+
+int Task::reminderMinutes() const
+{
+    return d->reminderMinutes;
+}
+
+RecurrenceRule Task::recurrence() const
+{
+    return d->recurrence;
+}
+
+bool Task::isRecurring() const
+{
+    return d->recurrence.isValid();
+}
+
+qint64 Task::createTimeMsecs() const
+{
+    return d->createTimeMs;
+}
+
+qint64 Task::dueTimeMsecs() const
+{
+    return d->dueTimeMs;
+}
+
+bool Task::hasDueTime() const
+{
+    return d->dueTimeMs != NO_TIME;
+}
+
+quint32 Task::categoryId() const
+{
+    return d->categoryId;
+}
+
+QVector<quint32> Task::tagIds() const
+{
+    return d->tagIds;
+}
+
+bool Task::hasCompressedDescription() const
+{
+    return !d->compressedDescription.isEmpty();
+}
+
+QByteArray Task::compressedDescription() const
+{
+    return d->compressedDescription;
+}
+
+// Setters compare through the const getters first, so assigning an
+// unchanged value keeps the data shared
+void Task::setCompressedDescription(const QByteArray& data)
+{
+    if (compressedDescription() != data) {
+        d->description.clear();
+        d->compressedDescription = data;
+        m_dirtyFields |= DescriptionField;
+    }
+}
+
+void Task::setId(const TaskId& id)
+{
+    if (this->id() != id) {
+        d->id = id;
+    }
+}
+
+void Task::setTitle(const QString& title)
+{
+    if (this->title() != title) {
+        d->title = title;
+        m_dirtyFields |= TitleField;
+    }
+}
+
+void Task::setDescription(const QString& description)
+{
+    // Comparing against a compressed description would mean inflating it,
+    // so replacing one always counts as a change
+    if (hasCompressedDescription() || qAsConst(d)->description != description) {
+        d->description = description;
+        d->compressedDescription.clear();
+        m_dirtyFields |= DescriptionField;
+    }
+}
+
+void Task::setCreateTime(const QDateTime& createTime)
+{
+    setCreateTimeMsecs(toMsecs(createTime));
+}
+
+void Task::setDueTime(const QDateTime& dueTime)
+{
+    setDueTimeMsecs(toMsecs(dueTime));
+}
+
+void Task::setCreateTimeMsecs(qint64 msecs)
+{
+    if (createTimeMsecs() != msecs) {
+        d->createTimeMs = msecs;
+        m_dirtyFields |= CreateTimeField;
     }
+}
 
-    // Check ID format (UUID format: 32 chars + 4 hyphens = 36 total)
-    if (m_id.length() != 36) {
+void Task::setDueTimeMsecs(qint64 msecs)
+{
+    if (dueTimeMsecs() != msecs) {
+        d->dueTimeMs = msecs;
+        m_dirtyFields |= DueTimeField;
+    }
+}
+
+void Task::setPriority(TaskPriority priority)
+{
+    if (this->priority() != priority) {
+        d->packedEnums = packEnums(priority, status());
+        m_dirtyFields |= PriorityField;
+    }
+}
+
+void Task::setStatus(TaskStatus status)
+{
+    if (this->status() != status) {
+        d->packedEnums = packEnums(priority(), status);
+        m_dirtyFields |= StatusField;
+    }
+}
+
+void Task::setCategory(const QString& category)
+{
+    quint32 categoryId = StringPool::categories()->intern(category);
+    if (this->categoryId() != categoryId) {
+        d->categoryId = categoryId;
+        m_dirtyFields |= CategoryField;
+    }
+}
+
+void Task::setTags(const QStringList& tags)
+{
+    QVector<quint32> tagIds;
+    tagIds.reserve(tags.size());
+
+    StringPool* pool = StringPool::tags();
+    for (const QString& tag : tags) {
+        tagIds.append(pool->intern(tag));
+    }
+
+    if (qAsConst(d)->tagIds != tagIds) {
+        d->tagIds = tagIds;
+        m_dirtyFields |= TagsField;
+    }
+}
+
+void Task::setReminderEnabled(bool enabled)
+{
+    if (reminderEnabled() != enabled) {
+        d->flags ^= TaskData::ReminderEnabledFlag;
+        m_dirtyFields |= ReminderEnabledField;
+    }
+}
+
+void Task::setReminderMinutes(int minutes)
+{
+    // Anything outside 16 bits is already invalid per hasValidReminder()
+    qint16 clamped = static_cast<qint16>(qBound(-32768, minutes, 32767));
+    if (reminderMinutes() != clamped) {
+        d->reminderMinutes = clamped;
+        m_dirtyFields |= ReminderMinutesField;
+    }
+}
+
+void Task::setRecurrence(const RecurrenceRule& recurrence)
+{
+    if (this->recurrence() != recurrence) {
+        d->recurrence = recurrence;
+        m_dirtyFields |= RecurrenceField;
+    }
+}
+
+bool Task::isValid() const
+{
+    // Check basic required fields
+    if (d->id.isNull() || d->title.isEmpty()) {
         return false;
     }
 
     // Check title length limit
-    if (m_title.length() > 200) {
+    if (d->title.length() > 200) {
         return false;
     }
 
     // Check reminder settings validity
-    if (m_reminderEnabled && m_reminderMinutes < 0) {
+    if (reminderEnabled() && d->reminderMinutes < 0) {
         return false;
     }
 
     // Check time logic consistency
-    if (m_dueTime.isValid() && m_createTime.isValid()) {
-        if (m_dueTime < m_createTime) {
+    if (d->dueTimeMs != NO_TIME && d->createTimeMs != NO_TIME) {
+        if (d->dueTimeMs < d->createTimeMs) {
             return false;  // Due time cannot be earlier than creation time
         }
     }
@@ -61,72 +353,160 @@ bool Task::isValid() const
 
 bool Task::isOverdue() const
 {
-    if (!m_dueTime.isValid()) {
+    return isOverdue(TaskTimeContext::capture());
+}
+
+bool Task::isOverdue(const TaskTimeContext& time) const
+{
+    if (d->dueTimeMs == NO_TIME) {
         return false;
     }
-    return m_dueTime < QDateTime::currentDateTime() && m_status != TaskStatus::Completed;
+    return d->dueTimeMs < time.nowMs && status() != TaskStatus::Completed;
 }
 
 bool Task::isDueToday() const
 {
-    if (!m_dueTime.isValid()) {
+    return isDueToday(TaskTimeContext::capture());
+}
+
+bool Task::isDueToday(const TaskTimeContext& time) const
+{
+    if (d->dueTimeMs == NO_TIME) {
         return false;
     }
-    return m_dueTime.date() == QDate::currentDate();
+    return d->dueTimeMs >= time.todayStartMs && d->dueTimeMs < time.tomorrowStartMs;
 }
 
 bool Task::isDueSoon(int hours) const
 {
-    if (!m_dueTime.isValid()) {
+    return isDueSoon(TaskTimeContext::capture(), hours);
+}
+
+bool Task::isDueSoon(const TaskTimeContext& time, int hours) const
+{
+    if (d->dueTimeMs == NO_TIME) {
         return false;
     }
 
-    QDateTime currentTime = QDateTime::currentDateTime();
-    QDateTime thresholdTime = currentTime.addSecs(hours * 3600); // Convert hours to seconds
+    qint64 thresholdTime = time.nowMs + qint64(hours) * 3600 * 1000; // Convert hours to msecs
 
-    return m_dueTime <= thresholdTime && m_dueTime >= currentTime && m_status != TaskStatus::Completed;
+    return d->dueTimeMs <= thresholdTime && d->dueTimeMs >= time.nowMs && status() != TaskStatus::Completed;
+}
+
+qint64 Task::nextTimeStateChange(const TaskTimeContext& time) const
+{
+    const qint64 due = d->dueTimeMs;
+    if (due == NO_TIME) {
+        return NO_TIME;
+    }
+
+    // Overdue from the millisecond after the due time; due today between
+    // local midnights, which aren't always 24 hours apart
+    const QDate dueDate = QDateTime::fromMSecsSinceEpoch(due).date();
+    const qint64 candidates[] = {
+        dueDate.startOfDay().toMSecsSinceEpoch(),
+        dueDate.addDays(1).startOfDay().toMSecsSinceEpoch(),
+        due + 1
+    };
+
+    qint64 next = NO_TIME;
+    for (qint64 candidate : candidates) {
+        if (candidate > time.nowMs && (next == NO_TIME || candidate < next)) {
+            next = candidate;
+        }
+    }
+    return next;
 }
 
 bool Task::isValidTransition(TaskStatus newStatus) const
+{
+    return isValidTransition(status(), newStatus);
+}
+
+bool Task::isValidTransition(TaskStatus currentStatus, TaskStatus newStatus)
 {
     // Allow any transition from Pending
-    if (m_status == TaskStatus::Pending) {
+    if (currentStatus == TaskStatus::Pending) {
         return true;
     }
 
     // From InProgress, can go to any status
-    if (m_status == TaskStatus::InProgress) {
+    if (currentStatus == TaskStatus::InProgress) {
         return true;
     }
 
     // From Completed, only allow transition to Cancelled or back to InProgress
-    if (m_status == TaskStatus::Completed) {
+    if (currentStatus == TaskStatus::Completed) {
         return newStatus == TaskStatus::Cancelled || newStatus == TaskStatus::InProgress;
     }
 
     // From Cancelled, only allow transition to Pending or InProgress
-    if (m_status == TaskStatus::Cancelled) {
+    if (currentStatus == TaskStatus::Cancelled) {
         return newStatus == TaskStatus::Pending || newStatus == TaskStatus::InProgress;
     }
 
     return false;
 }
 
+QDateTime Task::recurrenceAnchor() const
+{
+    return hasDueTime() ? dueTime() : createTime();
+}
+
+bool Task::nextOccurrence(Task* next) const
+{
+    if (!isRecurring()) {
+        return false;
+    }
+
+    // Strictly after both the current instance and now: occurrences that
+    // passed while this instance was open are not replayed as overdue tasks
+    QDateTime anchor = recurrenceAnchor();
+    QDateTime now = QDateTime::fromMSecsSinceEpoch(TaskClock::currentMSecsSinceEpoch());
+    QDateTime nextDue = d->recurrence.nextOccurrence(anchor, qMax(anchor, now));
+    if (!nextDue.isValid()) {
+        return false;
+    }
+
+    Task task(title());
+    if (hasCompressedDescription()) {
+        task.setCompressedDescription(compressedDescription());
+    } else {
+        task.setDescription(description());
+    }
+    task.setDueTime(nextDue);
+    task.setPriority(priority());
+    task.setCategory(category());
+    task.setTags(tags());
+    task.setReminderEnabled(reminderEnabled());
+    task.setReminderMinutes(reminderMinutes());
+    task.setRecurrence(d->recurrence);
+    task.markDirty();
+
+    *next = task;
+    return true;
+}
+
 bool Task::hasValidReminder() const
 {
-    if (!m_reminderEnabled) {
+    return hasValidReminder(TaskTimeContext::capture());
+}
+
+bool Task::hasValidReminder(const TaskTimeContext& time) const
+{
+    if (!reminderEnabled()) {
         return true; // If reminder is disabled, it's considered valid
     }
 
     // Check if reminder time is reasonable (between 1 minute and 7 days)
-    if (m_reminderMinutes < 1 || m_reminderMinutes > 10080) { // 7 days = 7 * 24 * 60 minutes
+    if (d->reminderMinutes < 1 || d->reminderMinutes > 10080) { // 7 days = 7 * 24 * 60 minutes
         return false;
     }
 
     // If there's a due time, check if reminder is before due time
-    if (m_dueTime.isValid()) {
-        QDateTime reminderTime = m_dueTime.addSecs(-m_reminderMinutes * 60);
-        return reminderTime > QDateTime::currentDateTime();
+    if (d->dueTimeMs != NO_TIME) {
+        qint64 reminderTime = d->dueTimeMs - qint64(d->reminderMinutes) * 60 * 1000;
+        return reminderTime > time.nowMs;
     }
 
     return true;
@@ -134,38 +514,41 @@ bool Task::hasValidReminder() const
 
 QString Task::priorityString() const
 {
-    return taskPriorityToString(m_priority);
+    return taskPriorityToString(priority());
 }
 
 QString Task::statusString() const
 {
-    return taskStatusToString(m_status);
+    return taskStatusToString(status());
 }
 
 QJsonObject Task::toJson() const
 {
     QJsonObject obj;
     obj["version"] = "1.0";  // Add version identifier
-    obj["id"] = m_id;
-    obj["title"] = m_title;
-    obj["description"] = m_description;
+    obj["id"] = d->id.toString();
+    obj["title"] = d->title;
+    obj["description"] = description();
 
     // Only serialize valid DateTime
-    if (m_createTime.isValid()) {
-        obj["createTime"] = m_createTime.toString(Qt::ISODate);
+    if (d->createTimeMs != NO_TIME) {
+        obj["createTime"] = createTime().toString(Qt::ISODate);
     }
-    if (m_dueTime.isValid()) {
-        obj["dueTime"] = m_dueTime.toString(Qt::ISODate);
+    if (d->dueTimeMs != NO_TIME) {
+        obj["dueTime"] = dueTime().toString(Qt::ISODate);
     }
 
-    obj["priority"] = static_cast<int>(m_priority);
-    obj["status"] = static_cast<int>(m_status);
-    obj["category"] = m_category;
-    obj["reminderEnabled"] = m_reminderEnabled;
-    obj["reminderMinutes"] = m_reminderMinutes;
+    obj["priority"] = static_cast<int>(priority());
+    obj["status"] = static_cast<int>(status());
+    obj["category"] = category();
+    obj["reminderEnabled"] = reminderEnabled();
+    obj["reminderMinutes"] = d->reminderMinutes;
+    if (d->recurrence.isValid()) {
+        obj["recurrence"] = d->recurrence.toString();
+    }
 
     QJsonArray tagsArray;
-    for (const QString& tag : m_tags) {
+    for (const QString& tag : tags()) {
         tagsArray.append(tag);
     }
     obj["tags"] = tagsArray;
@@ -181,9 +564,10 @@ void Task::fromJson(const QJsonObject& json)
     }
 
     // Safely parse basic fields
-    m_id = json["id"].toString();
-    m_title = json["title"].toString();
-    m_description = json["description"].toString();
+    d->id = TaskId::fromString(json["id"].toString());
+    d->title = json["title"].toString();
+    d->description = json["description"].toString();
+    d->compressedDescription.clear();
 
     // Safely parse DateTime fields
     if (json.contains("createTime")) {
@@ -191,7 +575,7 @@ void Task::fromJson(const QJsonObject& json)
         if (!createTimeStr.isEmpty()) {
             QDateTime dt = QDateTime::fromString(createTimeStr, Qt::ISODate);
             if (dt.isValid()) {
-                m_createTime = dt;
+                d->createTimeMs = dt.toMSecsSinceEpoch();
             }
         }
     }
@@ -201,7 +585,7 @@ void Task::fromJson(const QJsonObject& json)
         if (!dueTimeStr.isEmpty()) {
             QDateTime dt = QDateTime::fromString(dueTimeStr, Qt::ISODate);
             if (dt.isValid()) {
-                m_dueTime = dt;
+                d->dueTimeMs = dt.toMSecsSinceEpoch();
             }
         }
     }
@@ -210,38 +594,47 @@ void Task::fromJson(const QJsonObject& json)
     if (json.contains("priority")) {
         int priorityInt = json["priority"].toInt(static_cast<int>(TaskPriority::Normal));
         if (priorityInt >= 1 && priorityInt <= 4) {
-            m_priority = static_cast<TaskPriority>(priorityInt);
+            d->packedEnums = packEnums(static_cast<TaskPriority>(priorityInt), status());
         }
     }
 
     if (json.contains("status")) {
         int statusInt = json["status"].toInt(static_cast<int>(TaskStatus::Pending));
         if (statusInt >= 0 && statusInt <= 3) {
-            m_status = static_cast<TaskStatus>(statusInt);
+            d->packedEnums = packEnums(priority(), static_cast<TaskStatus>(statusInt));
         }
     }
 
     // Parse other fields
     if (json.contains("category")) {
-        m_category = json["category"].toString();
+        d->categoryId = StringPool::categories()->intern(json["category"].toString());
     }
     if (json.contains("reminderEnabled")) {
-        m_reminderEnabled = json["reminderEnabled"].toBool();
+        if (json["reminderEnabled"].toBool()) {
+            d->flags |= TaskData::ReminderEnabledFlag;
+        } else {
+            d->flags &= ~TaskData::ReminderEnabledFlag;
+        }
     }
     if (json.contains("reminderMinutes")) {
-        m_reminderMinutes = json["reminderMinutes"].toInt(15);
+        setReminderMinutes(json["reminderMinutes"].toInt(15));
     }
 
+    d->recurrence = RecurrenceRule::fromString(json["recurrence"].toString());
+
     // Safely parse tags array
-    m_tags.clear();
+    d->tagIds.clear();
     if (json.contains("tags") && json["tags"].isArray()) {
         QJsonArray tagsArray = json["tags"].toArray();
         for (const QJsonValue& value : tagsArray) {
             if (value.isString()) {
-                m_tags.append(value.toString());
+                d->tagIds.append(StringPool::tags()->intern(value.toString()));
             }
         }
     }
+
+    // Imported data has no known saved state
+    m_dirtyFields = AllFields;
 }
 
 bool Task::isValidJson(const QJsonObject& json) const
@@ -256,6 +649,10 @@ bool Task::isValidJson(const QJsonObject& json) const
         return false;
     }
 
+    if (TaskId::fromString(json["id"].toString()).isNull()) {
+        return false;
+    }
+
     // Check enum value ranges
     if (json.contains("priority")) {
         if (!json["priority"].isDouble()) {
@@ -315,7 +712,7 @@ bool Task::fromJsonString(const QString& jsonStr)
 
 bool Task::operator==(const Task& other) const
 {
-    return m_id == other.m_id;
+    return d->id == other.d->id;
 }
 
 bool Task::operator!=(const Task& other) const
@@ -325,44 +722,68 @@ bool Task::operator!=(const Task& other) const
 
 void Task::generateId()
 {
-    m_id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    d->id = TaskId::createUuid();
 }
 
 // Helper functions
+// The display names are static QStringLiterals, so returning one never allocates
 QString taskPriorityToString(TaskPriority priority)
 {
-    switch (priority) {
-    case TaskPriority::Low: return "Low";
-    case TaskPriority::Normal: return "Normal";
-    case TaskPriority::High: return "High";
-    case TaskPriority::Urgent: return "Urgent";
-    default: return "Normal";
-    }
+    static const QString names[] = {
+        QStringLiteral("Low"),
+        QStringLiteral("Normal"),
+        QStringLiteral("High"),
+        QStringLiteral("Urgent")
+    };
+    int index = static_cast<int>(priority) - static_cast<int>(TaskPriority::Low);
+    return (index >= 0 && index < 4) ? names[index] : names[1];
 }
 
 TaskPriority taskPriorityFromString(const QString& str)
 {
-    if (str == "Low") return TaskPriority::Low;
-    if (str == "High") return TaskPriority::High;
-    if (str == "Urgent") return TaskPriority::Urgent;
+    if (str == QLatin1String("Low")) return TaskPriority::Low;
+    if (str == QLatin1String("High")) return TaskPriority::High;
+    if (str == QLatin1String("Urgent")) return TaskPriority::Urgent;
     return TaskPriority::Normal;
 }
 
 QString taskStatusToString(TaskStatus status)
 {
-    switch (status) {
-    case TaskStatus::Pending: return "Pending";
-    case TaskStatus::InProgress: return "In Progress";
-    case TaskStatus::Completed: return "Completed";
-    case TaskStatus::Cancelled: return "Cancelled";
-    default: return "Pending";
-    }
+    static const QString names[] = {
+        QStringLiteral("Pending"),
+        QStringLiteral("In Progress"),
+        QStringLiteral("Completed"),
+        QStringLiteral("Cancelled")
+    };
+    int index = static_cast<int>(status);
+    return (index >= 0 && index < 4) ? names[index] : names[0];
 }
 
 TaskStatus taskStatusFromString(const QString& str)
 {
-    if (str == "In Progress") return TaskStatus::InProgress;
-    if (str == "Completed") return TaskStatus::Completed;
-    if (str == "Cancelled") return TaskStatus::Cancelled;
+    if (str == QLatin1String("In Progress")) return TaskStatus::InProgress;
+    if (str == QLatin1String("Completed")) return TaskStatus::Completed;
+    if (str == QLatin1String("Cancelled")) return TaskStatus::Cancelled;
     return TaskStatus::Pending;
 }
+
+bool isCompressedDescription(const QByteArray& data)
+{
+    return data.size() > COMPRESSED_DESCRIPTION_MARKER_SIZE
+        && data.startsWith(COMPRESSED_DESCRIPTION_MARKER);
+}
+
+QByteArray compressDescription(const QString& description)
+{
+    QByteArray data(COMPRESSED_DESCRIPTION_MARKER, COMPRESSED_DESCRIPTION_MARKER_SIZE);
+    data.append(qCompress(description.toUtf8()));
+    return data;
+}
+
+QString decompressDescription(const QByteArray& data)
+{
+    if (!isCompressedDescription(data)) {
+        return QString();
+    }
+    return QString::fromUtf8(qUncompress(data.mid(COMPRESSED_DESCRIPTION_MARKER_SIZE)));
+}
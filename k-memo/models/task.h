@@ -6,6 +6,12 @@
 #include <QStringList>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QVector>
+#include <QSharedDataPointer>
+#include "taskid.h"
+#include "tasktimecontext.h"
+#include "recurrencerule.h"
+#include <limits>
 
 enum class TaskPriority {
     Low = 1,
@@ -21,45 +27,112 @@ enum class TaskStatus {
     Cancelled = 3
 };
 
+class TaskData;
+
+// Implicitly shared: copies share one TaskData until a setter changes a value
 class Task
 {
 public:
+    // Persisted fields, used to track which ones changed since the last save
+    enum Field : quint16 {
+        NoField = 0,
+        TitleField = 1 << 0,
+        DescriptionField = 1 << 1,
+        CreateTimeField = 1 << 2,
+        DueTimeField = 1 << 3,
+        PriorityField = 1 << 4,
+        StatusField = 1 << 5,
+        CategoryField = 1 << 6,
+        TagsField = 1 << 7,
+        ReminderEnabledField = 1 << 8,
+        ReminderMinutesField = 1 << 9,
+        RecurrenceField = 1 << 10,
+        AllFields = (1 << 11) - 1
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
+
     Task();
     Task(const QString& title, const QString& description = QString());
+    Task(const Task& other);
+    Task(Task&& other) noexcept;
+    Task& operator=(const Task& other);
+    Task& operator=(Task&& other) noexcept;
+    ~Task();
     
     // Getters
-    QString id() const { return m_id; }
-    QString title() const { return m_title; }
-    QString description() const { return m_description; }
-    QDateTime createTime() const { return m_createTime; }
-    QDateTime dueTime() const { return m_dueTime; }
-    TaskPriority priority() const { return m_priority; }
-    TaskStatus status() const { return m_status; }
-    QString category() const { return m_category; }
-    QStringList tags() const { return m_tags; }
-    bool reminderEnabled() const { return m_reminderEnabled; }
-    int reminderMinutes() const { return m_reminderMinutes; }
+    TaskId id() const;
+    QString title() const;
+    QString description() const;
+    QDateTime createTime() const;
+    QDateTime dueTime() const;
+    TaskPriority priority() const;
+    TaskStatus status() const;
+    QString category() const;
+    QStringList tags() const;
+    bool reminderEnabled() const;
+    int reminderMinutes() const;
+    RecurrenceRule recurrence() const;
+    bool isRecurring() const;
+
+    // Compact accessors for hot paths (no QDateTime/QString construction)
+    qint64 createTimeMsecs() const;
+    qint64 dueTimeMsecs() const;
+    bool hasDueTime() const;
+    quint32 categoryId() const;
+    QVector<quint32> tagIds() const;
+
+    // Compressed description storage (see compressDescription)
+    bool hasCompressedDescription() const;
+    QByteArray compressedDescription() const;
+    void setCompressedDescription(const QByteArray& data);
     
-    // Setters
-    void setId(const QString& id) { m_id = id; }
-    void setTitle(const QString& title) { m_title = title; }
-    void setDescription(const QString& description) { m_description = description; }
-    void setCreateTime(const QDateTime& createTime) { m_createTime = createTime; }
-    void setDueTime(const QDateTime& dueTime) { m_dueTime = dueTime; }
-    void setPriority(TaskPriority priority) { m_priority = priority; }
-    void setStatus(TaskStatus status) { m_status = status; }
-    void setCategory(const QString& category) { m_category = category; }
-    void setTags(const QStringList& tags) { m_tags = tags; }
-    void setReminderEnabled(bool enabled) { m_reminderEnabled = enabled; }
-    void setReminderMinutes(int minutes) { m_reminderMinutes = minutes; }
+    // Setters (each marks its field dirty when the value changes)
+    void setId(const TaskId& id);
+    void setTitle(const QString& title);
+    void setDescription(const QString& description);
+    void setCreateTime(const QDateTime& createTime);
+    void setDueTime(const QDateTime& dueTime);
+    void setCreateTimeMsecs(qint64 msecs);
+    void setDueTimeMsecs(qint64 msecs);
+    void setPriority(TaskPriority priority);
+    void setStatus(TaskStatus status);
+    void setCategory(const QString& category);
+    void setTags(const QStringList& tags);
+    void setReminderEnabled(bool enabled);
+    void setReminderMinutes(int minutes);
+    void setRecurrence(const RecurrenceRule& recurrence);
+
+    // Change tracking
+    Fields dirtyFields() const { return Fields(m_dirtyFields); }
+    bool isDirty() const { return m_dirtyFields != NoField; }
+    void markClean() { m_dirtyFields = NoField; }
+    void markDirty(Fields fields = AllFields) { m_dirtyFields |= static_cast<quint16>(fields); }
     
     // Utility methods
     bool isValid() const;
+    bool isValidTransition(TaskStatus newStatus) const;
+    static bool isValidTransition(TaskStatus currentStatus, TaskStatus newStatus);
+
+    // Recurring series: the due time (or creation time) anchors the rule.
+    // Builds the series' next live instance; false once the series has ended.
+    QDateTime recurrenceAnchor() const;
+    bool nextOccurrence(Task* next) const;
+
+    // Time-dependent checks. The context overloads are for loops over many
+    // tasks; the others capture a fresh TaskTimeContext per call.
     bool isOverdue() const;
+    bool isOverdue(const TaskTimeContext& time) const;
     bool isDueToday() const;
+    bool isDueToday(const TaskTimeContext& time) const;
     bool isDueSoon(int hours = 24) const;
-    bool isValidTransition(TaskStatus newStatus) const;
+    bool isDueSoon(const TaskTimeContext& time, int hours = 24) const;
     bool hasValidReminder() const;
+    bool hasValidReminder(const TaskTimeContext& time) const;
+
+    // First instant after time.nowMs at which isOverdue() or isDueToday()
+    // can change (the due time passing, or the start or end of the due
+    // day), or NO_TIME if neither ever will
+    qint64 nextTimeStateChange(const TaskTimeContext& time) const;
     QString priorityString() const;
     QString statusString() const;
     
@@ -74,26 +147,30 @@ public:
     bool operator==(const Task& other) const;
     bool operator!=(const Task& other) const;
 
+    // Sentinel for an unset timestamp
+    static constexpr qint64 NO_TIME = std::numeric_limits<qint64>::min();
+
 private:
-    QString m_id;
-    QString m_title;
-    QString m_description;
-    QDateTime m_createTime;
-    QDateTime m_dueTime;
-    TaskPriority m_priority;
-    TaskStatus m_status;
-    QString m_category;
-    QStringList m_tags;
-    bool m_reminderEnabled;
-    int m_reminderMinutes;
+    QSharedDataPointer<TaskData> d;
+    // Dirty state describes this handle, not the shared value, so marking
+    // a copy clean never forces a detach
+    quint16 m_dirtyFields;
     
     void generateId();
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(Task::Fields)
+Q_DECLARE_TYPEINFO(Task, Q_MOVABLE_TYPE);
+
 // Helper functions
 QString taskPriorityToString(TaskPriority priority);
 TaskPriority taskPriorityFromString(const QString& str);
 QString taskStatusToString(TaskStatus status);
 TaskStatus taskStatusFromString(const QString& str);
 
+// Description compression: marker + qCompress'ed UTF-8
+bool isCompressedDescription(const QByteArray& data);
+QByteArray compressDescription(const QString& description);
+QString decompressDescription(const QByteArray& data);
+
 #endif // TASK_H
@@ -0,0 +1,268 @@
+#include "taskdelta.h"
+#include "recurrencerule.h"
+#include <QStringView>
+
+namespace {
+// Fields kept as plain before/after values, in the order between() records them
+const Task::Field VALUE_FIELDS[] = {
+    Task::CreateTimeField,
+    Task::DueTimeField,
+    Task::PriorityField,
+    Task::StatusField,
+    Task::CategoryField,
+    Task::TagsField,
+    Task::ReminderEnabledField,
+    Task::ReminderMinutesField,
+    Task::RecurrenceField
+};
+}
+
+TextSplice TextSplice::between(const QString& before, const QString& after)
+{
+    TextSplice splice;
+    const int limit = qMin(before.size(), after.size());
+    while (splice.prefix < limit && before.at(splice.prefix) == after.at(splice.prefix)) {
+        ++splice.prefix;
+    }
+    while (splice.suffix < limit - splice.prefix
+           && before.at(before.size() - 1 - splice.suffix) == after.at(after.size() - 1 - splice.suffix)) {
+        ++splice.suffix;
+    }
+
+    splice.removed = before.mid(splice.prefix, before.size() - splice.prefix - splice.suffix);
+    splice.inserted = after.mid(splice.prefix, after.size() - splice.prefix - splice.suffix);
+    return splice;
+}
+
+bool TextSplice::apply(const QString& before, QString* after) const
+{
+    if (before.size() != prefix + removed.size() + suffix
+        || QStringView(before).mid(prefix, removed.size()) != QStringView(removed)) {
+        return false;
+    }
+    *after = before.left(prefix) + inserted + before.right(suffix);
+    return true;
+}
+
+bool TextSplice::revert(const QString& after, QString* before) const
+{
+    if (after.size() != prefix + inserted.size() + suffix
+        || QStringView(after).mid(prefix, inserted.size()) != QStringView(inserted)) {
+        return false;
+    }
+    *before = after.left(prefix) + removed + after.right(suffix);
+    return true;
+}
+
+bool TextSplice::mergeWith(const TextSplice& next)
+{
+    // Both splices are positioned in the intermediate text
+    const int middleSize = prefix + inserted.size() + suffix;
+    const int firstStart = prefix;
+    const int firstEnd = prefix + inserted.size();
+    const int nextStart = next.prefix;
+    const int nextEnd = middleSize - next.suffix;
+    if (nextEnd - nextStart != next.removed.size() || nextStart > firstEnd || nextEnd < firstStart) {
+        return false;
+    }
+
+    // The span they cover together is known from the two stored texts
+    const int start = qMin(firstStart, nextStart);
+    const int end = qMax(firstEnd, nextEnd);
+    QString middle(end - start, QChar());
+    middle.replace(firstStart - start, inserted.size(), inserted);
+    middle.replace(nextStart - start, next.removed.size(), next.removed);
+
+    const QString oldSpan = middle.left(firstStart - start) + removed + middle.mid(firstEnd - start);
+    const QString newSpan = middle.left(nextStart - start) + next.inserted + middle.mid(nextEnd - start);
+
+    TextSplice merged = between(oldSpan, newSpan);
+    merged.prefix += start;
+    merged.suffix += middleSize - end;
+    *this = merged;
+    return true;
+}
+
+TaskDelta::TaskDelta()
+    : m_fields(Task::NoField)
+{
+}
+
+TaskDelta TaskDelta::between(const Task& before, const Task& after)
+{
+    TaskDelta delta;
+
+    const QString beforeTitle = before.title();
+    const QString afterTitle = after.title();
+    if (beforeTitle != afterTitle) {
+        delta.m_title = TextSplice::between(beforeTitle, afterTitle);
+        delta.m_fields |= Task::TitleField;
+    }
+
+    const QString beforeDescription = before.description();
+    const QString afterDescription = after.description();
+    if (beforeDescription != afterDescription) {
+        delta.m_description = TextSplice::between(beforeDescription, afterDescription);
+        delta.m_fields |= Task::DescriptionField;
+    }
+
+    for (Task::Field field : VALUE_FIELDS) {
+        QVariant oldValue = fieldValue(before, field);
+        QVariant newValue = fieldValue(after, field);
+        if (oldValue != newValue) {
+            delta.m_changes.append({field, oldValue, newValue});
+            delta.m_fields |= field;
+        }
+    }
+    return delta;
+}
+
+bool TaskDelta::isEmpty() const
+{
+    return m_fields == Task::NoField;
+}
+
+bool TaskDelta::apply(Task* task) const
+{
+    return applyChanges(task, true);
+}
+
+bool TaskDelta::revert(Task* task) const
+{
+    return applyChanges(task, false);
+}
+
+bool TaskDelta::applyChanges(Task* task, bool forward) const
+{
+    // Texts are checked before anything is set, so a mismatch leaves the
+    // task untouched
+    QString title;
+    QString description;
+    if (m_fields & Task::TitleField) {
+        const bool ok = forward ? m_title.apply(task->title(), &title)
+                                : m_title.revert(task->title(), &title);
+        if (!ok) {
+            return false;
+        }
+    }
+    if (m_fields & Task::DescriptionField) {
+        const bool ok = forward ? m_description.apply(task->description(), &description)
+                                : m_description.revert(task->description(), &description);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    if (m_fields & Task::TitleField) {
+        task->setTitle(title);
+    }
+    if (m_fields & Task::DescriptionField) {
+        task->setDescription(description);
+    }
+    for (const FieldChange& change : m_changes) {
+        setFieldValue(task, change.field, forward ? change.after : change.before);
+    }
+    return true;
+}
+
+bool TaskDelta::mergeWith(const TaskDelta& next)
+{
+    if (m_fields != next.m_fields) {
+        return false;
+    }
+
+    TextSplice title = m_title;
+    TextSplice description = m_description;
+    if ((m_fields & Task::TitleField) && !title.mergeWith(next.m_title)) {
+        return false;
+    }
+    if ((m_fields & Task::DescriptionField) && !description.mergeWith(next.m_description)) {
+        return false;
+    }
+
+    m_title = title;
+    m_description = description;
+    if ((m_fields & Task::TitleField) && m_title.isEmpty()) {
+        m_fields &= ~Task::Fields(Task::TitleField);
+    }
+    if ((m_fields & Task::DescriptionField) && m_description.isEmpty()) {
+        m_fields &= ~Task::Fields(Task::DescriptionField);
+    }
+
+    // Same fields, recorded in the same order: keep the first old value and
+    // the last new one, dropping fields that ended where they started
+    QVector<FieldChange> changes;
+    for (int i = 0; i < m_changes.size(); ++i) {
+        FieldChange change = m_changes.at(i);
+        change.after = next.m_changes.at(i).after;
+        if (change.before != change.after) {
+            changes.append(change);
+        } else {
+            m_fields &= ~Task::Fields(change.field);
+        }
+    }
+    m_changes.swap(changes);
+    return true;
+}
+
+QVariant TaskDelta::fieldValue(const Task& task, Task::Field field)
+{
+    switch (field) {
+    case Task::CreateTimeField:
+        return task.createTimeMsecs();
+    case Task::DueTimeField:
+        return task.dueTimeMsecs();
+    case Task::PriorityField:
+        return static_cast<int>(task.priority());
+    case Task::StatusField:
+        return static_cast<int>(task.status());
+    case Task::CategoryField:
+        return task.category();
+    case Task::TagsField:
+        return task.tags();
+    case Task::ReminderEnabledField:
+        return task.reminderEnabled();
+    case Task::ReminderMinutesField:
+        return task.reminderMinutes();
+    case Task::RecurrenceField:
+        return task.isRecurring() ? task.recurrence().toString() : QString();
+    default:
+        return QVariant();
+    }
+}
+
+void TaskDelta::setFieldValue(Task* task, Task::Field field, const QVariant& value)
+{
+    switch (field) {
+    case Task::CreateTimeField:
+        task->setCreateTimeMsecs(value.toLongLong());
+        break;
+    case Task::DueTimeField:
+        task->setDueTimeMsecs(value.toLongLong());
+        break;
+    case Task::PriorityField:
+        task->setPriority(static_cast<TaskPriority>(value.toInt()));
+        break;
+    case Task::StatusField:
+        task->setStatus(static_cast<TaskStatus>(value.toInt()));
+        break;
+    case Task::CategoryField:
+        task->setCategory(value.toString());
+        break;
+    case Task::TagsField:
+        task->setTags(value.toStringList());
+        break;
+    case Task::ReminderEnabledField:
+        task->setReminderEnabled(value.toBool());
+        break;
+    case Task::ReminderMinutesField:
+        task->setReminderMinutes(value.toInt());
+        break;
+    case Task::RecurrenceField:
+        task->setRecurrence(value.toString().isEmpty() ? RecurrenceRule()
+                                                       : RecurrenceRule::fromString(value.toString()));
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TASKDELTA_H
+#define TASKDELTA_H
+
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include "task.h"
+
+// Edit to a piece of text: the unchanged prefix and suffix are kept as
+// lengths, only the replaced middle is stored. Typing into a long
+// description costs the size of the typing.
+struct TextSplice
+{
+    int prefix = 0;
+    int suffix = 0;
+    QString removed;
+    QString inserted;
+
+    static TextSplice between(const QString& before, const QString& after);
+
+    // False when the text doesn't have the shape the splice was made for
+    bool apply(const QString& before, QString* after) const;
+    bool revert(const QString& after, QString* before) const;
+
+    // Folds `next` (applied after this one) into this splice. Only touching
+    // or overlapping edits can be folded without the full text.
+    bool mergeWith(const TextSplice& next);
+
+    bool isEmpty() const { return removed.isEmpty() && inserted.isEmpty(); }
+};
+
+// Difference between two versions of one task, for undo: only the fields
+// that changed, each with its old and new value. Title and description are
+// kept as splices; the id is not part of it.
+class TaskDelta
+{
+public:
+    TaskDelta();
+
+    static TaskDelta between(const Task& before, const Task& after);
+
+    Task::Fields fields() const { return m_fields; }
+    bool isEmpty() const;
+
+    // Turn the old version into the new one, or back; only the changed
+    // fields are set, so the task's dirty fields are exactly fields()
+    bool apply(Task* task) const;
+    bool revert(Task* task) const;
+
+    // Folds a later delta over the same fields into this one
+    bool mergeWith(const TaskDelta& next);
+
+private:
+    struct FieldChange {
+        Task::Field field;
+        QVariant before;
+        QVariant after;
+    };
+
+    static QVariant fieldValue(const Task& task, Task::Field field);
+    static void setFieldValue(Task* task, Task::Field field, const QVariant& value);
+    bool applyChanges(Task* task, bool forward) const;
+
+    Task::Fields m_fields;
+    TextSplice m_title;
+    TextSplice m_description;
+    QVector<FieldChange> m_changes;     // Every other field
+};
+
+#endif // TASKDELTA_H
@@ -0,0 +1,17 @@
+#include "taskfilter.h"
+
+bool TaskFilter::matches(const Task& task) const
+{
+    if (!(statuses & statusBit(task.status())) || !(priorities & priorityBit(task.priority()))) {
+        return false;
+    }
+    return category.isEmpty() || task.category() == category;
+}
+
+bool TaskFilter::isSubsetOf(const TaskFilter& other) const
+{
+    if ((statuses & ~other.statuses) || (priorities & ~other.priorities)) {
+        return false;
+    }
+    return other.category.isEmpty() || category == other.category;
+}
@@ -0,0 +1,39 @@
+#ifndef TASKFILTER_H
+#define TASKFILTER_H
+
+#include <QString>
+#include "task.h"
+
+// What a task list shows. An empty category matches every category; the
+// status and priority masks have one bit per enum value.
+struct TaskFilter {
+    static const quint8 ALL_STATUSES = 0x0F;
+    static const quint8 ALL_PRIORITIES = 0x0F;
+
+    QString category;
+    quint8 statuses = ALL_STATUSES;
+    quint8 priorities = ALL_PRIORITIES;
+
+    static quint8 statusBit(TaskStatus status) { return static_cast<quint8>(1 << static_cast<int>(status)); }
+    static quint8 priorityBit(TaskPriority priority)
+    {
+        return static_cast<quint8>(1 << (static_cast<int>(priority) - static_cast<int>(TaskPriority::Low)));
+    }
+
+    bool matches(const Task& task) const;
+    bool isEmpty() const
+    {
+        return category.isEmpty() && statuses == ALL_STATUSES && priorities == ALL_PRIORITIES;
+    }
+
+    // Everything this filter accepts is also accepted by `other`
+    bool isSubsetOf(const TaskFilter& other) const;
+
+    bool operator==(const TaskFilter& other) const
+    {
+        return statuses == other.statuses && priorities == other.priorities && category == other.category;
+    }
+    bool operator!=(const TaskFilter& other) const { return !(*this == other); }
+};
+
+#endif // TASKFILTER_H
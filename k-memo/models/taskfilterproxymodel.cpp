@@ -0,0 +1,394 @@
+#include "taskfilterproxymodel.h"
+#include "taskmodel.h"
+#include <QPair>
+#include <algorithm>
+
+TaskFilterProxyModel::TaskFilterProxyModel(TaskModel* source, QObject *parent)
+    : QAbstractProxyModel(parent)
+    , m_source(source)
+{
+    QAbstractProxyModel::setSourceModel(source);
+
+    connect(source, &QAbstractItemModel::dataChanged, this, &TaskFilterProxyModel::onSourceDataChanged);
+    connect(source, &QAbstractItemModel::rowsInserted, this, &TaskFilterProxyModel::onSourceRowsInserted);
+    connect(source, &QAbstractItemModel::rowsAboutToBeRemoved,
+            this, &TaskFilterProxyModel::onSourceRowsAboutToBeRemoved);
+    connect(source, &QAbstractItemModel::rowsRemoved, this, &TaskFilterProxyModel::onSourceRowsRemoved);
+    connect(source, &QAbstractItemModel::rowsMoved, this, &TaskFilterProxyModel::onSourceRowsMoved);
+    connect(source, &QAbstractItemModel::layoutAboutToBeChanged,
+            this, &TaskFilterProxyModel::onSourceLayoutAboutToBeChanged);
+    connect(source, &QAbstractItemModel::layoutChanged, this, &TaskFilterProxyModel::onSourceLayoutChanged);
+    connect(source, &QAbstractItemModel::modelAboutToBeReset,
+            this, &TaskFilterProxyModel::onSourceModelAboutToBeReset);
+    connect(source, &QAbstractItemModel::modelReset, this, &TaskFilterProxyModel::onSourceModelReset);
+
+    rebuildMapping();
+}
+
+void TaskFilterProxyModel::setFilter(const TaskFilter& filter)
+{
+    if (filter == m_filter) {
+        return;
+    }
+
+    // A SQL-backed source reloads its page for the new filter; the reset
+    // rebuilds the mapping
+    if (m_source->isSqlBacked()) {
+        m_filter = filter;
+        m_source->setFilter(filter);
+        emit filterChanged();
+        return;
+    }
+
+    // An in-memory source only records it, for the page it loads if it
+    // grows past the SQL threshold
+    m_source->setFilter(filter);
+
+    // Only rows whose answer can change are evaluated: visible ones when
+    // the filter tightens, hidden ones when it loosens, each once otherwise
+    const bool tighter = filter.isSubsetOf(m_filter);
+    const bool looser = m_filter.isSubsetOf(filter);
+    m_filter = filter;
+
+    if (!looser) {
+        removeRejectedRows();
+    }
+    if (!tighter) {
+        insertAcceptedRows();
+    }
+
+    emit filterChanged();
+}
+
+void TaskFilterProxyModel::setCategoryFilter(const QString& category)
+{
+    TaskFilter filter = m_filter;
+    filter.category = category;
+    setFilter(filter);
+}
+
+void TaskFilterProxyModel::setStatusFilter(TaskStatus status)
+{
+    TaskFilter filter = m_filter;
+    filter.statuses = TaskFilter::statusBit(status);
+    setFilter(filter);
+}
+
+void TaskFilterProxyModel::clearFilter()
+{
+    setFilter(TaskFilter());
+}
+
+QModelIndex TaskFilterProxyModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || row < 0 || row >= m_proxyToSource.size() || column != 0) {
+        return QModelIndex();
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex TaskFilterProxyModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
+int TaskFilterProxyModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_proxyToSource.size();
+}
+
+int TaskFilterProxyModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex TaskFilterProxyModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid() || proxyIndex.row() >= m_proxyToSource.size()) {
+        return QModelIndex();
+    }
+    return m_source->index(m_proxyToSource.at(proxyIndex.row()), proxyIndex.column());
+}
+
+QModelIndex TaskFilterProxyModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) {
+        return QModelIndex();
+    }
+
+    const int row = proxyRowFor(sourceIndex.row());
+    return row >= 0 ? createIndex(row, sourceIndex.column()) : QModelIndex();
+}
+
+void TaskFilterProxyModel::onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                               const QVector<int> &roles)
+{
+    for (int sourceRow = topLeft.row(); sourceRow <= bottomRight.row(); ++sourceRow) {
+        const int row = lowerBound(sourceRow);
+        const bool visible = row < m_proxyToSource.size() && m_proxyToSource.at(row) == sourceRow;
+        const bool accepted = acceptsRow(sourceRow);
+
+        if (visible && accepted) {
+            QModelIndex proxyIndex = index(row, 0);
+            emit dataChanged(proxyIndex, proxyIndex, roles);
+        } else if (visible) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_proxyToSource.removeAt(row);
+            endRemoveRows();
+        } else if (accepted) {
+            beginInsertRows(QModelIndex(), row, row);
+            m_proxyToSource.insert(row, sourceRow);
+            endInsertRows();
+        }
+    }
+}
+
+void TaskFilterProxyModel::onSourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    // Rows after the insertion point shift down; their proxy rows don't move
+    const int count = last - first + 1;
+    for (int i = lowerBound(first); i < m_proxyToSource.size(); ++i) {
+        m_proxyToSource[i] += count;
+    }
+
+    for (int sourceRow = first; sourceRow <= last; ++sourceRow) {
+        if (acceptsRow(sourceRow)) {
+            const int row = lowerBound(sourceRow);
+            beginInsertRows(QModelIndex(), row, row);
+            m_proxyToSource.insert(row, sourceRow);
+            endInsertRows();
+        }
+    }
+}
+
+void TaskFilterProxyModel::onSourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    const int begin = lowerBound(first);
+    const int end = lowerBound(last + 1);
+    if (begin < end) {
+        beginRemoveRows(QModelIndex(), begin, end - 1);
+        m_proxyToSource.remove(begin, end - begin);
+        endRemoveRows();
+    }
+}
+
+void TaskFilterProxyModel::onSourceRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    const int count = last - first + 1;
+    for (int i = lowerBound(first); i < m_proxyToSource.size(); ++i) {
+        m_proxyToSource[i] -= count;
+    }
+}
+
+void TaskFilterProxyModel::onSourceRowsMoved(const QModelIndex &parent, int start, int end,
+                                             const QModelIndex &destination, int row)
+{
+    Q_UNUSED(parent)
+    Q_UNUSED(destination)
+
+    // TaskModel moves one row at a time when its sort key changes
+    if (start != end) {
+        onSourceLayoutAboutToBeChanged();
+        onSourceLayoutChanged();
+        return;
+    }
+
+    const int to = row > start ? row - 1 : row;
+    const int from = proxyRowFor(start);
+    const int delta = start < to ? -1 : 1;
+
+    // Rows between the old and new position shift by one
+    const int begin = lowerBound(qMin(start, to));
+    const int stop = lowerBound(qMax(start, to) + 1);
+    for (int i = begin; i < stop; ++i) {
+        if (i != from) {
+            m_proxyToSource[i] += delta;
+        }
+    }
+
+    if (from < 0) {
+        return;     // Hidden; visible rows keep their relative order
+    }
+
+    // Everything but the moved entry is sorted again; find its new slot
+    const int target = start > to
+        ? static_cast<int>(std::lower_bound(m_proxyToSource.cbegin(), m_proxyToSource.cbegin() + from, to)
+                           - m_proxyToSource.cbegin())
+        : static_cast<int>(std::lower_bound(m_proxyToSource.cbegin() + from + 1, m_proxyToSource.cend(), to)
+                           - m_proxyToSource.cbegin()) - 1;
+
+    if (target == from) {
+        m_proxyToSource[from] = to;
+        return;
+    }
+
+    beginMoveRows(QModelIndex(), from, from, QModelIndex(), target > from ? target + 1 : target);
+    m_proxyToSource.move(from, target);
+    m_proxyToSource[target] = to;
+    endMoveRows();
+}
+
+void TaskFilterProxyModel::onSourceLayoutAboutToBeChanged()
+{
+    emit layoutAboutToBeChanged();
+
+    m_layoutProxyIndexes = persistentIndexList();
+    m_layoutSourceIndexes.clear();
+    m_layoutSourceIndexes.reserve(m_layoutProxyIndexes.size());
+    for (const QModelIndex& proxyIndex : qAsConst(m_layoutProxyIndexes)) {
+        m_layoutSourceIndexes.append(QPersistentModelIndex(mapToSource(proxyIndex)));
+    }
+}
+
+void TaskFilterProxyModel::onSourceLayoutChanged()
+{
+    // A re-sort doesn't change which rows pass, only where they are
+    rebuildMapping();
+
+    QModelIndexList moved;
+    moved.reserve(m_layoutSourceIndexes.size());
+    for (const QPersistentModelIndex& sourceIndex : qAsConst(m_layoutSourceIndexes)) {
+        moved.append(mapFromSource(sourceIndex));
+    }
+    changePersistentIndexList(m_layoutProxyIndexes, moved);
+
+    m_layoutProxyIndexes.clear();
+    m_layoutSourceIndexes.clear();
+
+    emit layoutChanged();
+}
+
+void TaskFilterProxyModel::onSourceModelAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void TaskFilterProxyModel::onSourceModelReset()
+{
+    rebuildMapping();
+    endResetModel();
+}
+
+bool TaskFilterProxyModel::acceptsRow(int sourceRow) const
+{
+    return m_filter.matches(m_source->tasks().at(sourceRow));
+}
+
+int TaskFilterProxyModel::proxyRowFor(int sourceRow) const
+{
+    const int row = lowerBound(sourceRow);
+    return (row < m_proxyToSource.size() && m_proxyToSource.at(row) == sourceRow) ? row : -1;
+}
+
+int TaskFilterProxyModel::lowerBound(int sourceRow) const
+{
+    return static_cast<int>(std::lower_bound(m_proxyToSource.cbegin(), m_proxyToSource.cend(), sourceRow)
+                            - m_proxyToSource.cbegin());
+}
+
+void TaskFilterProxyModel::rebuildMapping()
+{
+    const int count = m_source->rowCount();
+    m_proxyToSource.clear();
+    m_proxyToSource.reserve(count);
+    for (int sourceRow = 0; sourceRow < count; ++sourceRow) {
+        if (acceptsRow(sourceRow)) {
+            m_proxyToSource.append(sourceRow);
+        }
+    }
+}
+
+void TaskFilterProxyModel::removeRejectedRows()
+{
+    // One pass builds the new mapping and notes each contiguous run of
+    // rejected rows, as (first proxy row, length)
+    QVector<int> kept;
+    kept.reserve(m_proxyToSource.size());
+    QVector<QPair<int, int>> runs;
+    for (int row = 0; row < m_proxyToSource.size(); ++row) {
+        const int sourceRow = m_proxyToSource.at(row);
+        if (acceptsRow(sourceRow)) {
+            kept.append(sourceRow);
+        } else if (!runs.isEmpty() && runs.last().first + runs.last().second == row) {
+            ++runs.last().second;
+        } else {
+            runs.append(qMakePair(row, 1));
+        }
+    }
+
+    if (runs.isEmpty()) {
+        return;
+    }
+    if (runs.size() > MAX_SIGNALED_RUNS) {
+        // Cheaper for views to rebuild once than to follow many ranges
+        beginResetModel();
+        m_proxyToSource.swap(kept);
+        endResetModel();
+        return;
+    }
+
+    // From the back, so earlier runs keep their rows
+    for (int i = runs.size() - 1; i >= 0; --i) {
+        const QPair<int, int>& run = runs.at(i);
+        beginRemoveRows(QModelIndex(), run.first, run.first + run.second - 1);
+        m_proxyToSource.remove(run.first, run.second);
+        endRemoveRows();
+    }
+}
+
+void TaskFilterProxyModel::insertAcceptedRows()
+{
+    // Walk the hidden rows only, merging the accepted ones into a new
+    // mapping in one pass; each contiguous run is noted as (first row in
+    // the new mapping, length)
+    const int count = m_source->rowCount();
+    QVector<int> merged;
+    merged.reserve(count);
+    QVector<QPair<int, int>> runs;
+    int row = 0;
+    for (int sourceRow = 0; sourceRow < count; ++sourceRow) {
+        if (row < m_proxyToSource.size() && m_proxyToSource.at(row) == sourceRow) {
+            merged.append(sourceRow);
+            ++row;
+        } else if (acceptsRow(sourceRow)) {
+            if (runs.isEmpty() || runs.last().first + runs.last().second != merged.size()) {
+                runs.append(qMakePair(merged.size(), 0));
+            }
+            ++runs.last().second;
+            merged.append(sourceRow);
+        }
+    }
+
+    if (runs.isEmpty()) {
+        return;
+    }
+    if (runs.size() > MAX_SIGNALED_RUNS) {
+        beginResetModel();
+        m_proxyToSource.swap(merged);
+        endResetModel();
+        return;
+    }
+
+    // In order, so each run's row in the new mapping is also its row once
+    // the runs before it are in
+    for (const QPair<int, int>& run : qAsConst(runs)) {
+        beginInsertRows(QModelIndex(), run.first, run.first + run.second - 1);
+        m_proxyToSource.insert(run.first, run.second, 0);
+        std::copy(merged.cbegin() + run.first, merged.cbegin() + run.first + run.second,
+                  m_proxyToSource.begin() + run.first);
+        endInsertRows();
+    }
+}
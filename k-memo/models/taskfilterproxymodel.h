@@ -0,0 +1,78 @@
+#ifndef TASKFILTERPROXYMODEL_H
+#define TASKFILTERPROXYMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QPersistentModelIndex>
+#include <QVector>
+#include "taskfilter.h"
+
+class TaskModel;
+
+// Filtered view over a fully loaded TaskModel, in the source's order.
+//
+// The visible rows are a sorted list of source rows. Source changes are
+// applied to that list directly: an inserted or edited row is evaluated on
+// its own, a removed row is dropped. When the filter changes, only rows
+// whose answer can change are evaluated: a tighter filter checks the
+// visible rows, a looser one the hidden rows. Nothing is reset, so views
+// keep their selection and scroll position.
+class TaskFilterProxyModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit TaskFilterProxyModel(TaskModel* source, QObject *parent = nullptr);
+
+    TaskFilter filter() const { return m_filter; }
+    void setFilter(const TaskFilter& filter);
+    void setCategoryFilter(const QString& category);
+    void setStatusFilter(TaskStatus status);
+    void clearFilter();
+
+    // QAbstractProxyModel interface
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+
+    TaskModel* taskModel() const { return m_source; }
+
+signals:
+    void filterChanged();
+
+private slots:
+    void onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                             const QVector<int> &roles);
+    void onSourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void onSourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void onSourceRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onSourceRowsMoved(const QModelIndex &parent, int start, int end,
+                           const QModelIndex &destination, int row);
+    void onSourceLayoutAboutToBeChanged();
+    void onSourceLayoutChanged();
+    void onSourceModelAboutToBeReset();
+    void onSourceModelReset();
+
+private:
+    bool acceptsRow(int sourceRow) const;
+    int proxyRowFor(int sourceRow) const;
+    int lowerBound(int sourceRow) const;
+    void rebuildMapping();
+    void removeRejectedRows();
+    void insertAcceptedRows();
+
+    TaskModel* m_source;
+    TaskFilter m_filter;
+    QVector<int> m_proxyToSource;       // Visible source rows, ascending
+
+    // A filter change that shows or hides more runs than this resets
+    static const int MAX_SIGNALED_RUNS = 32;
+
+    // Held across a source layout change
+    QModelIndexList m_layoutProxyIndexes;
+    QVector<QPersistentModelIndex> m_layoutSourceIndexes;
+};
+
+#endif // TASKFILTERPROXYMODEL_H
@@ -0,0 +1,49 @@
+#include "taskid.h"
+#include <QUuid>
+#include <QtEndian>
+
+namespace {
+const int RFC4122_SIZE = 16;
+}
+
+TaskId TaskId::createUuid()
+{
+    return fromRfc4122(QUuid::createUuid().toRfc4122());
+}
+
+TaskId TaskId::fromString(const QString& str)
+{
+    // Accepts the usual forms, with or without braces
+    QUuid uuid(str);
+    if (uuid.isNull()) {
+        return TaskId();
+    }
+    return fromRfc4122(uuid.toRfc4122());
+}
+
+TaskId TaskId::fromRfc4122(const QByteArray& bytes)
+{
+    if (bytes.size() != RFC4122_SIZE) {
+        return TaskId();
+    }
+
+    const uchar* data = reinterpret_cast<const uchar*>(bytes.constData());
+    return TaskId(qFromBigEndian<quint64>(data), qFromBigEndian<quint64>(data + 8));
+}
+
+QString TaskId::toString() const
+{
+    if (isNull()) {
+        return QString();
+    }
+    return QUuid::fromRfc4122(toRfc4122()).toString(QUuid::WithoutBraces);
+}
+
+QByteArray TaskId::toRfc4122() const
+{
+    QByteArray bytes(RFC4122_SIZE, Qt::Uninitialized);
+    uchar* data = reinterpret_cast<uchar*>(bytes.data());
+    qToBigEndian(m_high, data);
+    qToBigEndian(m_low, data + 8);
+    return bytes;
+}
@@ -0,0 +1,54 @@
+#ifndef TASKID_H
+#define TASKID_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMetaType>
+
+// 128-bit task identifier (a UUID held as two integers). Compares and hashes
+// without touching strings; the textual form is only for the UI and JSON,
+// the 16-byte RFC 4122 form is what the database stores.
+class TaskId
+{
+public:
+    TaskId() : m_high(0), m_low(0) {}
+
+    static TaskId createUuid();
+    static TaskId fromString(const QString& str);
+    static TaskId fromRfc4122(const QByteArray& bytes);
+
+    QString toString() const;
+    QByteArray toRfc4122() const;
+
+    bool isNull() const { return m_high == 0 && m_low == 0; }
+
+    bool operator==(const TaskId& other) const { return m_high == other.m_high && m_low == other.m_low; }
+    bool operator!=(const TaskId& other) const { return !(*this == other); }
+    bool operator<(const TaskId& other) const
+    {
+        return m_high < other.m_high || (m_high == other.m_high && m_low < other.m_low);
+    }
+
+    // Qt 6 hashes to size_t, Qt 5 to uint
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    friend size_t qHash(const TaskId& id, size_t seed = 0) noexcept
+#else
+    friend uint qHash(const TaskId& id, uint seed = 0) noexcept
+#endif
+    {
+        // Version 4 UUIDs are random already; folding the halves is enough
+        return qHash(id.m_high ^ id.m_low, seed);
+    }
+
+private:
+    TaskId(quint64 high, quint64 low) : m_high(high), m_low(low) {}
+
+    quint64 m_high;
+    quint64 m_low;
+};
+
+Q_DECLARE_TYPEINFO(TaskId, Q_PRIMITIVE_TYPE);
+Q_DECLARE_METATYPE(TaskId)
+
+#endif // TASKID_H
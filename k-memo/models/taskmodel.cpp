@@ -1,25 +1,71 @@
 #include "taskmodel.h"
 #include "database/databasemanager.h"
+#include "database/taskquery.h"
 #include <QDebug>
+#include <QSet>
+#include <functional>
 #include <algorithm>
 
+namespace {
+// Upper bound on one transition timer wait, so wall clock jumps and
+// suspend are caught up with within a few hours at worst
+const qint64 MAX_TRANSITION_WAIT_MS = 6 * 3600 * 1000;
+
+// Batches touching more rows than this are applied with one model reset
+const int BATCH_RESET_THRESHOLD = 1000;
+
+// Enum-derived display strings, built once and shared by every row
+const QVariant& priorityStringVariant(TaskPriority priority)
+{
+    static const QVariant variants[] = {
+        taskPriorityToString(TaskPriority::Low),
+        taskPriorityToString(TaskPriority::Normal),
+        taskPriorityToString(TaskPriority::High),
+        taskPriorityToString(TaskPriority::Urgent)
+    };
+    int index = static_cast<int>(priority) - static_cast<int>(TaskPriority::Low);
+    return (index >= 0 && index < 4) ? variants[index] : variants[1];
+}
+
+const QVariant& statusStringVariant(TaskStatus status)
+{
+    static const QVariant variants[] = {
+        taskStatusToString(TaskStatus::Pending),
+        taskStatusToString(TaskStatus::InProgress),
+        taskStatusToString(TaskStatus::Completed),
+        taskStatusToString(TaskStatus::Cancelled)
+    };
+    int index = static_cast<int>(status);
+    return (index >= 0 && index < 4) ? variants[index] : variants[0];
+}
+}
+
 TaskModel::TaskModel(QObject *parent)
     : QAbstractListModel(parent)
+    , m_overdueCount(0)
+    , m_dueTodayCount(0)
+    , m_version(0)
     , m_database(DatabaseManager::instance())
-    , m_hasFilter(false)
+    , m_sqlBacked(false)
+    , m_sqlHasMore(false)
     , m_sortRole(TitleRole)
     , m_sortOrder(Qt::AscendingOrder)
-    , m_overdueTimer(new QTimer(this))
+    , m_transitionTimer(new QTimer(this))
+    , m_timeContext(TaskTimeContext::capture())
 {
     // Connect to database signals
     connect(m_database, &DatabaseManager::taskInserted, this, &TaskModel::onTaskInserted);
     connect(m_database, &DatabaseManager::taskUpdated, this, &TaskModel::onTaskUpdated);
     connect(m_database, &DatabaseManager::taskDeleted, this, &TaskModel::onTaskDeleted);
+    connect(m_database, &DatabaseManager::batchStarted, this, &TaskModel::onBatchStarted);
+    connect(m_database, &DatabaseManager::batchFinished, this, &TaskModel::onBatchFinished);
+    connect(m_database, &DatabaseManager::changesRolledBack, this, &TaskModel::refresh);
     
     // Setup overdue timer
-    m_overdueTimer->setInterval(60000); // Check every minute
-    connect(m_overdueTimer, &QTimer::timeout, this, &TaskModel::refreshOverdueStatus);
-    m_overdueTimer->start();
+    // Armed for the next overdue/due-today transition rather than polling
+    m_transitionTimer->setSingleShot(true);
+    m_transitionTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_transitionTimer, &QTimer::timeout, this, &TaskModel::processTimeTransitions);
     
     // Load initial data
     loadTasks();
@@ -39,18 +85,19 @@ QVariant TaskModel::data(const QModelIndex &index, int role) const
     
     const Task& task = m_tasks.at(index.row());
     
+    // Everything but the id and description is returned without allocating
     switch (role) {
     case IdRole:
-        return task.id();
+        return task.id().toString();
     case TitleRole:
     case Qt::DisplayRole:
         return task.title();
     case DescriptionRole:
         return task.description();
     case CreateTimeRole:
-        return task.createTime();
+        return m_displayData.at(index.row()).createTime;
     case DueTimeRole:
-        return task.dueTime();
+        return m_displayData.at(index.row()).dueTime;
     case PriorityRole:
         return static_cast<int>(task.priority());
     case StatusRole:
@@ -58,19 +105,19 @@ QVariant TaskModel::data(const QModelIndex &index, int role) const
     case CategoryRole:
         return task.category();
     case TagsRole:
-        return task.tags();
+        return m_displayData.at(index.row()).tags;
     case ReminderEnabledRole:
         return task.reminderEnabled();
     case ReminderMinutesRole:
         return task.reminderMinutes();
     case IsOverdueRole:
-        return task.isOverdue();
+        return task.isOverdue(m_timeContext);
     case IsDueTodayRole:
-        return task.isDueToday();
+        return task.isDueToday(m_timeContext);
     case PriorityStringRole:
-        return task.priorityString();
+        return priorityStringVariant(task.priority());
     case StatusStringRole:
-        return task.statusString();
+        return statusStringVariant(task.status());
     default:
         return QVariant();
     }
@@ -82,44 +129,42 @@ bool TaskModel::setData(const QModelIndex &index, const QVariant &value, int rol
         return false;
     }
     
-    Task& task = m_tasks[index.row()];
-    bool changed = false;
+    // Edit a copy; the row is replaced when the database confirms the write
+    Task task = m_tasks.at(index.row());
     
     switch (role) {
     case TitleRole:
-        if (task.title() != value.toString()) {
-            task.setTitle(value.toString());
-            changed = true;
-        }
+        task.setTitle(value.toString());
         break;
     case DescriptionRole:
-        if (task.description() != value.toString()) {
-            task.setDescription(value.toString());
-            changed = true;
-        }
+        task.setDescription(value.toString());
         break;
-    case StatusRole:
-        if (static_cast<int>(task.status()) != value.toInt()) {
-            task.setStatus(static_cast<TaskStatus>(value.toInt()));
-            changed = true;
+    case StatusRole: {
+        // Dependents are released on the strength of this status, so
+        // transitions the task doesn't allow are refused here
+        TaskStatus newStatus = static_cast<TaskStatus>(value.toInt());
+        if (newStatus != task.status() && !task.isValidTransition(newStatus)) {
+            return false;
         }
+        task.setStatus(newStatus);
         break;
+    }
     // Add more cases as needed
     default:
         return false;
     }
     
-    if (changed) {
-        // Update in database first
-        if (m_database->updateTask(task)) {
-            emit dataChanged(index, index, {role});
-        } else {
-            qWarning() << "Failed to update task in database";
-            return false;
-        }
+    if (!task.isDirty()) {
+        return false;
+    }
+    
+    // Only the changed column is written; the view is refreshed through onTaskUpdated
+    if (!m_database->updateTask(task)) {
+        qWarning() << "Failed to update task in database";
+        return false;
     }
     
-    return changed;
+    return true;
 }
 
 Qt::ItemFlags TaskModel::flags(const QModelIndex &index) const
@@ -178,135 +223,792 @@ Task TaskModel::getTask(int row) const
 void TaskModel::loadTasks()
 {
     beginResetModel();
+    m_timeContext = TaskTimeContext::capture();
 
-    // Load tasks based on filter settings
-    if (m_hasFilter) {
-        QList<Task> allTasks = m_database->getAllTasks();
-        m_tasks.clear();
+    // Held-back notifications are superseded by the reload
+    m_pendingChanges.clear();
+    m_pendingDeletes.clear();
 
-        // Apply filters
-        for (const Task& task : allTasks) {
-            if (matchesFilter(task)) {
-                m_tasks.append(task);
-            }
-        }
+    // Small databases are loaded whole and filtered by TaskFilterProxyModel;
+    // large ones only as the page SQLite selects and orders. The page is
+    // still sorted here so in-memory ordering matches for incremental inserts.
+    m_sqlBacked = m_database->getTotalTaskCount() > SQL_PUSHDOWN_THRESHOLD;
+    if (m_sqlBacked) {
+        m_tasks = m_database->queryTasks(currentQuery());
     } else {
         m_tasks = m_database->getAllTasks();
     }
+    m_sqlHasMore = m_sqlBacked && m_tasks.size() >= SQL_PAGE_SIZE;
 
     sortTasks();
+    rebuildTimeTransitions();
+    rebuildFacets();
     endResetModel();
     emit taskCountChanged();
+    emitFacetsChanged();
 }
 
 void TaskModel::sortTasks()
 {
-    std::sort(m_tasks.begin(), m_tasks.end(), [this](const Task& a, const Task& b) {
-        bool result = false;
+    ++m_version;
+    m_sorter.sort(&m_tasks);
 
-        switch (m_sortRole) {
-        case TitleRole:
-            result = a.title() < b.title();
-            break;
-        case CreateTimeRole:
-            result = a.createTime() < b.createTime();
-            break;
-        case DueTimeRole:
-            if (a.dueTime().isValid() && b.dueTime().isValid()) {
-                result = a.dueTime() < b.dueTime();
-            } else if (a.dueTime().isValid()) {
-                result = true; // Valid date comes before invalid
-            } else {
-                result = false; // Invalid date comes after valid
-            }
-            break;
-        case PriorityRole:
-            result = static_cast<int>(a.priority()) > static_cast<int>(b.priority()); // Higher priority first
-            break;
-        case StatusRole:
-            result = static_cast<int>(a.status()) < static_cast<int>(b.status());
-            break;
-        case CategoryRole:
-            result = a.category() < b.category();
-            break;
-        default:
-            result = a.title() < b.title(); // Fallback to title sorting
-            break;
-        }
+    rebuildDisplayData();
+    rebuildRowIndex();
+}
+
+bool TaskModel::lessThan(const Task& a, const Task& b) const
+{
+    // Same total order as the bulk sort (ties broken by id), which is what
+    // binary-search insertion relies on
+    return m_sorter.lessThan(a, b);
+}
+
+TaskSorter::Key TaskModel::sortKeyForRole(TaskRoles role)
+{
+    switch (role) {
+    case CreateTimeRole: return TaskSorter::CreateTime;
+    case DueTimeRole: return TaskSorter::DueTime;
+    case PriorityRole: return TaskSorter::Priority;
+    case StatusRole: return TaskSorter::Status;
+    case CategoryRole: return TaskSorter::Category;
+    default: return TaskSorter::Title;    // Title is also the fallback
+    }
+}
+
+int TaskModel::insertionRow(const Task& task, int begin, int end) const
+{
+    auto less = [this](const Task& a, const Task& b) { return lessThan(a, b); };
+    return static_cast<int>(std::lower_bound(m_tasks.cbegin() + begin, m_tasks.cbegin() + end, task, less)
+                            - m_tasks.cbegin());
+}
+
+int TaskModel::repositionRow(int row)
+{
+    const Task& task = m_tasks.at(row);
+    const bool movesUp = row > 0 && lessThan(task, m_tasks.at(row - 1));
+    const bool movesDown = row + 1 < m_tasks.size() && lessThan(m_tasks.at(row + 1), task);
+    if (!movesUp && !movesDown) {
+        return row;
+    }
+
+    // The rest of the list is still sorted, so only the side the row
+    // moves towards is searched; destination is in pre-move numbering
+    const int destination = movesUp ? insertionRow(task, 0, row)
+                                    : insertionRow(task, row + 1, m_tasks.size());
+    const int newRow = movesUp ? destination : destination - 1;
+
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination);
+    m_tasks.move(row, newRow);
+    m_displayData.move(row, newRow);
+    for (int i = qMin(row, newRow); i <= qMax(row, newRow); ++i) {
+        m_rowIndex[m_tasks.at(i).id()] = i;
+    }
+    endMoveRows();
+
+    return newRow;
+}
+
+void TaskModel::applySortChange()
+{
+    // Views keep their selection and current item: persistent indexes are
+    // carried over to the rows' new positions
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    const QModelIndexList persistent = persistentIndexList();
+    QVector<TaskId> persistentIds;
+    persistentIds.reserve(persistent.size());
+    for (const QModelIndex& index : persistent) {
+        persistentIds.append(m_tasks.at(index.row()).id());
+    }
+
+    sortTasks();
+
+    QModelIndexList moved;
+    moved.reserve(persistent.size());
+    for (const TaskId& taskId : qAsConst(persistentIds)) {
+        moved.append(index(findTaskRow(taskId)));
+    }
+    changePersistentIndexList(persistent, moved);
 
-        return m_sortOrder == Qt::AscendingOrder ? result : !result;
-    });
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
 }
 
 void TaskModel::onTaskInserted(const Task& task)
 {
-    if (matchesFilter(task)) {
-        beginInsertRows(QModelIndex(), m_tasks.size(), m_tasks.size());
-        m_tasks.append(task);
-        endInsertRows();
-        emit taskCountChanged();
+    if (m_sqlBacked && !m_filter.matches(task)) {
+        return;
+    }
+
+    if (m_database->isBatching()) {
+        // Deleted earlier in this batch, so its row is still here: the pair
+        // is an update of that row
+        if (m_pendingDeletes.remove(task.id())) {
+            m_pendingChanges.insert(task.id(), {task, Task::AllFields});
+            return;
+        }
+        if (findTaskRow(task.id()) >= 0) {
+            return;
+        }
+        PendingChange& change = m_pendingChanges[task.id()];
+        change.task = task;
+        change.fields = Task::AllFields;
+        return;
+    }
+
+    if (findTaskRow(task.id()) >= 0) {
+        return;
     }
+
+    // A full page only takes tasks that sort inside it
+    const int row = insertionRow(task, 0, m_tasks.size());
+    if (m_sqlBacked && row >= SQL_PAGE_SIZE) {
+        m_sqlHasMore = true;
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), row, row);
+    ++m_version;
+    m_tasks.insert(row, task);
+    m_displayData.insert(row, displayDataFor(task));
+    renumberRows(row);
+    endInsertRows();
+    scheduleTimeTransition(task);
+    adjustFacets(nullptr, &task);
+    settleSqlPage();
+    emit taskCountChanged();
+    emitFacetsChanged();
 }
 
-void TaskModel::onTaskUpdated(const Task& task)
+void TaskModel::onTaskUpdated(const Task& task, Task::Fields changedFields)
 {
+    // A SQL page only holds matching tasks, so an edit can take a task out
+    // of it or bring one in
+    if (m_sqlBacked) {
+        if (!m_filter.matches(task)) {
+            onTaskDeleted(task.id());
+            return;
+        }
+        if (findTaskRow(task.id()) < 0 && !m_pendingChanges.contains(task.id())) {
+            onTaskInserted(task);
+            return;
+        }
+    }
+
+    if (m_database->isBatching()) {
+        auto pending = m_pendingChanges.find(task.id());
+        if (pending != m_pendingChanges.end()) {
+            pending->task = task;
+            pending->fields |= changedFields;
+        } else if (findTaskRow(task.id()) >= 0) {
+            m_pendingChanges.insert(task.id(), {task, changedFields});
+        }
+        return;
+    }
+
     int row = findTaskRow(task.id());
     if (row >= 0) {
+        adjustFacets(&m_tasks.at(row), &task);
+        ++m_version;
         m_tasks[row] = task;
+        if (changedFields & (Task::CreateTimeField | Task::DueTimeField | Task::TagsField)) {
+            m_displayData[row] = displayDataFor(task);
+        }
+        row = repositionRow(row);
+        if (changedFields & Task::DueTimeField) {
+            scheduleTimeTransition(task);
+        }
         QModelIndex index = this->index(row);
-        emit dataChanged(index, index);
+        emit dataChanged(index, index, rolesForFields(changedFields));
+
+        // Moved to the end of the page, it may sort past it
+        const int count = m_tasks.size();
+        settleSqlPage({task.id()});
+        if (m_tasks.size() != count) {
+            emit taskCountChanged();
+        }
+        emitFacetsChanged();
+    }
+}
+
+void TaskModel::onBatchStarted()
+{
+    m_pendingChanges.clear();
+    m_pendingDeletes.clear();
+}
+
+void TaskModel::onBatchFinished()
+{
+    const int changeCount = m_pendingChanges.size() + m_pendingDeletes.size();
+    if (changeCount == 0) {
+        return;
+    }
+
+    const int previousCount = m_tasks.size();
+    ++m_version;
+
+    // Updated and inserted rows, which may sort past the end of a SQL page
+    QSet<TaskId> changed;
+    if (m_sqlBacked) {
+        for (auto it = m_pendingChanges.cbegin(); it != m_pendingChanges.cend(); ++it) {
+            changed.insert(it.key());
+        }
+    }
+
+    if (changeCount > BATCH_RESET_THRESHOLD) {
+        // Cheaper for views to rebuild once than to follow thousands of ranges
+        beginResetModel();
+        QVector<Task> tasks;
+        tasks.reserve(m_tasks.size() + m_pendingChanges.size());
+        for (const Task& task : qAsConst(m_tasks)) {
+            if (m_pendingDeletes.contains(task.id())) {
+                continue;
+            }
+            auto pending = m_pendingChanges.find(task.id());
+            if (pending != m_pendingChanges.end()) {
+                tasks.append(pending->task);
+                m_pendingChanges.erase(pending);
+            } else {
+                tasks.append(task);
+            }
+        }
+        for (const PendingChange& change : qAsConst(m_pendingChanges)) {
+            tasks.append(change.task);
+        }
+        m_tasks.swap(tasks);
+        sortTasks();
+        const int end = sqlPageEnd(changed);
+        if (end < m_tasks.size()) {
+            m_tasks.resize(end);
+            m_displayData.resize(end);
+            m_sqlHasMore = true;
+            rebuildRowIndex();
+        }
+        rebuildTimeTransitions();
+        rebuildFacets();
+        endResetModel();
+        fillSqlPage();
+    } else {
+        applyPendingDeletes();
+        applyPendingUpdates();
+        applyPendingInserts();
+        settleSqlPage(changed);
+    }
+
+    m_pendingChanges.clear();
+    m_pendingDeletes.clear();
+
+    if (m_tasks.size() != previousCount) {
+        emit taskCountChanged();
     }
+    emitFacetsChanged();
 }
 
-void TaskModel::onTaskDeleted(const QString& taskId)
+// Where the page the rows hold ends: rows past SQL_PAGE_SIZE leave it, and
+// while more rows exist in SQL, so do changed rows left at its end, which
+// are only known to sort after every row that didn't change
+int TaskModel::sqlPageEnd(const QSet<TaskId>& changed) const
 {
+    if (!m_sqlBacked) {
+        return m_tasks.size();
+    }
+
+    int end = qMin<int>(m_tasks.size(), SQL_PAGE_SIZE);
+    if (m_sqlHasMore) {
+        while (end > 0 && changed.contains(m_tasks.at(end - 1).id())) {
+            --end;
+        }
+    }
+    return end;
+}
+
+void TaskModel::removeTailRows(int first)
+{
+    const int last = m_tasks.size() - 1;
+    if (first > last) {
+        return;
+    }
+
+    for (int row = first; row <= last; ++row) {
+        adjustFacets(&m_tasks.at(row), nullptr);
+        m_rowIndex.remove(m_tasks.at(row).id());
+    }
+
+    beginRemoveRows(QModelIndex(), first, last);
+    ++m_version;
+    m_tasks.remove(first, last - first + 1);
+    m_displayData.remove(first, last - first + 1);
+    endRemoveRows();
+}
+
+// Keeps the page the head of the SQL order after rows were added, changed
+// or removed: rows that may not belong leave, and a short page is refilled
+void TaskModel::settleSqlPage(const QSet<TaskId>& changed)
+{
+    if (!m_sqlBacked) {
+        return;
+    }
+
+    const int end = sqlPageEnd(changed);
+    if (end < m_tasks.size()) {
+        removeTailRows(end);
+        m_sqlHasMore = true;
+    }
+    fillSqlPage();
+}
+
+void TaskModel::fillSqlPage()
+{
+    if (!m_sqlBacked || !m_sqlHasMore || m_tasks.size() >= SQL_PAGE_SIZE) {
+        return;
+    }
+
+    // The rows are the head of the order, so the missing ones follow them
+    TaskQuery query = currentQuery();
+    const int wanted = SQL_PAGE_SIZE - m_tasks.size();
+    query.setLimit(wanted, m_tasks.size());
+    QVector<Task> tail = m_database->queryTasks(query);
+    m_sqlHasMore = tail.size() >= wanted;
+
+    tail.erase(std::remove_if(tail.begin(), tail.end(), [this](const Task& task) {
+        return findTaskRow(task.id()) >= 0;
+    }), tail.end());
+    if (tail.isEmpty()) {
+        return;
+    }
+    m_sorter.sort(&tail);
+
+    const int first = m_tasks.size();
+    beginInsertRows(QModelIndex(), first, first + tail.size() - 1);
+    ++m_version;
+    for (const Task& task : qAsConst(tail)) {
+        m_rowIndex.insert(task.id(), m_tasks.size());
+        m_tasks.append(task);
+        m_displayData.append(displayDataFor(task));
+    }
+    endInsertRows();
+
+    for (const Task& task : qAsConst(tail)) {
+        scheduleTimeTransition(task);
+        adjustFacets(nullptr, &task);
+    }
+}
+
+void TaskModel::applyPendingDeletes()
+{
+    if (m_pendingDeletes.isEmpty()) {
+        return;
+    }
+
+    QVector<int> rows;
+    rows.reserve(m_pendingDeletes.size());
+    for (const TaskId& taskId : qAsConst(m_pendingDeletes)) {
+        const int row = findTaskRow(taskId);
+        adjustFacets(&m_tasks.at(row), nullptr);
+        rows.append(row);
+    }
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+
+    // Bottom up, one removal per contiguous run
+    for (int i = 0; i < rows.size();) {
+        const int last = rows.at(i);
+        int first = last;
+        while (++i < rows.size() && rows.at(i) == first - 1) {
+            --first;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        m_tasks.remove(first, last - first + 1);
+        m_displayData.remove(first, last - first + 1);
+        endRemoveRows();
+    }
+
+    rebuildRowIndex();
+}
+
+void TaskModel::applyPendingUpdates()
+{
+    QVector<int> rows;
+    Task::Fields fields = Task::NoField;
+    bool outOfOrder = false;
+
+    for (auto it = m_pendingChanges.begin(); it != m_pendingChanges.end();) {
+        const int row = findTaskRow(it.key());
+        if (row < 0) {
+            ++it;       // New task, inserted afterwards
+            continue;
+        }
+
+        adjustFacets(&m_tasks.at(row), &it->task);
+        m_tasks[row] = it->task;
+        if (it->fields & (Task::CreateTimeField | Task::DueTimeField | Task::TagsField)) {
+            m_displayData[row] = displayDataFor(it->task);
+        }
+        if (it->fields & Task::DueTimeField) {
+            scheduleTimeTransition(it->task);
+        }
+        fields |= it->fields;
+        rows.append(row);
+        it = m_pendingChanges.erase(it);
+    }
+
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    for (int row : qAsConst(rows)) {
+        if ((row > 0 && lessThan(m_tasks.at(row), m_tasks.at(row - 1)))
+            || (row + 1 < m_tasks.size() && lessThan(m_tasks.at(row + 1), m_tasks.at(row)))) {
+            outOfOrder = true;
+            break;
+        }
+    }
+
+    // A single layout change instead of one row move per changed sort key
+    if (outOfOrder) {
+        QVector<TaskId> ids;
+        ids.reserve(rows.size());
+        for (int row : qAsConst(rows)) {
+            ids.append(m_tasks.at(row).id());
+        }
+        applySortChange();
+        rows.clear();
+        for (const TaskId& taskId : qAsConst(ids)) {
+            rows.append(findTaskRow(taskId));
+        }
+    }
+
+    // One dataChanged per contiguous run of changed rows
+    std::sort(rows.begin(), rows.end());
+    const QVector<int> roles = rolesForFields(fields);
+    for (int i = 0; i < rows.size();) {
+        const int first = rows.at(i);
+        int last = first;
+        while (++i < rows.size() && rows.at(i) == last + 1) {
+            ++last;
+        }
+        emit dataChanged(index(first), index(last), roles);
+    }
+}
+
+void TaskModel::applyPendingInserts()
+{
+    if (m_pendingChanges.isEmpty()) {
+        return;
+    }
+
+    QVector<Task> added;
+    added.reserve(m_pendingChanges.size());
+    for (const PendingChange& change : qAsConst(m_pendingChanges)) {
+        added.append(change.task);
+    }
+    m_sorter.sort(&added);
+
+    // Positions are found against the rows as they were; tasks landing in
+    // the same gap go in with one insertion
+    QVector<int> positions;
+    positions.reserve(added.size());
+    for (const Task& task : qAsConst(added)) {
+        positions.append(insertionRow(task, 0, m_tasks.size()));
+    }
+
+    int inserted = 0;
+    for (int i = 0; i < added.size();) {
+        int end = i + 1;
+        while (end < added.size() && positions.at(end) == positions.at(i)) {
+            ++end;
+        }
+
+        const int first = positions.at(i) + inserted;
+        beginInsertRows(QModelIndex(), first, first + (end - i) - 1);
+        for (int k = i; k < end; ++k) {
+            m_tasks.insert(first + (k - i), added.at(k));
+            m_displayData.insert(first + (k - i), displayDataFor(added.at(k)));
+        }
+        endInsertRows();
+
+        inserted += end - i;
+        i = end;
+    }
+
+    rebuildRowIndex();
+    for (const Task& task : qAsConst(added)) {
+        scheduleTimeTransition(task);
+        adjustFacets(nullptr, &task);
+    }
+}
+
+TaskModel::RowDisplayData TaskModel::displayDataFor(const Task& task)
+{
+    RowDisplayData display;
+    display.createTime = task.createTime();
+    display.dueTime = task.dueTime();
+    display.tags = task.tags();
+    return display;
+}
+
+void TaskModel::rebuildDisplayData()
+{
+    m_displayData.clear();
+    m_displayData.reserve(m_tasks.size());
+    for (const Task& task : m_tasks) {
+        m_displayData.append(displayDataFor(task));
+    }
+}
+
+QVector<int> TaskModel::rolesForFields(Task::Fields fields)
+{
+    if (fields == Task::AllFields) {
+        return QVector<int>(); // Everything changed
+    }
+
+    QVector<int> roles;
+    if (fields & Task::TitleField) {
+        roles << TitleRole << Qt::DisplayRole;
+    }
+    if (fields & Task::DescriptionField) {
+        roles << DescriptionRole;
+    }
+    if (fields & Task::CreateTimeField) {
+        roles << CreateTimeRole;
+    }
+    if (fields & Task::DueTimeField) {
+        roles << DueTimeRole << IsOverdueRole << IsDueTodayRole;
+    }
+    if (fields & Task::PriorityField) {
+        roles << PriorityRole << PriorityStringRole;
+    }
+    if (fields & Task::StatusField) {
+        roles << StatusRole << StatusStringRole << IsOverdueRole;
+    }
+    if (fields & Task::CategoryField) {
+        roles << CategoryRole;
+    }
+    if (fields & Task::TagsField) {
+        roles << TagsRole;
+    }
+    if (fields & Task::ReminderEnabledField) {
+        roles << ReminderEnabledRole;
+    }
+    if (fields & Task::ReminderMinutesField) {
+        roles << ReminderMinutesRole;
+    }
+    return roles;
+}
+
+void TaskModel::onTaskDeleted(const TaskId& taskId)
+{
+    if (m_database->isBatching()) {
+        m_pendingChanges.remove(taskId);
+        if (findTaskRow(taskId) >= 0) {
+            m_pendingDeletes.insert(taskId);
+        }
+        return;
+    }
+
     int row = findTaskRow(taskId);
     if (row >= 0) {
+        adjustFacets(&m_tasks.at(row), nullptr);
         beginRemoveRows(QModelIndex(), row, row);
+        ++m_version;
         m_tasks.removeAt(row);
+        m_displayData.removeAt(row);
+        m_rowIndex.remove(taskId);
+        renumberRows(row);
         endRemoveRows();
+        settleSqlPage();
         emit taskCountChanged();
+        emitFacetsChanged();
     }
 }
 
-int TaskModel::findTaskRow(const QString& taskId) const
+int TaskModel::findTaskRow(const TaskId& taskId) const
 {
+    return m_rowIndex.value(taskId, -1);
+}
+
+void TaskModel::rebuildRowIndex()
+{
+    m_rowIndex.clear();
+    m_rowIndex.reserve(m_tasks.size());
     for (int i = 0; i < m_tasks.size(); ++i) {
-        if (m_tasks.at(i).id() == taskId) {
-            return i;
+        m_rowIndex.insert(m_tasks.at(i).id(), i);
+    }
+}
+
+void TaskModel::renumberRows(int fromRow)
+{
+    for (int i = fromRow; i < m_tasks.size(); ++i) {
+        m_rowIndex[m_tasks.at(i).id()] = i;
+    }
+}
+
+void TaskModel::scheduleTimeTransition(const Task& task)
+{
+    const qint64 at = task.nextTimeStateChange(m_timeContext);
+    if (at == Task::NO_TIME) {
+        return;
+    }
+
+    m_transitions.append({at, task.dueTimeMsecs(), task.id()});
+    std::push_heap(m_transitions.begin(), m_transitions.end(), TimeTransition::later);
+
+    if (m_transitions.first().atMs == at) {
+        armTransitionTimer();
+    }
+}
+
+void TaskModel::rebuildTimeTransitions()
+{
+    m_transitions.clear();
+    m_transitions.reserve(m_tasks.size());
+    for (const Task& task : qAsConst(m_tasks)) {
+        const qint64 at = task.nextTimeStateChange(m_timeContext);
+        if (at != Task::NO_TIME) {
+            m_transitions.append({at, task.dueTimeMsecs(), task.id()});
         }
     }
-    return -1;
+    std::make_heap(m_transitions.begin(), m_transitions.end(), TimeTransition::later);
+
+    armTransitionTimer();
 }
 
-bool TaskModel::matchesFilter(const Task& task) const
+void TaskModel::armTransitionTimer()
 {
-    if (!m_hasFilter) {
-        return true;
+    if (m_transitions.isEmpty()) {
+        m_transitionTimer->stop();
+        return;
     }
 
-    // Apply category filter
-    if (!m_filterCategory.isEmpty() && task.category() != m_filterCategory) {
-        return false;
+    // Long waits are capped; an early wake-up just finds nothing due yet
+    const qint64 wait = m_transitions.first().atMs - TaskClock::currentMSecsSinceEpoch();
+    m_transitionTimer->start(static_cast<int>(qBound<qint64>(0, wait, MAX_TRANSITION_WAIT_MS)));
+}
+
+void TaskModel::processTimeTransitions()
+{
+    const TaskTimeContext previous = m_timeContext;
+    m_timeContext = TaskTimeContext::capture();
+    ++m_version;
+
+    QVector<TaskId> due;
+    QSet<TaskId> seen;
+    while (!m_transitions.isEmpty() && m_transitions.first().atMs <= m_timeContext.nowMs) {
+        std::pop_heap(m_transitions.begin(), m_transitions.end(), TimeTransition::later);
+        const TimeTransition transition = m_transitions.takeLast();
+
+        // Entries for deleted tasks or superseded due times are dropped
+        const int row = findTaskRow(transition.taskId);
+        if (row >= 0 && m_tasks.at(row).dueTimeMsecs() == transition.dueMs
+            && !seen.contains(transition.taskId)) {
+            seen.insert(transition.taskId);
+            due.append(transition.taskId);
+        }
     }
 
-    // Apply status filter (if not default pending)
-    if (m_hasFilter && task.status() != m_filterStatus && m_filterStatus != TaskStatus::Pending) {
-        return false;
+    // Only rows whose answer actually flipped are repainted and recounted;
+    // the heap holds every task whose answer can change
+    for (const TaskId& taskId : qAsConst(due)) {
+        const int row = findTaskRow(taskId);
+        const Task& task = m_tasks.at(row);
+        const bool overdue = task.isOverdue(m_timeContext);
+        const bool dueToday = task.isDueToday(m_timeContext);
+        const bool overdueFlipped = task.isOverdue(previous) != overdue;
+        const bool dueTodayFlipped = task.isDueToday(previous) != dueToday;
+
+        if (overdueFlipped) {
+            m_overdueCount += overdue ? 1 : -1;
+            m_changedFacets |= OverdueFacet;
+        }
+        if (dueTodayFlipped) {
+            m_dueTodayCount += dueToday ? 1 : -1;
+            m_changedFacets |= DueTodayFacet;
+        }
+        if (overdueFlipped || dueTodayFlipped) {
+            QModelIndex index = this->index(row);
+            emit dataChanged(index, index, {IsOverdueRole, IsDueTodayRole});
+        }
+        scheduleTimeTransition(task);
     }
 
-    return true;
+    armTransitionTimer();
+    emitFacetsChanged();
 }
 
-void TaskModel::refreshOverdueStatus()
+void TaskModel::rebuildFacets()
 {
-    // Refresh overdue status for all tasks
-    for (int i = 0; i < m_tasks.size(); ++i) {
-        QModelIndex index = this->index(i);
-        emit dataChanged(index, index, {IsOverdueRole, IsDueTodayRole});
+    std::fill(m_statusCounts, m_statusCounts + STATUS_COUNT, 0);
+    std::fill(m_priorityCounts, m_priorityCounts + PRIORITY_COUNT, 0);
+    m_categoryCounts.clear();
+    m_overdueCount = 0;
+    m_dueTodayCount = 0;
+
+    for (const Task& task : qAsConst(m_tasks)) {
+        countFacets(task, 1);
+    }
+    m_changedFacets = AllFacets;
+}
+
+void TaskModel::countFacets(const Task& task, int delta)
+{
+    m_statusCounts[static_cast<int>(task.status())] += delta;
+    m_priorityCounts[static_cast<int>(task.priority()) - static_cast<int>(TaskPriority::Low)] += delta;
+
+    auto category = m_categoryCounts.find(task.category());
+    if (category == m_categoryCounts.end()) {
+        category = m_categoryCounts.insert(task.category(), 0);
+    }
+    *category += delta;
+    if (*category == 0) {
+        m_categoryCounts.erase(category);
+    }
+
+    if (task.isOverdue(m_timeContext)) {
+        m_overdueCount += delta;
+    }
+    if (task.isDueToday(m_timeContext)) {
+        m_dueTodayCount += delta;
+    }
+}
+
+void TaskModel::adjustFacets(const Task* before, const Task* after)
+{
+    // A null side is a task entering or leaving the model
+    if (!before || !after || before->status() != after->status()) {
+        m_changedFacets |= StatusFacet;
+    }
+    if (!before || !after || before->priority() != after->priority()) {
+        m_changedFacets |= PriorityFacet;
+    }
+    if (!before || !after || before->category() != after->category()) {
+        m_changedFacets |= CategoryFacet;
+    }
+    if ((before && before->isOverdue(m_timeContext)) != (after && after->isOverdue(m_timeContext))) {
+        m_changedFacets |= OverdueFacet;
+    }
+    if ((before && before->isDueToday(m_timeContext)) != (after && after->isDueToday(m_timeContext))) {
+        m_changedFacets |= DueTodayFacet;
+    }
+
+    if (before) {
+        countFacets(*before, -1);
+    }
+    if (after) {
+        countFacets(*after, 1);
     }
 }
 
+void TaskModel::emitFacetsChanged()
+{
+    if (!m_changedFacets) {
+        return;
+    }
+
+    const Facets changed = m_changedFacets;
+    m_changedFacets = Facets();
+    emit facetsChanged(changed);
+}
+
 void TaskModel::refresh()
 {
     loadTasks();
@@ -328,9 +1030,9 @@ bool TaskModel::updateTask(const Task& task)
     return false;
 }
 
-bool TaskModel::removeTask(const QString& taskId)
+bool TaskModel::removeTask(const TaskId& taskId)
 {
-    if (taskId.isEmpty()) {
+    if (taskId.isNull()) {
         return false;
     }
 
@@ -349,47 +1051,59 @@ bool TaskModel::removeTask(int row)
         return false;
     }
 
-    QString taskId = m_tasks.at(row).id();
+    TaskId taskId = m_tasks.at(row).id();
     return removeTask(taskId);
 }
 
-Task TaskModel::getTask(const QString& taskId) const
+Task TaskModel::getTask(const TaskId& taskId) const
 {
-    for (const Task& task : m_tasks) {
-        if (task.id() == taskId) {
-            return task;
+    int row = findTaskRow(taskId);
+    return row >= 0 ? m_tasks.at(row) : Task();
+}
+
+void TaskModel::setFilter(const TaskFilter& filter)
+{
+    if (m_filter != filter) {
+        m_filter = filter;
+        if (m_sqlBacked) {
+            loadTasks();
         }
     }
-    return Task();
 }
-void TaskModel::setFilter(const QString& category, TaskStatus status)
+
+TaskQuery TaskModel::currentQuery() const
 {
-    m_filterCategory = category;
-    m_filterStatus = status;
-    m_hasFilter = !category.isEmpty() || status != TaskStatus::Pending;
+    TaskQuery query(m_filter);
 
-    // Reload and refilter data
-    loadTasks();
-    emit filterChanged();
-}
+    // Every column, so SQLite picks the page the sorter would put first
+    query.clearSort();
+    for (const TaskSorter::Column& column : m_sorter.columns()) {
+        TaskQuery::SortKey key;
+        switch (column.key) {
+        case TaskSorter::CreateTime: key = TaskQuery::SortByCreateTime; break;
+        case TaskSorter::DueTime: key = TaskQuery::SortByDueTime; break;
+        case TaskSorter::Priority: key = TaskQuery::SortByPriority; break;
+        case TaskSorter::Status: key = TaskQuery::SortByStatus; break;
+        case TaskSorter::Category: key = TaskQuery::SortByCategory; break;
+        default: key = TaskQuery::SortByTitle; break;
+        }
+        query.addSort(key, column.order);
 
-void TaskModel::clearFilter()
-{
-    m_filterCategory.clear();
-    m_filterStatus = TaskStatus::Pending;
-    m_hasFilter = false;
+        if (column.key == TaskSorter::Category) {
+            // Collated as the sorter does, not by SQLite's byte order
+            query.setCategoryRanks(m_sorter.categoryRanks(m_database->getAllCategories()));
+        }
+    }
 
-    // Reload all data
-    loadTasks();
-    emit filterChanged();
+    query.setLimit(SQL_PAGE_SIZE);
+    return query;
 }
 
 void TaskModel::setSortOrder(Qt::SortOrder order)
 {
     if (m_sortOrder != order) {
         m_sortOrder = order;
-        sortTasks();
-        emit dataChanged(index(0, 0), index(rowCount() - 1, 0));
+        setSortColumns({{sortKeyForRole(m_sortRole), m_sortOrder}});
     }
 }
 
@@ -397,28 +1111,67 @@ void TaskModel::setSortRole(TaskRoles role)
 {
     if (m_sortRole != role) {
         m_sortRole = role;
-        sortTasks();
-        emit dataChanged(index(0, 0), index(rowCount() - 1, 0));
+        setSortColumns({{sortKeyForRole(m_sortRole), m_sortOrder}});
     }
 }
-int TaskModel::getCompletedCount() const
+
+void TaskModel::setSortColumns(const QVector<TaskSorter::Column>& columns)
 {
-    int count = 0;
-    for (const Task& task : m_tasks) {
-        if (task.status() == TaskStatus::Completed) {
-            count++;
-        }
+    m_sorter.setColumns(columns);
+
+    if (m_sqlBacked) {
+        loadTasks();    // A different sort selects a different page
+    } else {
+        applySortChange();
     }
-    return count;
 }
 
-int TaskModel::getPendingCount() const
+QVector<TaskOccurrence> TaskModel::occurrencesBetween(const QDateTime& from, const QDateTime& to) const
 {
-    int count = 0;
+    QVector<TaskOccurrence> occurrences;
+    if (!from.isValid() || !to.isValid() || from >= to) {
+        return occurrences;
+    }
+
     for (const Task& task : m_tasks) {
-        if (task.status() == TaskStatus::Pending) {
-            count++;
+        QDateTime dueTime = task.dueTime();
+        if (dueTime.isValid() && dueTime >= from && dueTime < to) {
+            occurrences.append({task.id(), dueTime, false});
+        }
+
+        if (!task.isRecurring()) {
+            continue;
+        }
+
+        // The live instance covers the anchor itself; project what follows it
+        QDateTime anchor = task.recurrenceAnchor();
+        const QVector<QDateTime> projected =
+            task.recurrence().occurrencesBetween(anchor, qMax(from, anchor.addMSecs(1)), to);
+        for (const QDateTime& occurrence : projected) {
+            occurrences.append({task.id(), occurrence, true});
         }
     }
-    return count;
+
+    std::stable_sort(occurrences.begin(), occurrences.end(),
+                     [](const TaskOccurrence& a, const TaskOccurrence& b) {
+                         return a.dueTime < b.dueTime;
+                     });
+    return occurrences;
+}
+
+TaskSnapshot TaskModel::snapshot() const
+{
+    return TaskSnapshot(m_version, m_tasks, m_timeContext);
+}
+
+int TaskModel::countByStatus(TaskStatus status) const
+{
+    const int index = static_cast<int>(status);
+    return (index >= 0 && index < STATUS_COUNT) ? m_statusCounts[index] : 0;
+}
+
+int TaskModel::countByPriority(TaskPriority priority) const
+{
+    const int index = static_cast<int>(priority) - static_cast<int>(TaskPriority::Low);
+    return (index >= 0 && index < PRIORITY_COUNT) ? m_priorityCounts[index] : 0;
 }
@@ -2,11 +2,25 @@
 #define TASKMODEL_H
 
 #include <QAbstractListModel>
-#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
 #include <QTimer>
 #include "task.h"
+#include "taskfilter.h"
+#include "tasksorter.h"
+#include "tasksnapshot.h"
 
 class DatabaseManager;
+class TaskQuery;
+
+// One dated entry in a date window. A recurring series contributes its live
+// instance plus projected occurrences that don't exist as rows yet.
+struct TaskOccurrence {
+    TaskId taskId;        // The row the occurrence belongs to
+    QDateTime dueTime;
+    bool projected;       // Expanded from the row's recurrence rule
+};
 
 class TaskModel : public QAbstractListModel
 {
@@ -31,6 +45,17 @@ public:
         StatusStringRole
     };
 
+    // Aggregate counts kept by the model, named in facetsChanged()
+    enum Facet {
+        StatusFacet = 0x01,
+        PriorityFacet = 0x02,
+        CategoryFacet = 0x04,
+        OverdueFacet = 0x08,
+        DueTodayFacet = 0x10,
+        AllFacets = 0x1F
+    };
+    Q_DECLARE_FLAGS(Facets, Facet)
+
     explicit TaskModel(QObject *parent = nullptr);
     
     // QAbstractListModel interface
@@ -43,58 +68,169 @@ public:
     // Task management
     bool addTask(const Task& task);
     bool updateTask(const Task& task);
-    bool removeTask(const QString& taskId);
+    bool removeTask(const TaskId& taskId);
     bool removeTask(int row);
     Task getTask(int row) const;
-    Task getTask(const QString& taskId) const;
-    int findTaskRow(const QString& taskId) const;
+    Task getTask(const TaskId& taskId) const;
+    int findTaskRow(const TaskId& taskId) const;
     
-    // Filtering and sorting
-    void setFilter(const QString& category = QString(), TaskStatus status = TaskStatus::Pending);
-    void clearFilter();
+    // Sorting (filtering is layered on top by TaskFilterProxyModel)
     void setSortOrder(Qt::SortOrder order);
     void setSortRole(TaskRoles role);
+
+    // Multi-column ordering, e.g. priority, then due time, then title;
+    // setSortRole/setSortOrder replace it with a single column
+    void setSortColumns(const QVector<TaskSorter::Column>& columns);
+    QVector<TaskSorter::Column> sortColumns() const { return m_sorter.columns(); }
+
+    // Large databases aren't loaded whole: above SQL_PUSHDOWN_THRESHOLD tasks
+    // the model holds the first page of filter + sort as computed by SQLite,
+    // and the filter set here selects that page. Otherwise every task is
+    // loaded and the filter only matters to TaskFilterProxyModel.
+    void setFilter(const TaskFilter& filter);
+    TaskFilter filter() const { return m_filter; }
+    bool isSqlBacked() const { return m_sqlBacked; }
+
+    static const int SQL_PUSHDOWN_THRESHOLD = 20000;
+    static const int SQL_PAGE_SIZE = 2000;
     
     // Data access
-    QList<Task> getAllTasks() const { return m_tasks; }
+    QVector<Task> getAllTasks() const { return m_tasks; }
+
+    // O(1) immutable copy of the rows to hand to worker threads; take it on
+    // the model's thread. version() tells whether one is still current.
+    TaskSnapshot snapshot() const;
+    quint64 version() const { return m_version; }
+    const QVector<Task>& tasks() const { return m_tasks; }
     int getTaskCount() const { return m_tasks.size(); }
-    int getCompletedCount() const;
-    int getPendingCount() const;
+    int getCompletedCount() const { return countByStatus(TaskStatus::Completed); }
+    int getPendingCount() const { return countByStatus(TaskStatus::Pending); }
+
+    // Facet counts over the tasks the model holds (the loaded page when SQL
+    // backed). They are adjusted by each insert, update, delete and
+    // overdue/due-today transition, so reading them is O(1).
+    int countByStatus(TaskStatus status) const;
+    int countByPriority(TaskPriority priority) const;
+    int countByCategory(const QString& category) const { return m_categoryCounts.value(category); }
+    const QHash<QString, int>& categoryCounts() const { return m_categoryCounts; }
+    int overdueCount() const { return m_overdueCount; }
+    int dueTodayCount() const { return m_dueTodayCount; }
+
+    // Dated tasks and recurring occurrences in [from, to), ordered by time.
+    // Series are expanded only inside the window, so the cost depends on the
+    // window size, never on how far a series has run.
+    QVector<TaskOccurrence> occurrencesBetween(const QDateTime& from, const QDateTime& to) const;
     
     // Refresh data
     void refresh();
 
 public slots:
     void onTaskInserted(const Task& task);
-    void onTaskUpdated(const Task& task);
-    void onTaskDeleted(const QString& taskId);
+    void onTaskUpdated(const Task& task, Task::Fields changedFields = Task::AllFields);
+    void onTaskDeleted(const TaskId& taskId);
+    void onBatchStarted();
+    void onBatchFinished();
 
 signals:
     void taskCountChanged();
-    void filterChanged();
+    void facetsChanged(TaskModel::Facets changed);
 
 private slots:
-    void refreshOverdueStatus();
+    void processTimeTransitions();
 
 private:
     void loadTasks();
     void sortTasks();
-    bool matchesFilter(const Task& task) const;
+    static TaskSorter::Key sortKeyForRole(TaskRoles role);
+    void applyPendingDeletes();
+    void applyPendingUpdates();
+    void applyPendingInserts();
+    int sqlPageEnd(const QSet<TaskId>& changed) const;
+    void removeTailRows(int first);
+    void settleSqlPage(const QSet<TaskId>& changed = QSet<TaskId>());
+    void fillSqlPage();
+    bool lessThan(const Task& a, const Task& b) const;
+    int insertionRow(const Task& task, int begin, int end) const;
+    int repositionRow(int row);
+    void applySortChange();
+    TaskQuery currentQuery() const;
+    static QVector<int> rolesForFields(Task::Fields fields);
+
+    // Values data() would otherwise rebuild on every call, prepared when a
+    // row is loaded or changed. Returning a QVariant copy of them is a
+    // reference count bump, never an allocation.
+    struct RowDisplayData {
+        QVariant createTime;
+        QVariant dueTime;
+        QVariant tags;
+    };
+    static RowDisplayData displayDataFor(const Task& task);
+    void rebuildFacets();
+    void countFacets(const Task& task, int delta);
+    void adjustFacets(const Task* before, const Task* after);
+    void emitFacetsChanged();
+    void rebuildDisplayData();
+    void rebuildRowIndex();
+    void renumberRows(int fromRow);
     
-    QList<Task> m_tasks;
+    QVector<Task> m_tasks;
+    QVector<RowDisplayData> m_displayData;  // Parallel to m_tasks
+    QHash<TaskId, int> m_rowIndex;          // Row of every task in m_tasks
+
+    // Notifications held back during a DatabaseManager batch: the latest
+    // version of each inserted or updated task, and the rows to remove
+    struct PendingChange {
+        Task task;
+        Task::Fields fields;
+    };
+    QHash<TaskId, PendingChange> m_pendingChanges;
+    QSet<TaskId> m_pendingDeletes;
+
+    // Facet counters; statuses and priorities indexed from their first value
+    static const int STATUS_COUNT = 4;
+    static const int PRIORITY_COUNT = 4;
+    int m_statusCounts[STATUS_COUNT];
+    int m_priorityCounts[PRIORITY_COUNT];
+    QHash<QString, int> m_categoryCounts;
+    int m_overdueCount;
+    int m_dueTodayCount;
+    Facets m_changedFacets;         // Not yet announced
+
+    quint64 m_version;              // Bumped on every change to the rows
     DatabaseManager* m_database;
     
-    // Filtering
-    QString m_filterCategory;
-    TaskStatus m_filterStatus;
-    bool m_hasFilter;
-    
-    // Sorting
+    // Filter applied in SQL when m_sqlBacked. The page is the head of the
+    // SQL order; it is full whenever more matching rows exist.
+    TaskFilter m_filter;
+    bool m_sqlBacked;
+    bool m_sqlHasMore;              // Matching rows past the page's end
+
+    // Sorting; the role and order describe the primary column
     TaskRoles m_sortRole;
     Qt::SortOrder m_sortOrder;
+    TaskSorter m_sorter;
     
-    // Timer for updating overdue status
-    QTimer* m_overdueTimer;
+    // Upcoming overdue/due-today transitions as a min-heap on atMs, one
+    // entry per task; entries whose task or due time has since changed are
+    // skipped when popped
+    struct TimeTransition {
+        qint64 atMs;
+        qint64 dueMs;       // Due time the entry was computed for
+        TaskId taskId;
+
+        static bool later(const TimeTransition& a, const TimeTransition& b) { return a.atMs > b.atMs; }
+    };
+    void scheduleTimeTransition(const Task& task);
+    void rebuildTimeTransitions();
+    void armTransitionTimer();
+
+    QVector<TimeTransition> m_transitions;
+    QTimer* m_transitionTimer;
+
+    // Clock reading shared by every data() call until the next refresh
+    TaskTimeContext m_timeContext;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(TaskModel::Facets)
+
 #endif // TASKMODEL_H
@@ -0,0 +1,511 @@
+#include "tasksearchindex.h"
+#include "database/databasemanager.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+// Keeps the ascending slots of `slots` that also appear in `list`; probes
+// from the last match, so a short list costs O(short * log long)
+void intersectInto(QVector<int>* slots, const QVector<int>& list)
+{
+    int kept = 0;
+    auto from = list.cbegin();
+    for (int slot : qAsConst(*slots)) {
+        from = std::lower_bound(from, list.cend(), slot);
+        if (from == list.cend()) {
+            break;
+        }
+        if (*from == slot) {
+            (*slots)[kept++] = slot;
+        }
+    }
+    slots->resize(kept);
+}
+}
+
+TaskSearchIndex::TaskSearchIndex(QObject *parent)
+    : QObject(parent)
+    , m_sortedGramKeys(0)
+    , m_sortedPinyinKeys(0)
+    , m_tombstones(0)
+    , m_database(DatabaseManager::instance())
+{
+    connect(m_database, &DatabaseManager::taskInserted, this, &TaskSearchIndex::onTaskInserted);
+    connect(m_database, &DatabaseManager::taskUpdated, this, &TaskSearchIndex::onTaskUpdated);
+    connect(m_database, &DatabaseManager::taskDeleted, this, &TaskSearchIndex::onTaskDeleted);
+    connect(m_database, &DatabaseManager::changesRolledBack, this, &TaskSearchIndex::reload);
+
+    reload();
+}
+
+QVector<TaskSearchIndex::Hit> TaskSearchIndex::search(const QString& text, int maxResults) const
+{
+    const QString query = normalize(text);
+    if (query.isEmpty() || maxResults <= 0) {
+        return {};
+    }
+
+    QVector<Match> matches;
+    if (query.size() < 3) {
+        matchShort(query, &matches);
+    } else {
+        matchText(query, maxResults, &matches);
+    }
+
+    const QString letters = pinyinQuery(query);
+    if (!letters.isEmpty() && !m_pinyinKeys.isEmpty()) {
+        matchPinyin(letters, &matches);
+    }
+    return rank(&matches, maxResults);
+}
+
+void TaskSearchIndex::matchText(const QString& query, int maxResults, QVector<Match>* matches) const
+{
+    // One typo breaks up to three trigrams and longer queries may have
+    // more, but a candidate always shares at least half of them
+    const QVector<quint64> grams = trigramsOf(query);
+    const int total = grams.size();
+    const int maxTypos = query.size() >= 9 ? 2 : (query.size() >= 5 ? 1 : 0);
+    const int minShared = qMax((total + 1) / 2, total - 3 * maxTypos);
+
+    QVector<const QVector<int>*> lists;
+    lists.reserve(total);
+    for (quint64 gram : grams) {
+        auto it = m_postings.constFind(gram);
+        if (it != m_postings.constEnd()) {
+            lists.append(&it.value());
+        }
+    }
+    if (lists.size() < minShared) {
+        return;
+    }
+
+    QVector<QPair<int, int>> candidates;    // Slot, trigrams shared
+    if (lists.size() == total) {
+        // Exact: intersect, starting from the shortest list
+        std::sort(lists.begin(), lists.end(),
+                  [](const QVector<int>* a, const QVector<int>* b) { return a->size() < b->size(); });
+        QVector<int> slots = *lists.first();
+        for (int i = 1; i < lists.size() && !slots.isEmpty(); ++i) {
+            intersectInto(&slots, *lists.at(i));
+        }
+        candidates.reserve(slots.size());
+        for (int slot : qAsConst(slots)) {
+            candidates.append({slot, total});
+        }
+    }
+
+    // Near misses rank below every exact match, so they are only looked for
+    // while the exact ones leave room
+    if (minShared < total && candidates.size() < maxResults) {
+        // Tolerant: count how many of the query's trigrams each slot has
+        candidates.clear();
+        m_counts.resize(m_documents.size());
+        QVector<int> touched;
+        for (const QVector<int>* list : qAsConst(lists)) {
+            for (int slot : *list) {
+                if (m_counts[slot]++ == 0) {
+                    touched.append(slot);
+                }
+            }
+        }
+        for (int slot : qAsConst(touched)) {
+            if (m_counts.at(slot) >= minShared) {
+                candidates.append({slot, m_counts.at(slot)});
+            }
+            m_counts[slot] = 0;
+        }
+
+        // Common trigrams can pull in much of the index; only the ones
+        // sharing the most are worth scoring
+        if (candidates.size() > MAX_TOLERANT_CANDIDATES) {
+            std::nth_element(candidates.begin(), candidates.begin() + MAX_TOLERANT_CANDIDATES,
+                             candidates.end(), [](const QPair<int, int>& a, const QPair<int, int>& b) {
+                                 return a.second > b.second;
+                             });
+            candidates.resize(MAX_TOLERANT_CANDIDATES);
+        }
+    }
+
+    for (const auto& candidate : qAsConst(candidates)) {
+        const Document& document = m_documents.at(candidate.first);
+        if (document.alive) {
+            matches->append({candidate.first, score(document, query, candidate.second, total)});
+        }
+    }
+}
+
+void TaskSearchIndex::reload()
+{
+    m_documents.clear();
+    m_slots.clear();
+    m_postings.clear();
+    m_gramKeys.clear();
+    m_sortedGramKeys = 0;
+    m_pinyinKeys.clear();
+    m_sortedPinyinKeys = 0;
+    m_counts.clear();
+    m_tombstones = 0;
+
+    const QVector<TaskSearchText> texts = m_database->getTaskSearchTexts();
+    m_documents.reserve(texts.size());
+    m_slots.reserve(texts.size());
+    for (const TaskSearchText& text : texts) {
+        addDocument(text.taskId, text.title, text.tags);
+    }
+}
+
+void TaskSearchIndex::onTaskInserted(const Task& task)
+{
+    removeDocument(task.id());
+    addDocument(task.id(), task.title(), task.tags());
+}
+
+void TaskSearchIndex::onTaskUpdated(const Task& task, Task::Fields changedFields)
+{
+    if (changedFields & (Task::TitleField | Task::TagsField)) {
+        removeDocument(task.id());
+        addDocument(task.id(), task.title(), task.tags());
+    }
+}
+
+void TaskSearchIndex::onTaskDeleted(const TaskId& taskId)
+{
+    removeDocument(taskId);
+}
+
+QString TaskSearchIndex::normalize(const QString& text)
+{
+    return text.toCaseFolded().simplified();
+}
+
+QVector<quint64> TaskSearchIndex::trigramsOf(const QString& text)
+{
+    QVector<quint64> grams;
+    if (text.size() < 3) {
+        return grams;
+    }
+
+    grams.reserve(text.size() - 2);
+    const QChar* chars = text.constData();
+    for (int i = 0; i + 2 < text.size(); ++i) {
+        grams.append((quint64(chars[i].unicode()) << 32)
+                     | (quint64(chars[i + 1].unicode()) << 16)
+                     | chars[i + 2].unicode());
+    }
+
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+QString TaskSearchIndex::pinyinQuery(const QString& query)
+{
+    // Letters only; spaces between syllables are ignored
+    QString letters;
+    letters.reserve(query.size());
+    for (QChar ch : query) {
+        if (ch >= QLatin1Char('a') && ch <= QLatin1Char('z')) {
+            letters += ch;
+        } else if (ch != QLatin1Char(' ')) {
+            return QString();
+        }
+    }
+    return letters;
+}
+
+void TaskSearchIndex::addDocument(const TaskId& taskId, const QString& title, const QStringList& tags)
+{
+    Document document;
+    document.taskId = taskId;
+    document.text = normalize(title);
+    document.titleLength = document.text.size();
+    for (const QString& tag : tags) {
+        document.text += QLatin1Char(' ') + normalize(tag);
+    }
+    document.alive = true;
+
+    const QVector<PinyinTable::Spelling> spellings =
+        PinyinTable::instance()->spellings(document.text.left(document.titleLength), MAX_SPELLINGS);
+
+    // Padded so word starts and ends have trigrams of their own, and so
+    // every character starts one, for matchShort()
+    const int slot = m_documents.size();
+    const QVector<quint64> grams = trigramsOf(QLatin1Char(' ') + document.text + QLatin1String("  "));
+    for (quint64 gram : grams) {
+        QVector<int>& list = m_postings[gram];
+        if (list.isEmpty()) {
+            m_gramKeys.append(gram);
+        }
+        list.append(slot);
+    }
+
+    m_documents.append(document);
+    m_slots.insert(taskId, slot);
+    addPinyinKeys(slot, spellings);
+}
+
+void TaskSearchIndex::removeDocument(const TaskId& taskId)
+{
+    auto it = m_slots.find(taskId);
+    if (it == m_slots.end()) {
+        return;
+    }
+
+    Document& document = m_documents[it.value()];
+    document.alive = false;
+    document.text.clear();
+    m_slots.erase(it);
+    ++m_tombstones;
+
+    if (m_tombstones >= MIN_COMPACT_TOMBSTONES && m_tombstones > m_slots.size()) {
+        compact();
+    }
+}
+
+void TaskSearchIndex::addPinyinKeys(int slot, const QVector<PinyinTable::Spelling>& spellings)
+{
+    if (spellings.isEmpty()) {
+        return;
+    }
+
+    const PinyinTable::Spelling& main = spellings.first();
+    QVector<int> positions(main.starts.size());
+    std::iota(positions.begin(), positions.end(), 0);
+
+    addPinyinKeys(slot, main.pinyin, main.starts, main.starts.size());
+    addPinyinKeys(slot, main.initials, positions, positions.size());
+
+    // Past its last syllable that differs from the main reading, another
+    // reading's suffixes are the main reading's, so it needs no keys there
+    const QStringList& added = m_documents.at(slot).spellings;
+    for (int i = 1; i < spellings.size(); ++i) {
+        const PinyinTable::Spelling& other = spellings.at(i);
+        int pinyinKeys = 0;
+        int initialsKeys = 0;
+        for (int s = other.starts.size() - 1; s >= 0 && pinyinKeys == 0; --s) {
+            if (QStringView(other.pinyin).mid(other.starts.at(s)) != QStringView(main.pinyin).mid(main.starts.at(s))) {
+                pinyinKeys = s + 1;
+            }
+        }
+        for (int s = other.initials.size() - 1; s >= 0 && initialsKeys == 0; --s) {
+            if (other.initials.at(s) != main.initials.at(s)) {
+                initialsKeys = s + 1;
+            }
+        }
+
+        if (pinyinKeys > 0 && !added.contains(other.pinyin)) {
+            addPinyinKeys(slot, other.pinyin, other.starts, pinyinKeys);
+        }
+        if (initialsKeys > 0 && !added.contains(other.initials)) {
+            addPinyinKeys(slot, other.initials, positions, initialsKeys);
+        }
+    }
+}
+
+void TaskSearchIndex::addPinyinKeys(int slot, const QString& spelling, const QVector<int>& starts, int count)
+{
+    QStringList& spellings = m_documents[slot].spellings;
+    const quint16 index = static_cast<quint16>(spellings.size());
+    spellings.append(spelling);
+
+    count = qMin(count, MAX_PINYIN_SYLLABLES);
+    for (int i = 0; i < count; ++i) {
+        m_pinyinKeys.append({slot, static_cast<quint16>(starts.at(i)), index});
+    }
+}
+
+void TaskSearchIndex::compact()
+{
+    // Live slots are renumbered in order, so every list stays ascending
+    QVector<int> newSlots(m_documents.size(), -1);
+    QVector<Document> documents;
+    documents.reserve(m_slots.size());
+    for (int slot = 0; slot < m_documents.size(); ++slot) {
+        if (m_documents.at(slot).alive) {
+            newSlots[slot] = documents.size();
+            m_slots[m_documents.at(slot).taskId] = documents.size();
+            documents.append(m_documents.at(slot));
+        }
+    }
+
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+        QVector<int>& list = it.value();
+        int kept = 0;
+        for (int slot : qAsConst(list)) {
+            if (newSlots.at(slot) >= 0) {
+                list[kept++] = newSlots.at(slot);
+            }
+        }
+        if (kept == 0) {
+            it = m_postings.erase(it);
+        } else {
+            list.resize(kept);
+            list.squeeze();
+            ++it;
+        }
+    }
+
+    m_gramKeys = m_postings.keys().toVector();
+    std::sort(m_gramKeys.begin(), m_gramKeys.end());
+    m_sortedGramKeys = m_gramKeys.size();
+
+    // Dropping keys keeps both the sorted part and the tail in order
+    int kept = 0;
+    int sorted = 0;
+    for (int i = 0; i < m_pinyinKeys.size(); ++i) {
+        PinyinKey key = m_pinyinKeys.at(i);
+        if (newSlots.at(key.slot) >= 0) {
+            key.slot = newSlots.at(key.slot);
+            m_pinyinKeys[kept++] = key;
+            if (i < m_sortedPinyinKeys) {
+                ++sorted;
+            }
+        }
+    }
+    m_pinyinKeys.resize(kept);
+    m_sortedPinyinKeys = sorted;
+
+    m_documents.swap(documents);
+    m_counts.clear();
+    m_tombstones = 0;
+}
+
+void TaskSearchIndex::matchShort(const QString& query, QVector<Match>* matches) const
+{
+    // Every character of a document starts one of its trigrams, so the
+    // documents containing a one or two character query are those listed
+    // under the trigrams it prefixes, a contiguous run of the sorted keys
+    if (m_sortedGramKeys != m_gramKeys.size()) {
+        const auto middle = m_gramKeys.begin() + m_sortedGramKeys;
+        std::sort(middle, m_gramKeys.end());
+        std::inplace_merge(m_gramKeys.begin(), middle, m_gramKeys.end());
+        m_sortedGramKeys = m_gramKeys.size();
+    }
+
+    quint64 first = quint64(query.at(0).unicode()) << 32;
+    quint64 last = first | 0xFFFFFFFF;
+    if (query.size() == 2) {
+        first |= quint64(query.at(1).unicode()) << 16;
+        last = first | 0xFFFF;
+    }
+
+    m_counts.resize(m_documents.size());
+    QVector<int> touched;
+    for (auto key = std::lower_bound(m_gramKeys.cbegin(), m_gramKeys.cend(), first);
+         key != m_gramKeys.cend() && *key <= last; ++key) {
+        for (int slot : m_postings.value(*key)) {
+            if (m_counts.at(slot) == 0) {
+                m_counts[slot] = 1;
+                touched.append(slot);
+            }
+        }
+    }
+
+    for (int slot : qAsConst(touched)) {
+        const Document& document = m_documents.at(slot);
+        if (document.alive) {
+            matches->append({slot, score(document, query, 1, 1)});
+        }
+        m_counts[slot] = 0;
+    }
+}
+
+void TaskSearchIndex::matchPinyin(const QString& query, QVector<Match>* matches) const
+{
+    sortPinyinKeys();
+
+    // Marks: 1 for a text match already made, 2 for a pinyin match inside
+    // the title and 3 for one at its start
+    m_counts.resize(m_documents.size());
+    QVector<int> touched;
+    for (const Match& match : qAsConst(*matches)) {
+        m_counts[match.slot] = 1;
+        touched.append(match.slot);
+    }
+
+    auto it = std::lower_bound(m_pinyinKeys.cbegin(), m_pinyinKeys.cend(), query,
+                               [this](const PinyinKey& key, const QString& value) {
+                                   return spelling(key).compare(value) < 0;
+                               });
+    for (; it != m_pinyinKeys.cend() && spelling(*it).startsWith(query); ++it) {
+        if (!m_documents.at(it->slot).alive) {
+            continue;
+        }
+        quint16& mark = m_counts[it->slot];
+        if (mark == 0) {
+            touched.append(it->slot);
+        }
+        if (mark != 1) {
+            mark = qMax<quint16>(mark, it->offset == 0 ? 3 : 2);
+        }
+    }
+
+    for (int slot : qAsConst(touched)) {
+        if (m_counts.at(slot) > 1) {
+            // Below a literal match in the title, above a partial one
+            const Document& document = m_documents.at(slot);
+            const float value = m_counts.at(slot) == 3 ? 2.0f : 1.5f;
+            matches->append({slot, value + 0.25f / (1 + document.titleLength)});
+        }
+        m_counts[slot] = 0;
+    }
+}
+
+void TaskSearchIndex::sortPinyinKeys() const
+{
+    if (m_sortedPinyinKeys == m_pinyinKeys.size()) {
+        return;
+    }
+
+    auto less = [this](const PinyinKey& a, const PinyinKey& b) {
+        return spelling(a).compare(spelling(b)) < 0;
+    };
+    const auto middle = m_pinyinKeys.begin() + m_sortedPinyinKeys;
+    std::sort(middle, m_pinyinKeys.end(), less);
+    std::inplace_merge(m_pinyinKeys.begin(), middle, m_pinyinKeys.end(), less);
+    m_sortedPinyinKeys = m_pinyinKeys.size();
+}
+
+QStringView TaskSearchIndex::spelling(const PinyinKey& key) const
+{
+    const Document& document = m_documents.at(key.slot);
+    return QStringView(document.spellings.at(key.spelling)).mid(key.offset);
+}
+
+QVector<TaskSearchIndex::Hit> TaskSearchIndex::rank(QVector<Match>* matches, int maxResults) const
+{
+    auto better = [](const Match& a, const Match& b) { return a.score > b.score; };
+    if (matches->size() > maxResults) {
+        std::partial_sort(matches->begin(), matches->begin() + maxResults, matches->end(), better);
+        matches->resize(maxResults);
+    } else {
+        std::sort(matches->begin(), matches->end(), better);
+    }
+
+    QVector<Hit> hits;
+    hits.reserve(matches->size());
+    for (const Match& match : qAsConst(*matches)) {
+        hits.append({m_documents.at(match.slot).taskId, match.score});
+    }
+    return hits;
+}
+
+float TaskSearchIndex::score(const Document& document, const QString& query, int shared, int total) const
+{
+    float value = static_cast<float>(shared) / total;
+
+    const int position = document.text.indexOf(query);
+    if (position >= 0) {
+        value += 1.0f;
+        if (position == 0 || document.text.at(position - 1) == QLatin1Char(' ')) {
+            value += 0.5f;
+        }
+        if (position < document.titleLength) {
+            value += 0.5f;
+        }
+    }
+
+    // Among equals, shorter titles are the closer match
+    return value + 0.25f / (1 + document.titleLength);
+}
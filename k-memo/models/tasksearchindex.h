@@ -0,0 +1,128 @@
+#ifndef TASKSEARCHINDEX_H
+#define TASKSEARCHINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringView>
+#include <QVector>
+#include "task.h"
+#include "pinyintable.h"
+
+class DatabaseManager;
+
+// In-memory trigram index over task titles and tags, for search as you
+// type. It covers every task in the database and is kept current from the
+// database signals.
+//
+// Each task's case-folded text is split into overlapping three-character
+// keys, and each key maps to an ascending list of document slots. A query
+// merges the lists of its own trigrams. A task that shares all of them is
+// a substring candidate. While those leave room in the results, longer
+// queries also accept tasks missing the few trigrams a typo or two would
+// break, as long as they share at least half. Candidates are ranked by
+// trigrams shared, then exact substring, word start and title over tags,
+// then by shorter title. Queries under three characters are looked up by
+// the trigrams they prefix.
+//
+// Deleted and edited tasks leave tombstoned slots behind, so an update
+// never has to search the lists. Edits get a new, higher slot, which keeps
+// the lists sorted by appending. The lists are compacted once tombstones
+// outnumber live tasks.
+//
+// Titles with Chinese characters are also spelled in pinyin when they are
+// indexed, in full and as initials, once per reading of their polyphonic
+// characters (up to MAX_SPELLINGS). A sorted list of keys, one per syllable
+// boundary in each spelling, lets a query of plain letters find them by
+// prefix with a binary search. "xiangmu", "zhoubao" and "xmzb" all find
+// "项目周报", "yinhang" finds "银行", and the query itself is never
+// transliterated.
+class TaskSearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Hit {
+        TaskId taskId;
+        float score;
+    };
+
+    explicit TaskSearchIndex(QObject *parent = nullptr);
+
+    // Best matches first. Runs on the GUI thread (scratch state is shared).
+    QVector<Hit> search(const QString& text, int maxResults = 200) const;
+
+    int size() const { return m_slots.size(); }
+    void reload();
+
+public slots:
+    void onTaskInserted(const Task& task);
+    void onTaskUpdated(const Task& task, Task::Fields changedFields = Task::AllFields);
+    void onTaskDeleted(const TaskId& taskId);
+
+private:
+    struct Document {
+        TaskId taskId;
+        QString text;           // Case-folded title, then the tags
+        QStringList spellings;  // Title in pinyin and initials, if it has ideographs
+        int titleLength = 0;
+        bool alive = false;
+    };
+
+    struct Match {
+        int slot;
+        float score;
+    };
+
+    // A suffix of one of a document's spellings starting at a syllable.
+    // Kept after its document is tombstoned, whose spellings stay in place
+    // so the key order holds until compact().
+    struct PinyinKey {
+        int slot;
+        quint16 offset;
+        quint16 spelling;       // Index in Document::spellings
+    };
+
+    static QString normalize(const QString& text);
+    static QVector<quint64> trigramsOf(const QString& text);
+    static QString pinyinQuery(const QString& query);
+
+    void addDocument(const TaskId& taskId, const QString& title, const QStringList& tags);
+    void removeDocument(const TaskId& taskId);
+    void addPinyinKeys(int slot, const QVector<PinyinTable::Spelling>& spellings);
+    void addPinyinKeys(int slot, const QString& spelling, const QVector<int>& starts, int count);
+    void compact();
+    void matchText(const QString& query, int maxResults, QVector<Match>* matches) const;
+    void matchShort(const QString& query, QVector<Match>* matches) const;
+    void matchPinyin(const QString& query, QVector<Match>* matches) const;
+    void sortPinyinKeys() const;
+    QStringView spelling(const PinyinKey& key) const;
+    QVector<Hit> rank(QVector<Match>* matches, int maxResults) const;
+    float score(const Document& document, const QString& query, int shared, int total) const;
+
+    QVector<Document> m_documents;              // By slot, tombstones included
+    QHash<TaskId, int> m_slots;                 // Live slot of each task
+    QHash<quint64, QVector<int>> m_postings;    // Trigram -> ascending slots
+
+    // Every trigram in m_postings, sorted up to m_sortedGramKeys
+    mutable QVector<quint64> m_gramKeys;
+    mutable int m_sortedGramKeys;
+
+    // Sorted up to m_sortedPinyinKeys; keys added since are sorted and
+    // merged in by the next query
+    mutable QVector<PinyinKey> m_pinyinKeys;
+    mutable int m_sortedPinyinKeys;
+
+    int m_tombstones;
+    DatabaseManager* m_database;
+
+    // Per-slot trigram counts or pinyin marks while matching, all zero
+    // between queries
+    mutable QVector<quint16> m_counts;
+
+    static const int MIN_COMPACT_TOMBSTONES = 1024;
+    static const int MAX_PINYIN_SYLLABLES = 64;     // Keys per spelling
+    static const int MAX_SPELLINGS = 4;             // Readings per title
+    static const int MAX_TOLERANT_CANDIDATES = 5000;
+};
+
+#endif // TASKSEARCHINDEX_H
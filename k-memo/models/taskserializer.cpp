@@ -0,0 +1,316 @@
+#include "taskserializer.h"
+#include <QCborStreamWriter>
+#include <QCborStreamReader>
+#include <QIODevice>
+#include <QDebug>
+
+namespace {
+bool readText(QCborStreamReader& reader, QString* text)
+{
+    if (!reader.isString()) {
+        return false;
+    }
+
+    text->clear();
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        text->append(chunk.data);
+        chunk = reader.readString();
+    }
+    return chunk.status == QCborStreamReader::EndOfString;
+}
+
+bool readBytes(QCborStreamReader& reader, QByteArray* bytes)
+{
+    if (!reader.isByteArray()) {
+        return false;
+    }
+
+    bytes->clear();
+    auto chunk = reader.readByteArray();
+    while (chunk.status == QCborStreamReader::Ok) {
+        bytes->append(chunk.data);
+        chunk = reader.readByteArray();
+    }
+    return chunk.status == QCborStreamReader::EndOfString;
+}
+
+bool readInteger(QCborStreamReader& reader, qint64* value)
+{
+    if (!reader.isInteger()) {
+        return false;
+    }
+    *value = reader.toInteger();
+    return reader.next();
+}
+
+bool readTime(QCborStreamReader& reader, qint64* msecs)
+{
+    if (reader.isNull()) {
+        *msecs = Task::NO_TIME;
+        return reader.next();
+    }
+    return readInteger(reader, msecs);
+}
+
+void writeTime(QCborStreamWriter& writer, qint64 msecs)
+{
+    if (msecs == Task::NO_TIME) {
+        writer.appendNull();
+    } else {
+        writer.append(msecs);
+    }
+}
+}
+
+QByteArray TaskSerializer::serialize(const Task& task)
+{
+    return serialize(QVector<Task>{task});
+}
+
+QByteArray TaskSerializer::serialize(const QVector<Task>& tasks)
+{
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writeStream(writer, tasks);
+    return data;
+}
+
+bool TaskSerializer::write(QIODevice* device, const QVector<Task>& tasks)
+{
+    if (!device || !device->isWritable()) {
+        return false;
+    }
+
+    QCborStreamWriter writer(device);
+    writeStream(writer, tasks);
+    return true;
+}
+
+bool TaskSerializer::deserialize(const QByteArray& data, Task* task)
+{
+    QVector<Task> tasks;
+    if (!deserialize(data, &tasks) || tasks.size() != 1) {
+        return false;
+    }
+
+    *task = tasks.first();
+    return true;
+}
+
+bool TaskSerializer::deserialize(const QByteArray& data, QVector<Task>* tasks)
+{
+    QCborStreamReader reader(data);
+    return readStream(reader, tasks);
+}
+
+bool TaskSerializer::read(QIODevice* device, QVector<Task>* tasks)
+{
+    if (!device || !device->isReadable()) {
+        return false;
+    }
+
+    QCborStreamReader reader(device);
+    return readStream(reader, tasks);
+}
+
+void TaskSerializer::writeStream(QCborStreamWriter& writer, const QVector<Task>& tasks)
+{
+    writer.append(QCborKnownTags::Signature);
+    writer.startArray(2);
+    writer.append(FORMAT_VERSION);
+
+    writer.startArray(tasks.size());
+    for (const Task& task : tasks) {
+        writeTask(writer, task);
+    }
+    writer.endArray();
+
+    writer.endArray();
+}
+
+void TaskSerializer::writeTask(QCborStreamWriter& writer, const Task& task)
+{
+    writer.startArray(FieldCount);
+
+    writer.append(task.id().toRfc4122());
+    writer.append(task.title());
+
+    // Compressed descriptions travel as stored instead of being inflated
+    if (task.hasCompressedDescription()) {
+        writer.append(task.compressedDescription());
+    } else {
+        writer.append(task.description());
+    }
+
+    writeTime(writer, task.createTimeMsecs());
+    writeTime(writer, task.dueTimeMsecs());
+    writer.append(static_cast<quint64>(task.priority()));
+    writer.append(static_cast<quint64>(task.status()));
+    writer.append(task.category());
+
+    const QStringList tags = task.tags();
+    writer.startArray(tags.size());
+    for (const QString& tag : tags) {
+        writer.append(tag);
+    }
+    writer.endArray();
+
+    writer.append(task.reminderEnabled());
+    writer.append(static_cast<qint64>(task.reminderMinutes()));
+    writer.append(task.recurrence().toString());
+
+    writer.endArray();
+}
+
+bool TaskSerializer::readStream(QCborStreamReader& reader, QVector<Task>* tasks)
+{
+    tasks->clear();
+
+    if (reader.isTag() && reader.toTag() == QCborTag(QCborKnownTags::Signature)) {
+        reader.next();
+    }
+
+    if (!reader.isArray() || !reader.enterContainer()) {
+        qWarning() << "Task stream is not a CBOR array";
+        return false;
+    }
+
+    qint64 version = 0;
+    if (!readInteger(reader, &version) || version < 1
+        || static_cast<quint64>(version) > FORMAT_VERSION) {
+        qWarning() << "Unsupported task stream version:" << version;
+        return false;
+    }
+
+    if (!reader.isArray()) {
+        return false;
+    }
+
+    if (reader.isLengthKnown()) {
+        tasks->reserve(static_cast<int>(reader.length()));
+    }
+
+    if (!reader.enterContainer()) {
+        return false;
+    }
+
+    while (reader.hasNext()) {
+        Task task;
+        if (!readTask(reader, &task)) {
+            qWarning() << "Malformed task at index" << tasks->size()
+                       << "in task stream:" << reader.lastError().toString();
+            tasks->clear();
+            return false;
+        }
+        tasks->append(task);
+    }
+
+    return reader.leaveContainer() && reader.leaveContainer();
+}
+
+bool TaskSerializer::readTask(QCborStreamReader& reader, Task* task)
+{
+    if (!reader.isArray() || !reader.enterContainer()) {
+        return false;
+    }
+
+    QByteArray idBytes;
+    QString title;
+    if (!readBytes(reader, &idBytes) || !readText(reader, &title)) {
+        return false;
+    }
+
+    TaskId id = TaskId::fromRfc4122(idBytes);
+    if (id.isNull()) {
+        return false;
+    }
+    task->setId(id);
+    task->setTitle(title);
+
+    if (reader.isByteArray()) {
+        QByteArray compressed;
+        if (!readBytes(reader, &compressed) || !isCompressedDescription(compressed)) {
+            return false;
+        }
+        task->setCompressedDescription(compressed);
+    } else {
+        QString description;
+        if (!readText(reader, &description)) {
+            return false;
+        }
+        task->setDescription(description);
+    }
+
+    qint64 createTime = 0;
+    qint64 dueTime = 0;
+    qint64 priority = 0;
+    qint64 status = 0;
+    if (!readTime(reader, &createTime) || !readTime(reader, &dueTime)
+        || !readInteger(reader, &priority) || !readInteger(reader, &status)) {
+        return false;
+    }
+
+    if (priority < static_cast<int>(TaskPriority::Low) || priority > static_cast<int>(TaskPriority::Urgent)
+        || status < static_cast<int>(TaskStatus::Pending) || status > static_cast<int>(TaskStatus::Cancelled)) {
+        return false;
+    }
+
+    task->setCreateTimeMsecs(createTime);
+    task->setDueTimeMsecs(dueTime);
+    task->setPriority(static_cast<TaskPriority>(priority));
+    task->setStatus(static_cast<TaskStatus>(status));
+
+    QString category;
+    if (!readText(reader, &category)) {
+        return false;
+    }
+    task->setCategory(category);
+
+    if (!reader.isArray() || !reader.enterContainer()) {
+        return false;
+    }
+    QStringList tags;
+    while (reader.hasNext()) {
+        QString tag;
+        if (!readText(reader, &tag)) {
+            return false;
+        }
+        tags.append(tag);
+    }
+    if (!reader.leaveContainer()) {
+        return false;
+    }
+    task->setTags(tags);
+
+    if (!reader.isBool()) {
+        return false;
+    }
+    task->setReminderEnabled(reader.toBool());
+    reader.next();
+
+    qint64 reminderMinutes = 0;
+    if (!readInteger(reader, &reminderMinutes)) {
+        return false;
+    }
+    task->setReminderMinutes(static_cast<int>(reminderMinutes));
+
+    // Optional from here on: streams written before the field existed end early
+    if (reader.hasNext()) {
+        QString recurrence;
+        if (!readText(reader, &recurrence)) {
+            return false;
+        }
+        task->setRecurrence(RecurrenceRule::fromString(recurrence));
+    }
+
+    // Fields appended by later writers
+    while (reader.hasNext()) {
+        reader.next();
+    }
+
+    // Like fromJson, imported data has no known saved state
+    task->markDirty();
+
+    return reader.leaveContainer();
+}
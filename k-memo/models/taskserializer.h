@@ -0,0 +1,55 @@
+#ifndef TASKSERIALIZER_H
+#define TASKSERIALIZER_H
+
+#include <QByteArray>
+#include <QVector>
+#include "task.h"
+
+class QIODevice;
+class QCborStreamWriter;
+class QCborStreamReader;
+
+// Streaming CBOR serialization for tasks (export, snapshots, IPC).
+//
+// A stream is the self-describe tag followed by [version, [task, ...]].
+// Each task is a positional array in FIELD order, so no keys are repeated
+// per record and nothing is built as an intermediate DOM. Readers skip
+// trailing fields they don't know, so fields can be appended without
+// bumping the version.
+class TaskSerializer
+{
+public:
+    static const quint64 FORMAT_VERSION = 1;
+
+    static QByteArray serialize(const Task& task);
+    static QByteArray serialize(const QVector<Task>& tasks);
+    static bool write(QIODevice* device, const QVector<Task>& tasks);
+
+    static bool deserialize(const QByteArray& data, Task* task);
+    static bool deserialize(const QByteArray& data, QVector<Task>* tasks);
+    static bool read(QIODevice* device, QVector<Task>* tasks);
+
+private:
+    enum FieldIndex {
+        IdIndex,
+        TitleIndex,
+        DescriptionIndex,       // Text, or the compressed bytes as stored
+        CreateTimeIndex,        // Epoch msecs, null when unset
+        DueTimeIndex,
+        PriorityIndex,
+        StatusIndex,
+        CategoryIndex,
+        TagsIndex,
+        ReminderEnabledIndex,
+        ReminderMinutesIndex,
+        RecurrenceIndex,        // RRULE text, empty when not recurring
+        FieldCount
+    };
+
+    static void writeStream(QCborStreamWriter& writer, const QVector<Task>& tasks);
+    static void writeTask(QCborStreamWriter& writer, const Task& task);
+    static bool readStream(QCborStreamReader& reader, QVector<Task>* tasks);
+    static bool readTask(QCborStreamReader& reader, Task* task);
+};
+
+#endif // TASKSERIALIZER_H
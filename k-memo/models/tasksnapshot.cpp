@@ -0,0 +1,14 @@
+#include "tasksnapshot.h"
+
+TaskSnapshot::TaskSnapshot()
+    : m_version(0)
+    , m_timeContext(TaskTimeContext::at(0))
+{
+}
+
+TaskSnapshot::TaskSnapshot(quint64 version, const QVector<Task>& tasks, const TaskTimeContext& timeContext)
+    : m_version(version)
+    , m_tasks(tasks)
+    , m_timeContext(timeContext)
+{
+}
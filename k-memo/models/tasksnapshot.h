@@ -0,0 +1,44 @@
+#ifndef TASKSNAPSHOT_H
+#define TASKSNAPSHOT_H
+
+#include <QMetaType>
+#include <QVector>
+#include "task.h"
+#include "tasktimecontext.h"
+
+// Read-only view of TaskModel's rows at one version, for work off the GUI
+// thread (stats, export, indexing).
+//
+// Taking one is O(1): it shares the model's row vector, whose reference
+// count is atomic. The model detaches its own copy the next time it
+// changes, so a reader never sees a half-applied edit and never blocks the
+// GUI. Copies can be passed freely between threads; only const access is
+// offered.
+class TaskSnapshot
+{
+public:
+    TaskSnapshot();
+    TaskSnapshot(quint64 version, const QVector<Task>& tasks, const TaskTimeContext& timeContext);
+
+    // Increases with every change to the model; equal versions hold equal rows
+    quint64 version() const { return m_version; }
+
+    const QVector<Task>& tasks() const { return m_tasks; }
+    int size() const { return m_tasks.size(); }
+    bool isEmpty() const { return m_tasks.isEmpty(); }
+    const Task& at(int row) const { return m_tasks.at(row); }
+    QVector<Task>::const_iterator begin() const { return m_tasks.cbegin(); }
+    QVector<Task>::const_iterator end() const { return m_tasks.cend(); }
+
+    // The instant the model judged overdue/due-today against
+    TaskTimeContext timeContext() const { return m_timeContext; }
+
+private:
+    quint64 m_version;
+    QVector<Task> m_tasks;
+    TaskTimeContext m_timeContext;
+};
+
+Q_DECLARE_METATYPE(TaskSnapshot)
+
+#endif // TASKSNAPSHOT_H
@@ -0,0 +1,223 @@
+#include "tasksorter.h"
+#include "pinyintable.h"
+#include <QHash>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+// Reverses signed order without the overflow of negation
+inline qint64 directed(qint64 value, Qt::SortOrder order)
+{
+    return order == Qt::AscendingOrder ? value : ~value;
+}
+}
+
+TaskSorter::TaskSorter()
+    : m_columns{{Title, Qt::AscendingOrder}}
+{
+}
+
+QByteArray TaskSorter::titleSortKey(const QString& title)
+{
+    // A space after each syllable keeps "xi an" ahead of "xian"
+    const PinyinTable* pinyin = PinyinTable::instance();
+    const QString folded = title.normalized(QString::NormalizationForm_KD).toCaseFolded();
+    QString key;
+    key.reserve(folded.size() * 2);
+    for (QChar ch : folded) {
+        const QString syllable = pinyin->syllable(ch);
+        if (!syllable.isEmpty()) {
+            key += syllable;
+            key += QLatin1Char(' ');
+        } else if (ch.category() != QChar::Mark_NonSpacing) {
+            key += ch;
+        }
+    }
+    return key.toUtf8();
+}
+
+void TaskSorter::setColumns(const QVector<Column>& columns)
+{
+    m_columns = columns.mid(0, MAX_COLUMNS);
+}
+
+qint64 TaskSorter::numericKey(const Task& task, Key key) const
+{
+    switch (key) {
+    case CreateTime:
+        return task.createTimeMsecs();
+    case DueTime:
+        return task.hasDueTime() ? task.dueTimeMsecs() : std::numeric_limits<qint64>::max();
+    case Priority:
+        return -static_cast<qint64>(task.priority());
+    case Status:
+        return static_cast<qint64>(task.status());
+    case Title:
+    case Category:
+        break;
+    }
+    return 0;
+}
+
+QHash<QString, int> TaskSorter::categoryRanks(QStringList categories) const
+{
+    std::sort(categories.begin(), categories.end(), [this](const QString& a, const QString& b) {
+        return m_collator.compare(a, b) < 0;
+    });
+
+    QHash<QString, int> ranks;
+    int rank = 0;
+    for (int i = 0; i < categories.size(); ++i) {
+        if (i > 0 && m_collator.compare(categories.at(i - 1), categories.at(i)) != 0) {
+            ++rank;
+        }
+        ranks.insert(categories.at(i), rank);
+    }
+    return ranks;
+}
+
+int TaskSorter::compare(const Task& a, const Task& b) const
+{
+    for (const Column& column : m_columns) {
+        int result;
+        if (column.key == Title) {
+            const QByteArray x = titleSortKey(a.title());
+            const QByteArray y = titleSortKey(b.title());
+            result = x < y ? -1 : (y < x ? 1 : 0);
+        } else if (column.key == Category) {
+            result = a.categoryId() == b.categoryId() ? 0 : m_collator.compare(a.category(), b.category());
+        } else {
+            const qint64 x = numericKey(a, column.key);
+            const qint64 y = numericKey(b, column.key);
+            result = x < y ? -1 : (x > y ? 1 : 0);
+        }
+
+        if (result != 0) {
+            return column.order == Qt::AscendingOrder ? result : -result;
+        }
+    }
+
+    return a.id() < b.id() ? -1 : (b.id() < a.id() ? 1 : 0);
+}
+
+QVector<qint64> TaskSorter::textRanks(const QVector<Task>& tasks, Key key) const
+{
+    QVector<qint64> ranks(tasks.size());
+
+    if (key == Category) {
+        // Few distinct categories: collate the interned ids, not the rows
+        QHash<quint32, QString> names;
+        for (const Task& task : tasks) {
+            if (!names.contains(task.categoryId())) {
+                names.insert(task.categoryId(), task.category());
+            }
+        }
+
+        const QHash<QString, int> rankByName = categoryRanks(names.values());
+        QHash<quint32, qint64> rankById;
+        for (auto it = names.cbegin(); it != names.cend(); ++it) {
+            rankById.insert(it.key(), rankByName.value(it.value()));
+        }
+
+        for (int i = 0; i < tasks.size(); ++i) {
+            ranks[i] = rankById.value(tasks.at(i).categoryId());
+        }
+        return ranks;
+    }
+
+    // One sort key per title; sorting them is a byte comparison
+    std::vector<QByteArray> keys;
+    keys.reserve(tasks.size());
+    for (const Task& task : tasks) {
+        keys.push_back(titleSortKey(task.title()));
+    }
+
+    QVector<int> order(tasks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&keys](int a, int b) {
+        return keys[a] < keys[b];
+    });
+
+    // Titles with equal keys share a rank
+    qint64 rank = 0;
+    for (int i = 0; i < order.size(); ++i) {
+        if (i > 0 && keys[order.at(i - 1)] != keys[order.at(i)]) {
+            ++rank;
+        }
+        ranks[order.at(i)] = rank;
+    }
+    return ranks;
+}
+
+void TaskSorter::sort(QVector<Task>* tasks) const
+{
+    const int count = tasks->size();
+    if (count < 2) {
+        return;
+    }
+
+    // Reduce every row to integers once
+    QVector<Entry> entries(count);
+    for (int column = 0; column < m_columns.size(); ++column) {
+        const Column& spec = m_columns.at(column);
+        if (spec.key == Title || spec.key == Category) {
+            const QVector<qint64> ranks = textRanks(*tasks, spec.key);
+            for (int i = 0; i < count; ++i) {
+                entries[i].keys[column] = directed(ranks.at(i), spec.order);
+            }
+        } else {
+            for (int i = 0; i < count; ++i) {
+                entries[i].keys[column] = directed(numericKey(tasks->at(i), spec.key), spec.order);
+            }
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        entries[i].id = tasks->at(i).id();
+        entries[i].index = i;
+    }
+
+    const int columns = m_columns.size();
+    auto less = [columns](const Entry& a, const Entry& b) {
+        for (int column = 0; column < columns; ++column) {
+            if (a.keys[column] != b.keys[column]) {
+                return a.keys[column] < b.keys[column];
+            }
+        }
+        return a.id < b.id;
+    };
+
+    Entry* data = entries.data();
+    if (count < PARALLEL_THRESHOLD) {
+        std::stable_sort(data, data + count, less);
+    } else {
+        // Sort equal chunks concurrently, then merge neighbours pairwise
+        const int chunks = qMax(2, QThread::idealThreadCount());
+        const int chunkSize = (count + chunks - 1) / chunks;
+
+        QVector<int> starts;
+        for (int start = 0; start < count; start += chunkSize) {
+            starts.append(start);
+        }
+        QtConcurrent::blockingMap(starts, [=](int start) {
+            std::stable_sort(data + start, data + qMin(start + chunkSize, count), less);
+        });
+
+        for (int width = chunkSize; width < count; width *= 2) {
+            for (int start = 0; start + width < count; start += 2 * width) {
+                std::inplace_merge(data + start, data + start + width,
+                                   data + qMin(start + 2 * width, count), less);
+            }
+        }
+    }
+
+    QVector<Task> sorted;
+    sorted.reserve(count);
+    for (const Entry& entry : qAsConst(entries)) {
+        sorted.append(tasks->at(entry.index));
+    }
+    tasks->swap(sorted);
+}
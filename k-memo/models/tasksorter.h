@@ -0,0 +1,81 @@
+#ifndef TASKSORTER_H
+#define TASKSORTER_H
+
+#include <QCollator>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+#include "task.h"
+
+// Orders tasks by up to MAX_COLUMNS keys, e.g. priority, then due time,
+// then title, with the task id as the final tie-break so the order is total.
+//
+// Bulk sorting never touches strings in the comparator: text columns are
+// ranked once, and every row is reduced to a fixed array of integers with
+// the direction folded in. Large inputs are sorted in parallel chunks and
+// merged.
+//
+// Titles are ranked by titleSortKey(): Chinese characters by their pinyin,
+// other text with case and accents folded, compared as UTF-8 bytes. The
+// database stores the same key, so a page SQLite orders and limits is the
+// head of the order this class gives. Categories go through QCollator;
+// categoryRanks() hands the same order to SQL (see TaskQuery).
+//
+// compare() gives the same order one pair at a time, for incremental
+// insertion and repositioning.
+class TaskSorter
+{
+public:
+    enum Key {
+        Title,
+        CreateTime,
+        DueTime,        // Tasks without a due time last when ascending
+        Priority,       // Highest priority first when ascending
+        Status,
+        Category
+    };
+
+    struct Column {
+        Key key;
+        Qt::SortOrder order;
+    };
+
+    static const int MAX_COLUMNS = 3;
+    static const int PARALLEL_THRESHOLD = 20000;
+
+    TaskSorter();
+
+    void setColumns(const QVector<Column>& columns);
+    QVector<Column> columns() const { return m_columns; }
+    void setLocale(const QLocale& locale) { m_collator.setLocale(locale); }
+
+    // Byte-comparable key of a title; stored as tasks.title_key
+    static QByteArray titleSortKey(const QString& title);
+
+    // Each category's place in collation order; names that collate equal
+    // share a rank
+    QHash<QString, int> categoryRanks(QStringList categories) const;
+
+    int compare(const Task& a, const Task& b) const;
+    bool lessThan(const Task& a, const Task& b) const { return compare(a, b) < 0; }
+
+    // Stable sort in place
+    void sort(QVector<Task>* tasks) const;
+
+private:
+    struct Entry {
+        qint64 keys[MAX_COLUMNS];
+        TaskId id;
+        int index;
+    };
+
+    qint64 numericKey(const Task& task, Key key) const;
+    QVector<qint64> textRanks(const QVector<Task>& tasks, Key key) const;
+
+    QVector<Column> m_columns;
+    QCollator m_collator;
+};
+
+Q_DECLARE_TYPEINFO(TaskSorter::Column, Q_PRIMITIVE_TYPE);
+
+#endif // TASKSORTER_H
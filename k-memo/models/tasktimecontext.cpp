@@ -0,0 +1,38 @@
+#include "tasktimecontext.h"
+#include <QDateTime>
+
+namespace {
+TaskClock::Source& clockSource()
+{
+    static TaskClock::Source source;
+    return source;
+}
+}
+
+qint64 TaskClock::currentMSecsSinceEpoch()
+{
+    const Source& source = clockSource();
+    return source ? source() : QDateTime::currentMSecsSinceEpoch();
+}
+
+void TaskClock::setSource(const Source& source)
+{
+    clockSource() = source;
+}
+
+TaskTimeContext TaskTimeContext::capture()
+{
+    return at(TaskClock::currentMSecsSinceEpoch());
+}
+
+TaskTimeContext TaskTimeContext::at(qint64 msecsSinceEpoch)
+{
+    // The only local time conversion of the pass
+    QDate today = QDateTime::fromMSecsSinceEpoch(msecsSinceEpoch).date();
+
+    TaskTimeContext context;
+    context.nowMs = msecsSinceEpoch;
+    context.todayStartMs = today.startOfDay().toMSecsSinceEpoch();
+    context.tomorrowStartMs = today.addDays(1).startOfDay().toMSecsSinceEpoch();
+    return context;
+}
@@ -0,0 +1,34 @@
+#ifndef TASKTIMECONTEXT_H
+#define TASKTIMECONTEXT_H
+
+#include <QtGlobal>
+#include <functional>
+
+// Source of "now" for everything time-dependent about tasks. Defaults to the
+// system clock; tests can install a fixed or stepping clock instead.
+class TaskClock
+{
+public:
+    using Source = std::function<qint64()>;
+
+    static qint64 currentMSecsSinceEpoch();
+
+    // An empty source restores the system clock
+    static void setSource(const Source& source);
+};
+
+// One reading of the clock, with the local day boundaries resolved up front.
+// Capture it once per pass (painting, a stats refresh, a notification scan)
+// and hand it to the task predicates: every task in the pass is then judged
+// against the same instant, and the time zone conversion happens once.
+struct TaskTimeContext
+{
+    qint64 nowMs;
+    qint64 todayStartMs;
+    qint64 tomorrowStartMs;
+
+    static TaskTimeContext capture();
+    static TaskTimeContext at(qint64 msecsSinceEpoch);
+};
+
+#endif // TASKTIMECONTEXT_H
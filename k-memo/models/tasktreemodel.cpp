@@ -0,0 +1,499 @@
+#include "tasktreemodel.h"
+#include "database/databasemanager.h"
+#include <QDebug>
+#include <QSet>
+#include <algorithm>
+
+namespace {
+// As TaskModel's: wall clock jumps and suspend are caught up with within
+// a few hours at worst
+const qint64 MAX_TRANSITION_WAIT_MS = 6 * 3600 * 1000;
+}
+
+TaskTreeModel::TaskTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_database(DatabaseManager::instance())
+    , m_transitionTimer(new QTimer(this))
+    , m_timeContext(TaskTimeContext::capture())
+{
+    connect(m_database, &DatabaseManager::taskInserted, this, &TaskTreeModel::onTaskInserted);
+    connect(m_database, &DatabaseManager::taskUpdated, this, &TaskTreeModel::onTaskUpdated);
+    connect(m_database, &DatabaseManager::taskDeleted, this, &TaskTreeModel::onTaskDeleted);
+    connect(m_database, &DatabaseManager::taskMoved, this, &TaskTreeModel::onTaskMoved);
+    connect(m_database, &DatabaseManager::changesRolledBack, this, &TaskTreeModel::refresh);
+
+    m_transitionTimer->setSingleShot(true);
+    m_transitionTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_transitionTimer, &QTimer::timeout, this, &TaskTreeModel::processTimeTransitions);
+
+    refresh();
+}
+
+TaskTreeModel::~TaskTreeModel()
+{
+    releaseChildren(&m_root);
+}
+
+QModelIndex TaskTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+
+    Node* parentNode = nodeForIndex(parent);
+    return createIndex(row, column, parentNode->children.at(row));
+}
+
+QModelIndex TaskTreeModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid()) {
+        return QModelIndex();
+    }
+
+    Node* node = static_cast<Node*>(child.internalPointer());
+    return indexForNode(node->parent);
+}
+
+int TaskTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+    return nodeForIndex(parent)->children.size();
+}
+
+int TaskTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 1;
+}
+
+bool TaskTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return false;
+    }
+
+    Node* node = nodeForIndex(parent);
+    return node->childrenLoaded ? !node->children.isEmpty() : node->childCount > 0;
+}
+
+bool TaskTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    Node* node = nodeForIndex(parent);
+    return !node->childrenLoaded && node->childCount > 0;
+}
+
+void TaskTreeModel::fetchMore(const QModelIndex &parent)
+{
+    Node* node = nodeForIndex(parent);
+    if (node->childrenLoaded) {
+        return;
+    }
+
+    QVector<int> childCounts;
+    QVector<Task> children = m_database->getChildTasks(node->task.id(), &childCounts);
+    node->childrenLoaded = true;
+    node->childCount = children.size();
+
+    if (children.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(parent, 0, children.size() - 1);
+    node->children.reserve(children.size());
+    for (int i = 0; i < children.size(); ++i) {
+        appendChild(node, createNode(children.at(i), childCounts.value(i)));
+    }
+    endInsertRows();
+}
+
+QVariant TaskTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    Node* node = static_cast<Node*>(index.internalPointer());
+    const Task& task = node->task;
+
+    switch (role) {
+    case TaskModel::IdRole:
+        return task.id().toString();
+    case TaskModel::TitleRole:
+    case Qt::DisplayRole:
+        return task.title();
+    case TaskModel::DescriptionRole:
+        return task.description();
+    case TaskModel::CreateTimeRole:
+        return task.createTime();
+    case TaskModel::DueTimeRole:
+        return task.dueTime();
+    case TaskModel::PriorityRole:
+        return static_cast<int>(task.priority());
+    case TaskModel::StatusRole:
+        return static_cast<int>(task.status());
+    case TaskModel::CategoryRole:
+        return task.category();
+    case TaskModel::TagsRole:
+        return task.tags();
+    case TaskModel::ReminderEnabledRole:
+        return task.reminderEnabled();
+    case TaskModel::ReminderMinutesRole:
+        return task.reminderMinutes();
+    case TaskModel::IsOverdueRole:
+        return task.isOverdue(m_timeContext);
+    case TaskModel::IsDueTodayRole:
+        return task.isDueToday(m_timeContext);
+    case TaskModel::PriorityStringRole:
+        return taskPriorityToString(task.priority());
+    case TaskModel::StatusStringRole:
+        return taskStatusToString(task.status());
+    case ChildCountRole:
+        return node->childrenLoaded ? node->children.size() : node->childCount;
+    case SubtreeTotalRole:
+        loadSubtreeProgress(node);
+        return node->subtreeTotal;
+    case SubtreeCompletedRole:
+        loadSubtreeProgress(node);
+        return node->subtreeCompleted;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> TaskTreeModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[TaskModel::IdRole] = "id";
+    roles[TaskModel::TitleRole] = "title";
+    roles[TaskModel::DescriptionRole] = "description";
+    roles[TaskModel::CreateTimeRole] = "createTime";
+    roles[TaskModel::DueTimeRole] = "dueTime";
+    roles[TaskModel::PriorityRole] = "priority";
+    roles[TaskModel::StatusRole] = "status";
+    roles[TaskModel::CategoryRole] = "category";
+    roles[TaskModel::TagsRole] = "tags";
+    roles[TaskModel::ReminderEnabledRole] = "reminderEnabled";
+    roles[TaskModel::ReminderMinutesRole] = "reminderMinutes";
+    roles[TaskModel::IsOverdueRole] = "isOverdue";
+    roles[TaskModel::IsDueTodayRole] = "isDueToday";
+    roles[TaskModel::PriorityStringRole] = "priorityString";
+    roles[TaskModel::StatusStringRole] = "statusString";
+    roles[ChildCountRole] = "childCount";
+    roles[SubtreeTotalRole] = "subtreeTotal";
+    roles[SubtreeCompletedRole] = "subtreeCompleted";
+    return roles;
+}
+
+Task TaskTreeModel::getTask(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Task();
+    }
+    return static_cast<Node*>(index.internalPointer())->task;
+}
+
+QModelIndex TaskTreeModel::indexForTask(const TaskId& taskId) const
+{
+    return indexForNode(m_nodes.value(taskId));
+}
+
+bool TaskTreeModel::moveTask(const TaskId& taskId, const TaskId& newParentId)
+{
+    return m_database->setTaskParent(taskId, newParentId);
+}
+
+void TaskTreeModel::refresh()
+{
+    beginResetModel();
+
+    releaseChildren(&m_root);
+    m_transitions.clear();
+    m_timeContext = TaskTimeContext::capture();
+
+    QVector<int> childCounts;
+    QVector<Task> roots = m_database->getChildTasks(TaskId(), &childCounts);
+    m_root.children.reserve(roots.size());
+    for (int i = 0; i < roots.size(); ++i) {
+        appendChild(&m_root, createNode(roots.at(i), childCounts.value(i)));
+    }
+    m_root.childCount = roots.size();
+    m_root.childrenLoaded = true;
+
+    endResetModel();
+}
+
+void TaskTreeModel::onTaskInserted(const Task& task)
+{
+    // New tasks are roots until they are moved
+    if (m_nodes.contains(task.id())) {
+        return;
+    }
+
+    const int row = m_root.children.size();
+    beginInsertRows(QModelIndex(), row, row);
+    appendChild(&m_root, createNode(task, 0));
+    ++m_root.childCount;
+    endInsertRows();
+}
+
+void TaskTreeModel::onTaskUpdated(const Task& task, Task::Fields changedFields)
+{
+    Node* node = m_nodes.value(task.id());
+    if (!node) {
+        return;
+    }
+
+    node->task = task;
+    QModelIndex index = indexForNode(node);
+    emit dataChanged(index, index);
+
+    // The entry for the old due time is dropped when it comes up
+    if (changedFields & Task::DueTimeField) {
+        scheduleTimeTransition(task);
+    }
+
+    if (changedFields & Task::StatusField) {
+        invalidateProgress(node->parent);
+    }
+}
+
+void TaskTreeModel::onTaskDeleted(const TaskId& taskId)
+{
+    Node* node = m_nodes.value(taskId);
+    if (!node) {
+        return;
+    }
+
+    Node* parentNode = node->parent;
+    const int row = node->row;
+    beginRemoveRows(indexForNode(parentNode), row, row);
+    takeChild(node);
+    endRemoveRows();
+
+    releaseChildren(node);
+    m_nodes.remove(taskId);
+    delete node;
+
+    invalidateProgress(parentNode);
+}
+
+void TaskTreeModel::onTaskMoved(const TaskId& taskId, const TaskId& oldParentId, const TaskId& newParentId)
+{
+    Node* node = m_nodes.value(taskId);
+    Node* oldParent = node ? node->parent : parentNodeFor(oldParentId);
+    Node* newParent = parentNodeFor(newParentId);
+
+    if (node && newParent && newParent->childrenLoaded) {
+        const int destination = newParent->children.size();
+        beginMoveRows(indexForNode(oldParent), node->row, node->row, indexForNode(newParent), destination);
+        takeChild(node);
+        appendChild(newParent, node);
+        endMoveRows();
+    } else if (node) {
+        // The destination isn't expanded; the subtree is reloaded from the
+        // database if it ever is
+        beginRemoveRows(indexForNode(oldParent), node->row, node->row);
+        takeChild(node);
+        endRemoveRows();
+        releaseChildren(node);
+        m_nodes.remove(taskId);
+        delete node;
+    } else if (newParent && newParent->childrenLoaded) {
+        Task task = m_database->getTask(taskId);
+        if (!task.id().isNull()) {
+            const int row = newParent->children.size();
+            beginInsertRows(indexForNode(newParent), row, row);
+            appendChild(newParent, createNode(task, m_database->getChildTaskCount(taskId)));
+            endInsertRows();
+        }
+    }
+
+    // Expanders and cached progress of both ends
+    for (Node* end : {oldParent, newParent}) {
+        if (!end) {
+            continue;
+        }
+        if (!end->childrenLoaded) {
+            end->childCount += (end == newParent) ? 1 : -1;
+        } else {
+            end->childCount = end->children.size();
+        }
+        invalidateProgress(end);
+    }
+
+    // An end that isn't loaded may still be below loaded tasks whose
+    // progress counted the subtree
+    if (!oldParent) {
+        invalidateProgress(loadedAncestor(oldParentId));
+    }
+    if (!newParent) {
+        invalidateProgress(loadedAncestor(newParentId));
+    }
+}
+
+TaskTreeModel::Node* TaskTreeModel::nodeForIndex(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return const_cast<Node*>(&m_root);
+    }
+    return static_cast<Node*>(index.internalPointer());
+}
+
+QModelIndex TaskTreeModel::indexForNode(Node* node) const
+{
+    if (!node || node == &m_root) {
+        return QModelIndex();
+    }
+    return createIndex(node->row, 0, node);
+}
+
+TaskTreeModel::Node* TaskTreeModel::parentNodeFor(const TaskId& parentId) const
+{
+    if (parentId.isNull()) {
+        return const_cast<Node*>(&m_root);
+    }
+    return m_nodes.value(parentId);
+}
+
+// Nearest loaded task above one that isn't loaded, or null if none is
+TaskTreeModel::Node* TaskTreeModel::loadedAncestor(const TaskId& taskId) const
+{
+    for (TaskId id = m_database->getParentTask(taskId); !id.isNull(); id = m_database->getParentTask(id)) {
+        if (Node* node = m_nodes.value(id)) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+TaskTreeModel::Node* TaskTreeModel::createNode(const Task& task, int childCount)
+{
+    Node* node = new Node;
+    node->task = task;
+    node->childCount = childCount;
+    m_nodes.insert(task.id(), node);
+    scheduleTimeTransition(task);
+    return node;
+}
+
+void TaskTreeModel::appendChild(Node* parent, Node* child)
+{
+    child->parent = parent;
+    child->row = parent->children.size();
+    parent->children.append(child);
+}
+
+void TaskTreeModel::takeChild(Node* node)
+{
+    Node* parentNode = node->parent;
+    parentNode->children.removeAt(node->row);
+    renumberChildren(parentNode, node->row);
+    node->parent = nullptr;
+}
+
+void TaskTreeModel::renumberChildren(Node* parent, int fromRow)
+{
+    for (int row = fromRow; row < parent->children.size(); ++row) {
+        parent->children[row]->row = row;
+    }
+}
+
+void TaskTreeModel::releaseChildren(Node* node)
+{
+    for (Node* child : qAsConst(node->children)) {
+        releaseChildren(child);
+        m_nodes.remove(child->task.id());
+        delete child;
+    }
+    node->children.clear();
+    node->childrenLoaded = false;
+}
+
+void TaskTreeModel::invalidateProgress(Node* node)
+{
+    // Progress is cached per node, so every ancestor up to the root is stale
+    for (; node && node != &m_root; node = node->parent) {
+        if (node->subtreeTotal < 0) {
+            continue;
+        }
+        node->subtreeTotal = -1;
+        QModelIndex index = indexForNode(node);
+        emit dataChanged(index, index, {SubtreeTotalRole, SubtreeCompletedRole});
+    }
+}
+
+void TaskTreeModel::loadSubtreeProgress(Node* node) const
+{
+    if (node->subtreeTotal >= 0) {
+        return;
+    }
+
+    int total = 0;
+    int completed = 0;
+    if (!m_database->getSubtreeProgress(node->task.id(), &total, &completed)) {
+        total = 0;
+        completed = 0;
+    }
+    node->subtreeTotal = total;
+    node->subtreeCompleted = completed;
+}
+
+void TaskTreeModel::scheduleTimeTransition(const Task& task)
+{
+    const qint64 at = task.nextTimeStateChange(m_timeContext);
+    if (at == Task::NO_TIME) {
+        return;
+    }
+
+    m_transitions.append({at, task.dueTimeMsecs(), task.id()});
+    std::push_heap(m_transitions.begin(), m_transitions.end(), TimeTransition::later);
+
+    if (m_transitions.first().atMs == at) {
+        armTransitionTimer();
+    }
+}
+
+void TaskTreeModel::armTransitionTimer()
+{
+    if (m_transitions.isEmpty()) {
+        m_transitionTimer->stop();
+        return;
+    }
+
+    const qint64 wait = m_transitions.first().atMs - TaskClock::currentMSecsSinceEpoch();
+    m_transitionTimer->start(static_cast<int>(qBound<qint64>(0, wait, MAX_TRANSITION_WAIT_MS)));
+}
+
+void TaskTreeModel::processTimeTransitions()
+{
+    const TaskTimeContext previous = m_timeContext;
+    m_timeContext = TaskTimeContext::capture();
+
+    // Entries for unloaded tasks or superseded due times are dropped
+    QVector<Node*> due;
+    QSet<Node*> seen;
+    while (!m_transitions.isEmpty() && m_transitions.first().atMs <= m_timeContext.nowMs) {
+        std::pop_heap(m_transitions.begin(), m_transitions.end(), TimeTransition::later);
+        const TimeTransition transition = m_transitions.takeLast();
+
+        Node* node = m_nodes.value(transition.taskId);
+        if (node && node->task.dueTimeMsecs() == transition.dueMs && !seen.contains(node)) {
+            seen.insert(node);
+            due.append(node);
+        }
+    }
+
+    for (Node* node : qAsConst(due)) {
+        const Task& task = node->task;
+        if (task.isOverdue(previous) != task.isOverdue(m_timeContext)
+            || task.isDueToday(previous) != task.isDueToday(m_timeContext)) {
+            QModelIndex index = indexForNode(node);
+            emit dataChanged(index, index, {TaskModel::IsOverdueRole, TaskModel::IsDueTodayRole});
+        }
+        scheduleTimeTransition(task);
+    }
+
+    armTransitionTimer();
+}
@@ -0,0 +1,110 @@
+#ifndef TASKTREEMODEL_H
+#define TASKTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include "task.h"
+#include "taskmodel.h"
+
+class DatabaseManager;
+
+// Task hierarchy as a tree. Only the root level is loaded up front; a
+// node's children are queried when a view expands it (fetchMore), and each
+// query also returns the child counts the view needs to draw expanders, so
+// expanding a node never touches anything below its direct children.
+//
+// Rows carry the same roles as TaskModel plus the tree-only ones below.
+class TaskTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum TreeRoles {
+        ChildCountRole = TaskModel::StatusStringRole + 1,
+        SubtreeTotalRole,       // Descendants of the row, at any depth
+        SubtreeCompletedRole    // Of those, how many are completed
+    };
+
+    explicit TaskTreeModel(QObject *parent = nullptr);
+    ~TaskTreeModel() override;
+
+    // QAbstractItemModel interface
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    // Task access; indexForTask only finds tasks whose parent is expanded
+    Task getTask(const QModelIndex &index) const;
+    QModelIndex indexForTask(const TaskId& taskId) const;
+
+    // Reparent a task (null parent makes it a root); the tree follows
+    // through the database's taskMoved signal
+    bool moveTask(const TaskId& taskId, const TaskId& newParentId);
+
+    void refresh();
+
+public slots:
+    void onTaskInserted(const Task& task);
+    void onTaskUpdated(const Task& task, Task::Fields changedFields = Task::AllFields);
+    void onTaskDeleted(const TaskId& taskId);
+    void onTaskMoved(const TaskId& taskId, const TaskId& oldParentId, const TaskId& newParentId);
+
+private:
+    struct Node {
+        Task task;
+        Node* parent = nullptr;
+        QVector<Node*> children;
+        int row = 0;                    // Position in parent->children
+        int childCount = 0;             // Known before the children are loaded
+        bool childrenLoaded = false;
+        int subtreeTotal = -1;          // Cached progress, -1 until queried
+        int subtreeCompleted = 0;
+    };
+
+    Node* nodeForIndex(const QModelIndex &index) const;
+    QModelIndex indexForNode(Node* node) const;
+    Node* parentNodeFor(const TaskId& parentId) const;
+    Node* loadedAncestor(const TaskId& taskId) const;
+
+    Node* createNode(const Task& task, int childCount);
+    void appendChild(Node* parent, Node* child);
+    void takeChild(Node* node);
+    void renumberChildren(Node* parent, int fromRow);
+    void releaseChildren(Node* node);
+    void invalidateProgress(Node* node);
+    void loadSubtreeProgress(Node* node) const;
+
+    // Upcoming overdue/due-today transitions of loaded tasks, kept as in
+    // TaskModel: a min-heap on atMs, stale entries skipped when popped
+    struct TimeTransition {
+        qint64 atMs;
+        qint64 dueMs;       // Due time the entry was computed for
+        TaskId taskId;
+
+        static bool later(const TimeTransition& a, const TimeTransition& b) { return a.atMs > b.atMs; }
+    };
+    void scheduleTimeTransition(const Task& task);
+    void armTransitionTimer();
+    void processTimeTransitions();
+
+    Node m_root;                        // Invisible; its children are the root tasks
+    QHash<TaskId, Node*> m_nodes;       // Every loaded node
+    DatabaseManager* m_database;
+
+    QVector<TimeTransition> m_transitions;
+    QTimer* m_transitionTimer;
+
+    // Clock reading shared by every data() call until the next transition
+    // or refresh
+    TaskTimeContext m_timeContext;
+};
+
+#endif // TASKTREEMODEL_H
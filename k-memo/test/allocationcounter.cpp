@@ -0,0 +1,133 @@
+#include "allocationcounter.h"
+
+#if defined(__GLIBC__)
+
+#include <atomic>
+#include <cerrno>
+#include <malloc.h>
+#include <unistd.h>
+
+// glibc documents replacing malloc, free, calloc and realloc (and the
+// aligned variants, if anything uses them) as a way to interpose on every
+// allocation, its own and operator new's included. These forward to the
+// allocator under its internal names.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+namespace {
+// Initial-exec so that reading it never calls back into malloc
+__attribute__((tls_model("initial-exec"))) thread_local quint64 t_allocations = 0;
+std::atomic<qint64> g_liveBytes(0);
+
+void* counted(void* pointer)
+{
+    if (pointer) {
+        ++t_allocations;
+        g_liveBytes.fetch_add(qint64(malloc_usable_size(pointer)), std::memory_order_relaxed);
+    }
+    return pointer;
+}
+}
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    return counted(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size)
+{
+    return counted(__libc_calloc(count, size));
+}
+
+void* realloc(void* pointer, size_t size)
+{
+    const qint64 before = qint64(malloc_usable_size(pointer));
+    void* result = __libc_realloc(pointer, size);
+    if (result) {
+        ++t_allocations;
+        g_liveBytes.fetch_add(qint64(malloc_usable_size(result)) - before, std::memory_order_relaxed);
+    } else if (pointer && size == 0) {
+        // Freed
+        g_liveBytes.fetch_sub(before, std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void free(void* pointer)
+{
+    if (pointer) {
+        g_liveBytes.fetch_sub(qint64(malloc_usable_size(pointer)), std::memory_order_relaxed);
+    }
+    __libc_free(pointer);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    return counted(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return counted(__libc_memalign(alignment, size));
+}
+
+void* valloc(size_t size)
+{
+    return counted(__libc_memalign(size_t(sysconf(_SC_PAGESIZE)), size));
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* pointer = counted(__libc_memalign(alignment, size));
+    if (!pointer) {
+        return ENOMEM;
+    }
+    *result = pointer;
+    return 0;
+}
+
+} // extern "C"
+
+bool AllocationCounter::isActive()
+{
+    return true;
+}
+
+quint64 AllocationCounter::allocations()
+{
+    return t_allocations;
+}
+
+qint64 AllocationCounter::liveBytes()
+{
+    return g_liveBytes.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationCounter::isActive()
+{
+    return false;
+}
+
+quint64 AllocationCounter::allocations()
+{
+    return 0;
+}
+
+qint64 AllocationCounter::liveBytes()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+// Heap use as the allocator sees it, for benchmarks built with
+// COUNT_ALLOCATIONS. allocationcounter.cpp replaces malloc and friends and
+// forwards to glibc's own allocator; on other C libraries isActive() is
+// false and both counts stay zero.
+namespace AllocationCounter {
+
+bool isActive();
+
+// Blocks allocated by the calling thread since it started
+quint64 allocations();
+
+// Usable size of every block the process holds, across threads
+qint64 liveBytes();
+
+} // namespace AllocationCounter
+
+#endif // ALLOCATIONCOUNTER_H
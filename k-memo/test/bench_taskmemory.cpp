@@ -0,0 +1,116 @@
+#include <QtTest>
+#include <QFile>
+#include <unistd.h>
+#include "models/taskmodel.h"
+#include "allocationcounter.h"
+#include "testdatabase.h"
+
+namespace {
+// Resident set size from /proc, or -1 where there is none
+qint64 residentBytes()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2) {
+        return -1;
+    }
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+}
+}
+
+// Heap bytes per loaded task: the allocator's live bytes, and the resident
+// set size as a cross-check, before and after loading the same tasks the
+// SQL paging threshold lets TaskModel hold. Reported as BytesAllocated per
+// task, e.g.
+//   ./bench_taskmemory -o -,txt
+class BenchTaskMemory : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void taskVector();
+    void model();
+
+private:
+    void report(const char* what, qint64 liveBytes, qint64 residentBytes);
+
+    static constexpr int TASK_COUNT = TaskModel::SQL_PUSHDOWN_THRESHOLD;
+};
+
+void BenchTaskMemory::initTestCase()
+{
+    if (!AllocationCounter::isActive()) {
+        QSKIP("Allocations are not counted with this C library");
+    }
+    QVERIFY(TestDatabase::initialize());
+
+    // A typical list: short titles, a description on one task in four,
+    // ten categories, two tags each, half with a due time
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<Task> tasks;
+    tasks.reserve(TASK_COUNT);
+    for (int i = 0; i < TASK_COUNT; ++i) {
+        Task task(QStringLiteral("Task %1 to do").arg(i));
+        if (i % 4 == 0) {
+            task.setDescription(QStringLiteral("Some notes about task %1, a sentence or two long.").arg(i));
+        }
+        const qint64 created = now - (TASK_COUNT - i) * 600000LL;
+        task.setCreateTimeMsecs(created);
+        if (i % 2 == 0) {
+            task.setDueTimeMsecs(created + (i % 200) * 3600000LL);
+        }
+        task.setPriority(static_cast<TaskPriority>(1 + i % 4));
+        task.setCategory(QStringLiteral("Category %1").arg(i % 10));
+        task.setTags({QStringLiteral("tag%1").arg(i % 30), QStringLiteral("shared")});
+        tasks.append(task);
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks));
+
+    // Warm SQLite's page cache and the string pools, so neither is counted
+    QCOMPARE(DatabaseManager::instance()->getAllTasks().size(), TASK_COUNT);
+}
+
+void BenchTaskMemory::report(const char* what, qint64 liveBytes, qint64 residentBytes)
+{
+    qInfo("%s: %lld live bytes per task, %lld resident", what,
+          static_cast<long long>(liveBytes / TASK_COUNT),
+          static_cast<long long>(residentBytes < 0 ? -1 : residentBytes / TASK_COUNT));
+    QTest::setBenchmarkResult(qreal(liveBytes) / TASK_COUNT, QTest::BytesAllocated);
+}
+
+// The tasks alone, as DatabaseManager returns them
+void BenchTaskMemory::taskVector()
+{
+    const qint64 liveBefore = AllocationCounter::liveBytes();
+    const qint64 residentBefore = residentBytes();
+    const QVector<Task> tasks = DatabaseManager::instance()->getAllTasks();
+    const qint64 liveAfter = AllocationCounter::liveBytes();
+    const qint64 residentAfter = residentBytes();
+
+    QCOMPARE(tasks.size(), TASK_COUNT);
+    report("QVector<Task>", liveAfter - liveBefore,
+           residentBefore < 0 ? -1 : residentAfter - residentBefore);
+}
+
+// Everything TaskModel keeps per row: the tasks, their display data, the
+// row index and the time transitions
+void BenchTaskMemory::model()
+{
+    const qint64 liveBefore = AllocationCounter::liveBytes();
+    const qint64 residentBefore = residentBytes();
+    TaskModel model;
+    const qint64 liveAfter = AllocationCounter::liveBytes();
+    const qint64 residentAfter = residentBytes();
+
+    QVERIFY(!model.isSqlBacked());
+    QCOMPARE(model.rowCount(), TASK_COUNT);
+    report("TaskModel", liveAfter - liveBefore,
+           residentBefore < 0 ? -1 : residentAfter - residentBefore);
+}
+
+QTEST_GUILESS_MAIN(BenchTaskMemory)
+#include "bench_taskmemory.moc"
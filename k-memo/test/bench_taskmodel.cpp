@@ -0,0 +1,115 @@
+#include <QtTest>
+#include "models/taskmodel.h"
+#include "allocationcounter.h"
+#include "testdatabase.h"
+
+// TaskModel::data() for the roles views ask for on every repaint, over a
+// model just under the SQL paging threshold so every task is in memory.
+// Only the id and description may allocate.
+class BenchTaskModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void data_data();
+    void data();
+
+private:
+    TaskModel* m_model = nullptr;
+};
+
+void BenchTaskModel::initTestCase()
+{
+    if (!AllocationCounter::isActive()) {
+        qWarning("Allocations are not counted with this C library");
+    }
+    QVERIFY(TestDatabase::initialize());
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<Task> tasks;
+    tasks.reserve(TaskModel::SQL_PUSHDOWN_THRESHOLD);
+    for (int i = 0; i < TaskModel::SQL_PUSHDOWN_THRESHOLD; ++i) {
+        Task task(QStringLiteral("Task %1").arg(i));
+        // Due after creation, as insertTask() requires; most are overdue
+        const qint64 created = now - (TaskModel::SQL_PUSHDOWN_THRESHOLD - i) * 600000LL;
+        task.setCreateTimeMsecs(created);
+        if (i % 2 == 0) {
+            task.setDueTimeMsecs(created + (i % 200) * 3600000LL);
+        }
+        task.setPriority(static_cast<TaskPriority>(1 + i % 4));
+        task.setCategory(QStringLiteral("Category %1").arg(i % 10));
+        task.setTags({QStringLiteral("tag%1").arg(i % 30), QStringLiteral("shared")});
+        tasks.append(task);
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks));
+
+    m_model = new TaskModel(this);
+    QVERIFY(!m_model->isSqlBacked());
+    QCOMPARE(m_model->rowCount(), TaskModel::SQL_PUSHDOWN_THRESHOLD);
+}
+
+void BenchTaskModel::cleanupTestCase()
+{
+    delete m_model;
+    m_model = nullptr;
+}
+
+void BenchTaskModel::data_data()
+{
+    QTest::addColumn<int>("role");
+    QTest::addColumn<bool>("allocates");
+
+    QTest::newRow("id") << int(TaskModel::IdRole) << true;
+    QTest::newRow("display") << int(Qt::DisplayRole) << false;
+    QTest::newRow("description") << int(TaskModel::DescriptionRole) << true;
+    QTest::newRow("createTime") << int(TaskModel::CreateTimeRole) << false;
+    QTest::newRow("dueTime") << int(TaskModel::DueTimeRole) << false;
+    QTest::newRow("priority") << int(TaskModel::PriorityRole) << false;
+    QTest::newRow("status") << int(TaskModel::StatusRole) << false;
+    QTest::newRow("category") << int(TaskModel::CategoryRole) << false;
+    QTest::newRow("tags") << int(TaskModel::TagsRole) << false;
+    QTest::newRow("reminderEnabled") << int(TaskModel::ReminderEnabledRole) << false;
+    QTest::newRow("reminderMinutes") << int(TaskModel::ReminderMinutesRole) << false;
+    QTest::newRow("isOverdue") << int(TaskModel::IsOverdueRole) << false;
+    QTest::newRow("isDueToday") << int(TaskModel::IsDueTodayRole) << false;
+    QTest::newRow("priorityString") << int(TaskModel::PriorityStringRole) << false;
+    QTest::newRow("statusString") << int(TaskModel::StatusStringRole) << false;
+}
+
+void BenchTaskModel::data()
+{
+    QFETCH(int, role);
+    QFETCH(bool, allocates);
+
+    const int rows = m_model->rowCount();
+    QVector<QModelIndex> indexes;
+    indexes.reserve(rows);
+    for (int row = 0; row < rows; ++row) {
+        indexes.append(m_model->index(row));
+    }
+
+    int valid = 0;
+    QBENCHMARK {
+        valid = 0;
+        for (const QModelIndex& index : qAsConst(indexes)) {
+            valid += m_model->data(index, role).isValid();
+        }
+    }
+    QCOMPARE(valid, rows);
+
+    // One more pass, counted; the benchmark has already built anything
+    // data() prepares on first use
+    const quint64 before = AllocationCounter::allocations();
+    for (const QModelIndex& index : qAsConst(indexes)) {
+        m_model->data(index, role);
+    }
+    const quint64 allocations = AllocationCounter::allocations() - before;
+    if (!allocates && AllocationCounter::isActive()) {
+        QCOMPARE(allocations, quint64(0));
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchTaskModel)
+#include "bench_taskmodel.moc"
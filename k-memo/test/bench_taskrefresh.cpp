@@ -0,0 +1,180 @@
+#include <QtTest>
+#include "models/taskmodel.h"
+#include "allocationcounter.h"
+#include "testdatabase.h"
+
+namespace {
+const QString UNCATEGORIZED = QStringLiteral("未分类");
+
+struct Stats {
+    int total = 0;
+    int completed = 0;
+    int pending = 0;
+    int inProgress = 0;
+    int overdue = 0;
+    QMap<QString, int> categories;
+};
+
+// What TaskStatsWidget did before the model kept counters: a copy of the
+// task list for the statistics and another for the categories
+Stats scanTasks(const TaskModel& model)
+{
+    Stats stats;
+    const QVector<Task> tasks = model.getAllTasks();
+    stats.total = tasks.size();
+    for (const Task& task : tasks) {
+        switch (task.status()) {
+        case TaskStatus::Completed:
+            ++stats.completed;
+            break;
+        case TaskStatus::Pending:
+            ++stats.pending;
+            break;
+        case TaskStatus::InProgress:
+            ++stats.inProgress;
+            break;
+        case TaskStatus::Cancelled:
+            break;
+        }
+        if (task.isOverdue()) {
+            ++stats.overdue;
+        }
+    }
+
+    const QVector<Task> categorized = model.getAllTasks();
+    for (const Task& task : categorized) {
+        const QString category = task.category();
+        ++stats.categories[category.isEmpty() ? UNCATEGORIZED : category];
+    }
+    return stats;
+}
+
+// What TaskStatsWidget::updateStatistics() and updateCategoriesDisplay()
+// read now
+Stats readCounters(const TaskModel& model)
+{
+    Stats stats;
+    stats.total = model.getTaskCount();
+    stats.completed = model.countByStatus(TaskStatus::Completed);
+    stats.pending = model.countByStatus(TaskStatus::Pending);
+    stats.inProgress = model.countByStatus(TaskStatus::InProgress);
+    stats.overdue = model.overdueCount();
+
+    const QHash<QString, int>& counts = model.categoryCounts();
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        stats.categories[it.key().isEmpty() ? UNCATEGORIZED : it.key()] += it.value();
+    }
+    return stats;
+}
+}
+
+// TaskModel::refresh() and the statistics TaskStatsWidget shows after one,
+// over a model just under the SQL paging threshold. Each also prints the
+// heap allocations one run makes.
+class BenchTaskRefresh : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void refresh();
+    void stats_data();
+    void stats();
+
+private:
+    static void reportAllocations(const char* what, quint64 allocations);
+
+    TaskModel* m_model = nullptr;
+};
+
+void BenchTaskRefresh::initTestCase()
+{
+    if (!AllocationCounter::isActive()) {
+        qWarning("Allocations are not counted with this C library");
+    }
+    QVERIFY(TestDatabase::initialize());
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<Task> tasks;
+    tasks.reserve(TaskModel::SQL_PUSHDOWN_THRESHOLD);
+    for (int i = 0; i < TaskModel::SQL_PUSHDOWN_THRESHOLD; ++i) {
+        Task task(QStringLiteral("Task %1").arg(i));
+        task.setDescription(QStringLiteral("Notes for task %1").arg(i));
+        const qint64 created = now - (TaskModel::SQL_PUSHDOWN_THRESHOLD - i) * 600000LL;
+        task.setCreateTimeMsecs(created);
+        if (i % 2 == 0) {
+            task.setDueTimeMsecs(created + (i % 200) * 3600000LL);
+        }
+        task.setPriority(static_cast<TaskPriority>(1 + i % 4));
+        task.setStatus(static_cast<TaskStatus>(i % 4));
+        task.setCategory(i % 11 == 0 ? QString() : QStringLiteral("Category %1").arg(i % 10));
+        task.setTags({QStringLiteral("tag%1").arg(i % 30), QStringLiteral("shared")});
+        tasks.append(task);
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks));
+
+    m_model = new TaskModel(this);
+    QVERIFY(!m_model->isSqlBacked());
+    QCOMPARE(m_model->rowCount(), TaskModel::SQL_PUSHDOWN_THRESHOLD);
+}
+
+void BenchTaskRefresh::cleanupTestCase()
+{
+    delete m_model;
+    m_model = nullptr;
+}
+
+void BenchTaskRefresh::reportAllocations(const char* what, quint64 allocations)
+{
+    if (AllocationCounter::isActive()) {
+        qInfo("%s: %llu allocations, %.2f per task", what, static_cast<unsigned long long>(allocations),
+              double(allocations) / TaskModel::SQL_PUSHDOWN_THRESHOLD);
+    }
+}
+
+void BenchTaskRefresh::refresh()
+{
+    QBENCHMARK {
+        m_model->refresh();
+    }
+    QCOMPARE(m_model->rowCount(), TaskModel::SQL_PUSHDOWN_THRESHOLD);
+
+    const quint64 before = AllocationCounter::allocations();
+    m_model->refresh();
+    reportAllocations("refresh()", AllocationCounter::allocations() - before);
+}
+
+void BenchTaskRefresh::stats_data()
+{
+    QTest::addColumn<bool>("scan");
+
+    QTest::newRow("scan") << true;
+    QTest::newRow("counters") << false;
+}
+
+void BenchTaskRefresh::stats()
+{
+    QFETCH(bool, scan);
+
+    Stats stats;
+    QBENCHMARK {
+        stats = scan ? scanTasks(*m_model) : readCounters(*m_model);
+    }
+
+    // Both ways agree
+    const Stats expected = scanTasks(*m_model);
+    QCOMPARE(stats.total, expected.total);
+    QCOMPARE(stats.completed, expected.completed);
+    QCOMPARE(stats.pending, expected.pending);
+    QCOMPARE(stats.inProgress, expected.inProgress);
+    QCOMPARE(stats.overdue, expected.overdue);
+    QCOMPARE(stats.categories, expected.categories);
+
+    const quint64 before = AllocationCounter::allocations();
+    stats = scan ? scanTasks(*m_model) : readCounters(*m_model);
+    reportAllocations(QTest::currentDataTag(), AllocationCounter::allocations() - before);
+}
+
+QTEST_GUILESS_MAIN(BenchTaskRefresh)
+#include "bench_taskrefresh.moc"
@@ -0,0 +1,115 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include "models/tasksearchindex.h"
+#include "testdatabase.h"
+
+// Search as you type over 100k tasks: each keystroke runs one search, and
+// the budget for one is 5 ms
+class BenchTaskSearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void search_data();
+    void search();
+    void keystrokeBudget_data();
+    void keystrokeBudget();
+
+private:
+    TaskSearchIndex* m_index = nullptr;
+
+    static constexpr int TASK_COUNT = 100000;
+    static constexpr qint64 KEYSTROKE_BUDGET_MSECS = 5;
+};
+
+void BenchTaskSearchIndex::initTestCase()
+{
+    QVERIFY(TestDatabase::initialize());
+
+    const QStringList words = {
+        QStringLiteral("project"), QStringLiteral("report"), QStringLiteral("review"),
+        QStringLiteral("meeting"), QStringLiteral("invoice"), QStringLiteral("release"),
+        QStringLiteral("design"), QStringLiteral("budget"), QStringLiteral("customer"),
+        QStringLiteral("项目"), QStringLiteral("周报"), QStringLiteral("会议"),
+        QStringLiteral("预算"), QStringLiteral("设计"), QStringLiteral("客户")
+    };
+
+    QVector<Task> tasks;
+    tasks.reserve(TASK_COUNT);
+    for (int i = 0; i < TASK_COUNT; ++i) {
+        const QString title = words.at(i % words.size()) + QLatin1Char(' ')
+            + words.at((i / words.size()) % words.size()) + QStringLiteral(" %1").arg(i);
+        Task task(title);
+        task.setTags({words.at((i * 7) % words.size())});
+        tasks.append(task);
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks));
+
+    m_index = new TaskSearchIndex(this);
+    QCOMPARE(m_index->size(), TASK_COUNT);
+}
+
+void BenchTaskSearchIndex::cleanupTestCase()
+{
+    delete m_index;
+    m_index = nullptr;
+}
+
+void BenchTaskSearchIndex::search_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("one letter") << QStringLiteral("r");
+    QTest::newRow("two letters") << QStringLiteral("re");
+    QTest::newRow("word") << QStringLiteral("review");
+    QTest::newRow("typo") << QStringLiteral("reveiw");
+    QTest::newRow("two words") << QStringLiteral("budget meeting");
+    QTest::newRow("number") << QStringLiteral("4242");
+    QTest::newRow("ideographs") << QStringLiteral("周报");
+    QTest::newRow("pinyin") << QStringLiteral("zhoubao");
+    QTest::newRow("initials") << QStringLiteral("xmzb");
+    QTest::newRow("no match") << QStringLiteral("zzzzzz");
+}
+
+void BenchTaskSearchIndex::search()
+{
+    QFETCH(QString, query);
+
+    QBENCHMARK {
+        m_index->search(query);
+    }
+}
+
+void BenchTaskSearchIndex::keystrokeBudget_data()
+{
+    QTest::addColumn<QString>("typed");
+
+    QTest::newRow("latin") << QStringLiteral("customer review");
+    QTest::newRow("typo") << QStringLiteral("custmoer reveiw");
+    QTest::newRow("pinyin") << QStringLiteral("xiangmu zhoubao");
+}
+
+// Each prefix of the typed text is one keystroke; the best of a few runs
+// keeps a busy machine from failing it
+void BenchTaskSearchIndex::keystrokeBudget()
+{
+    QFETCH(QString, typed);
+
+    for (int length = 1; length <= typed.size(); ++length) {
+        const QString query = typed.left(length);
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int run = 0; run < 5; ++run) {
+            QElapsedTimer timer;
+            timer.start();
+            m_index->search(query);
+            best = qMin(best, timer.elapsed());
+        }
+        QVERIFY2(best < KEYSTROKE_BUDGET_MSECS,
+                 qPrintable(QStringLiteral("\"%1\" took %2 ms").arg(query).arg(best)));
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchTaskSearchIndex)
+#include "bench_tasksearchindex.moc"
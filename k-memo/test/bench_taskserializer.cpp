@@ -0,0 +1,102 @@
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include "models/taskserializer.h"
+
+// CBOR streaming against the JSON export it replaced, on 100k tasks
+class BenchTaskSerializer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void serializeCbor();
+    void deserializeCbor();
+    void serializeJson();
+    void deserializeJson();
+
+private:
+    static QByteArray toJson(const QVector<Task>& tasks);
+
+    QVector<Task> m_tasks;
+    QByteArray m_cbor;
+    QByteArray m_json;
+
+    static constexpr int TASK_COUNT = 100000;
+};
+
+void BenchTaskSerializer::initTestCase()
+{
+    const qint64 start = 1700000000000;
+    m_tasks.reserve(TASK_COUNT);
+    for (int i = 0; i < TASK_COUNT; ++i) {
+        Task task(QStringLiteral("Task number %1").arg(i), QStringLiteral("Details for task %1").arg(i));
+        task.setCreateTimeMsecs(start + i * 60000LL);
+        if (i % 3 == 0) {
+            task.setDueTimeMsecs(start + i * 3600000LL);
+        }
+        task.setPriority(static_cast<TaskPriority>(1 + i % 4));
+        task.setCategory(QStringLiteral("Category %1").arg(i % 20));
+        task.setTags({QStringLiteral("tag%1").arg(i % 50)});
+        m_tasks.append(task);
+    }
+
+    m_cbor = TaskSerializer::serialize(m_tasks);
+    m_json = toJson(m_tasks);
+    qInfo("CBOR %d bytes, JSON %d bytes", m_cbor.size(), m_json.size());
+}
+
+QByteArray BenchTaskSerializer::toJson(const QVector<Task>& tasks)
+{
+    QJsonArray array;
+    for (const Task& task : tasks) {
+        array.append(task.toJson());
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+void BenchTaskSerializer::serializeCbor()
+{
+    QByteArray data;
+    QBENCHMARK {
+        data = TaskSerializer::serialize(m_tasks);
+    }
+    QCOMPARE(data.size(), m_cbor.size());
+}
+
+void BenchTaskSerializer::deserializeCbor()
+{
+    QVector<Task> tasks;
+    QBENCHMARK {
+        QVERIFY(TaskSerializer::deserialize(m_cbor, &tasks));
+    }
+    QCOMPARE(tasks.size(), TASK_COUNT);
+}
+
+void BenchTaskSerializer::serializeJson()
+{
+    QByteArray data;
+    QBENCHMARK {
+        data = toJson(m_tasks);
+    }
+    QCOMPARE(data.size(), m_json.size());
+}
+
+void BenchTaskSerializer::deserializeJson()
+{
+    QVector<Task> tasks;
+    QBENCHMARK {
+        tasks.clear();
+        const QJsonArray array = QJsonDocument::fromJson(m_json).array();
+        tasks.reserve(array.size());
+        for (const QJsonValue& value : array) {
+            Task task;
+            task.fromJson(value.toObject());
+            tasks.append(task);
+        }
+    }
+    QCOMPARE(tasks.size(), TASK_COUNT);
+}
+
+QTEST_GUILESS_MAIN(BenchTaskSerializer)
+#include "bench_taskserializer.moc"
@@ -0,0 +1,49 @@
+#ifndef TESTDATABASE_H
+#define TESTDATABASE_H
+
+#include <QDir>
+#include <QStandardPaths>
+#include "database/databasemanager.h"
+
+// Helpers for tests that need DatabaseManager. Test mode keeps the database
+// under the test's own data directory, which is emptied first, so every run
+// starts from an empty (or prepared) database.
+namespace TestDatabase {
+
+inline QString dataDirectory()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+}
+
+inline void clear()
+{
+    QDir(dataDirectory()).removeRecursively();
+}
+
+inline bool initialize()
+{
+    clear();
+    return DatabaseManager::instance()->initialize();
+}
+
+// In one transaction and one change batch, as an import would
+inline bool insertTasks(const QVector<Task>& tasks)
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    TaskChangeBatch batch(database);
+    if (!database->beginTransaction()) {
+        return false;
+    }
+    for (const Task& task : tasks) {
+        if (!database->insertTask(task)) {
+            database->rollbackTransaction();
+            return false;
+        }
+    }
+    return database->commitTransaction();
+}
+
+} // namespace TestDatabase
+
+#endif // TESTDATABASE_H
@@ -0,0 +1,305 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include "models/dependencygraph.h"
+#include "testdatabase.h"
+
+namespace {
+bool isDone(TaskStatus status)
+{
+    return status == TaskStatus::Completed || status == TaskStatus::Cancelled;
+}
+
+// The same graph as plain edge pairs, answered by exhaustive search
+struct BruteForceGraph {
+    QHash<TaskId, TaskStatus> statuses;
+    QSet<QPair<TaskId, TaskId>> edges;      // (task, blocker)
+
+    // Along blocker -> dependent edges
+    bool reaches(const TaskId& from, const TaskId& target) const
+    {
+        QSet<TaskId> seen;
+        QVector<TaskId> stack{from};
+        while (!stack.isEmpty()) {
+            const TaskId node = stack.takeLast();
+            if (node == target) {
+                return true;
+            }
+            if (seen.contains(node)) {
+                continue;
+            }
+            seen.insert(node);
+            for (const auto& edge : edges) {
+                if (edge.second == node) {
+                    stack.append(edge.first);
+                }
+            }
+        }
+        return false;
+    }
+
+    bool wouldCreateCycle(const TaskId& taskId, const TaskId& blockerId) const
+    {
+        return reaches(taskId, blockerId);
+    }
+
+    bool isReady(const TaskId& taskId) const
+    {
+        if (isDone(statuses.value(taskId))) {
+            return false;
+        }
+        for (const auto& edge : edges) {
+            if (edge.first == taskId && !isDone(statuses.value(edge.second))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void removeTask(const TaskId& taskId)
+    {
+        statuses.remove(taskId);
+        for (auto it = edges.begin(); it != edges.end();) {
+            if (it->first == taskId || it->second == taskId) {
+                it = edges.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+}
+
+class TestDependencyGraph : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void rejectsCycles();
+    void agreesWithSearch_data();
+    void agreesWithSearch();
+    void readyFollowsStatus();
+
+private:
+    QVector<TaskId> addTasks(int count, BruteForceGraph* expected);
+    void compare(const DependencyGraph& graph, const BruteForceGraph& expected) const;
+    void setStatus(const TaskId& taskId, TaskStatus status, BruteForceGraph* expected);
+
+    static constexpr int TASK_COUNT = 40;
+};
+
+void TestDependencyGraph::initTestCase()
+{
+    qRegisterMetaType<TaskId>();
+    QVERIFY(TestDatabase::initialize());
+}
+
+QVector<TaskId> TestDependencyGraph::addTasks(int count, BruteForceGraph* expected)
+{
+    QVector<TaskId> ids;
+    for (int i = 0; i < count; ++i) {
+        const Task task(QStringLiteral("Step %1").arg(i));
+        if (!DatabaseManager::instance()->insertTask(task)) {
+            return QVector<TaskId>();
+        }
+        expected->statuses.insert(task.id(), task.status());
+        ids.append(task.id());
+    }
+    return ids;
+}
+
+// Every task the oracle knows: same blockers, same readiness, and the
+// ready set holds exactly the ready ones. Other tests' tasks have no edges
+// to these, so they are left out.
+void TestDependencyGraph::compare(const DependencyGraph& graph, const BruteForceGraph& expected) const
+{
+    QSet<TaskId> ready;
+    for (auto it = expected.statuses.constBegin(); it != expected.statuses.constEnd(); ++it) {
+        const TaskId& taskId = it.key();
+        QSet<TaskId> blockers;
+        for (const auto& edge : expected.edges) {
+            if (edge.first == taskId) {
+                blockers.insert(edge.second);
+            }
+        }
+        const QVector<TaskId> stored = graph.blockers(taskId);
+        QCOMPARE(QSet<TaskId>(stored.cbegin(), stored.cend()), blockers);
+
+        QCOMPARE(graph.isReady(taskId), expected.isReady(taskId));
+        if (expected.isReady(taskId)) {
+            ready.insert(taskId);
+        }
+    }
+
+    QSet<TaskId> listed;
+    for (const TaskId& taskId : graph.readyTasks()) {
+        if (expected.statuses.contains(taskId)) {
+            listed.insert(taskId);
+        }
+    }
+    QCOMPARE(listed, ready);
+}
+
+void TestDependencyGraph::setStatus(const TaskId& taskId, TaskStatus status, BruteForceGraph* expected)
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    Task task = database->getTask(taskId);
+    const TaskStatus before = task.status();
+    task.setStatus(status);
+
+    // The database refuses what Task::isValidTransition() refuses
+    const bool valid = status == before || Task::isValidTransition(before, status);
+    QCOMPARE(database->updateTask(task), valid);
+    if (valid) {
+        expected->statuses[taskId] = status;
+    }
+}
+
+void TestDependencyGraph::rejectsCycles()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    DependencyGraph graph;
+    BruteForceGraph expected;
+    const QVector<TaskId> ids = addTasks(4, &expected);
+    QCOMPARE(ids.size(), 4);
+
+    // 0 <- 1 <- 2 <- 3, each blocked by the one before
+    for (int i = 1; i < ids.size(); ++i) {
+        QVERIFY(graph.addDependency(ids.at(i), ids.at(i - 1)));
+        expected.edges.insert(qMakePair(ids.at(i), ids.at(i - 1)));
+    }
+    compare(graph, expected);
+
+    QVERIFY(graph.wouldCreateCycle(ids.at(0), ids.at(3)));
+    QVERIFY(!graph.addDependency(ids.at(0), ids.at(3)));
+    QVERIFY(!graph.addDependency(ids.at(1), ids.at(2)));
+    QVERIFY(!graph.addDependency(ids.at(2), ids.at(2)));
+    QVERIFY(!database->addTaskDependency(ids.at(0), ids.at(2)));
+    compare(graph, expected);
+
+    // A shortcut along the chain is fine, and once the chain is cut the
+    // reverse edge is too
+    QVERIFY(!graph.wouldCreateCycle(ids.at(3), ids.at(0)));
+    QVERIFY(graph.addDependency(ids.at(3), ids.at(0)));
+    expected.edges.insert(qMakePair(ids.at(3), ids.at(0)));
+    QVERIFY(graph.removeDependency(ids.at(2), ids.at(1)));
+    expected.edges.remove(qMakePair(ids.at(2), ids.at(1)));
+    QVERIFY(graph.addDependency(ids.at(1), ids.at(2)));
+    expected.edges.insert(qMakePair(ids.at(1), ids.at(2)));
+    compare(graph, expected);
+}
+
+void TestDependencyGraph::agreesWithSearch_data()
+{
+    QTest::addColumn<quint32>("seed");
+
+    QTest::newRow("1") << 1u;
+    QTest::newRow("2") << 2u;
+    QTest::newRow("3") << 3u;
+}
+
+// Random edges, most of them against the graph's current order, some
+// removed again; every answer matches a full search
+void TestDependencyGraph::agreesWithSearch()
+{
+    QFETCH(quint32, seed);
+
+    DatabaseManager* database = DatabaseManager::instance();
+    DependencyGraph graph;
+    BruteForceGraph expected;
+    const QVector<TaskId> ids = addTasks(TASK_COUNT, &expected);
+    QCOMPARE(ids.size(), TASK_COUNT);
+
+    QRandomGenerator random(seed);
+    for (int step = 0; step < 400; ++step) {
+        const TaskId taskId = ids.at(random.bounded(TASK_COUNT));
+        const TaskId blockerId = ids.at(random.bounded(TASK_COUNT));
+        const auto edge = qMakePair(taskId, blockerId);
+
+        if (expected.edges.contains(edge) && random.bounded(3) == 0) {
+            QVERIFY(graph.removeDependency(taskId, blockerId));
+            expected.edges.remove(edge);
+        } else if (!expected.edges.contains(edge)) {
+            const bool cycle = expected.wouldCreateCycle(taskId, blockerId);
+            QCOMPARE(graph.wouldCreateCycle(taskId, blockerId), cycle);
+            QCOMPARE(graph.addDependency(taskId, blockerId), !cycle);
+            if (!cycle) {
+                expected.edges.insert(edge);
+            }
+        }
+
+        if (step % 20 == 0) {
+            setStatus(ids.at(random.bounded(TASK_COUNT)), static_cast<TaskStatus>(random.bounded(4)), &expected);
+        }
+        compare(graph, expected);
+    }
+
+    // Edges added straight to the database reach the graph by signal, and
+    // a reload rebuilds the same graph
+    const TaskId extra = addTasks(1, &expected).value(0);
+    QVERIFY(!extra.isNull());
+    QVERIFY(database->addTaskDependency(extra, ids.at(0)));
+    expected.edges.insert(qMakePair(extra, ids.at(0)));
+    compare(graph, expected);
+
+    DependencyGraph reloaded;
+    compare(reloaded, expected);
+}
+
+// Blocked tasks become ready as their blockers complete, are cancelled or
+// go away, and blocked again when a blocker reopens
+void TestDependencyGraph::readyFollowsStatus()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    DependencyGraph graph;
+    BruteForceGraph expected;
+    const QVector<TaskId> ids = addTasks(TASK_COUNT, &expected);
+    QCOMPARE(ids.size(), TASK_COUNT);
+
+    // Each task blocked by up to three earlier ones: acyclic by construction
+    QRandomGenerator random(7);
+    for (int i = 1; i < TASK_COUNT; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            const TaskId blockerId = ids.at(random.bounded(i));
+            if (graph.addDependency(ids.at(i), blockerId)) {
+                expected.edges.insert(qMakePair(ids.at(i), blockerId));
+            }
+        }
+    }
+    compare(graph, expected);
+    QVERIFY(graph.isReady(ids.at(0)));
+    QVERIFY(graph.isBlocked(ids.at(TASK_COUNT - 1)));
+
+    QSignalSpy readyChanged(&graph, &DependencyGraph::readyChanged);
+    for (int step = 0; step < 300; ++step) {
+        const TaskId taskId = ids.at(random.bounded(TASK_COUNT));
+        if (!expected.statuses.contains(taskId)) {
+            continue;
+        }
+        if (step % 50 == 49) {
+            QVERIFY(database->deleteTask(taskId));
+            expected.removeTask(taskId);
+        } else {
+            setStatus(taskId, static_cast<TaskStatus>(random.bounded(4)), &expected);
+        }
+        compare(graph, expected);
+    }
+
+    // Every notification matches where the task ended up, or was later
+    // superseded by another
+    QVERIFY(readyChanged.count() > 0);
+    QHash<TaskId, bool> lastReady;
+    for (const QList<QVariant>& arguments : qAsConst(readyChanged)) {
+        lastReady.insert(arguments.at(0).value<TaskId>(), arguments.at(1).toBool());
+    }
+    for (auto it = lastReady.constBegin(); it != lastReady.constEnd(); ++it) {
+        if (expected.statuses.contains(it.key())) {
+            QCOMPARE(it.value(), expected.isReady(it.key()));
+        } else {
+            QVERIFY(!it.value());
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestDependencyGraph)
+#include "tst_dependencygraph.moc"
@@ -0,0 +1,246 @@
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include "models/tasksorter.h"
+#include "testdatabase.h"
+
+namespace {
+// A version 1 database as the first release wrote it: TEXT ids in the
+// braced QUuid form, times as ISO strings, no later tables or columns
+const char* const V1_SCHEMA[] = {
+    R"(CREATE TABLE tasks (
+        id TEXT PRIMARY KEY,
+        title TEXT NOT NULL,
+        description TEXT,
+        create_time DATETIME DEFAULT CURRENT_TIMESTAMP,
+        due_time DATETIME,
+        priority INTEGER DEFAULT 2,
+        status INTEGER DEFAULT 0,
+        category TEXT DEFAULT 'default',
+        reminder_enabled BOOLEAN DEFAULT 0,
+        reminder_minutes INTEGER DEFAULT 15
+    ))",
+    R"(CREATE TABLE task_tags (
+        task_id TEXT,
+        tag TEXT,
+        PRIMARY KEY(task_id, tag),
+        FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE
+    ))",
+    "CREATE TABLE app_config (key TEXT PRIMARY KEY, value TEXT)",
+    "INSERT INTO app_config (key, value) VALUES ('database_version', '1')"
+};
+
+struct V1Task {
+    QString id;
+    QString title;
+    QString description;
+    QString createTime;
+    QString dueTime;        // Empty for none
+    int priority;
+    int status;
+    QString category;
+    QStringList tags;
+};
+
+const QVector<V1Task> V1_TASKS = {
+    {QStringLiteral("{6f1c2a44-3b7e-4d2a-9c51-0a8e1f2b3c4d}"), QStringLiteral("Weekly report"),
+     QStringLiteral("Send it to the team"), QStringLiteral("2026-01-02T09:30:00.000"),
+     QStringLiteral("2026-01-09T17:00:00.000"), 3, 1, QStringLiteral("Work"),
+     {QStringLiteral("report"), QStringLiteral("weekly")}},
+    {QStringLiteral("{0b9d8e7f-6a5b-4c3d-8e2f-1a0b9c8d7e6f}"), QStringLiteral("项目预算"),
+     QString(), QStringLiteral("2026-01-03T08:00:00.000"), QString(), 2, 0, QStringLiteral("default"),
+     {QStringLiteral("预算")}},
+    {QStringLiteral("{c3d4e5f6-a7b8-4c9d-8e0f-112233445566}"), QStringLiteral("Renew passport"),
+     QString(), QStringLiteral("2026-01-04T12:15:00.000"), QString(), 4, 2, QStringLiteral("Home"),
+     {}}
+};
+
+const char V1_CONNECTION[] = "v1";
+
+// Same as DatabaseManager's
+const int CURRENT_VERSION = 6;
+const char DATABASE_NAME[] = "kmemo.db";
+
+bool writeV1Database(const QString& path)
+{
+    bool ok = true;
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", V1_CONNECTION);
+        database.setDatabaseName(path);
+        ok = database.open();
+
+        QSqlQuery query(database);
+        for (const char* statement : V1_SCHEMA) {
+            ok = ok && query.exec(statement);
+        }
+
+        QSqlQuery insertTask(database);
+        insertTask.prepare("INSERT INTO tasks (id, title, description, create_time, due_time, "
+                           "priority, status, category) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+        QSqlQuery insertTag(database);
+        insertTag.prepare("INSERT INTO task_tags (task_id, tag) VALUES (?, ?)");
+        for (const V1Task& task : V1_TASKS) {
+            insertTask.addBindValue(task.id);
+            insertTask.addBindValue(task.title);
+            insertTask.addBindValue(task.description);
+            insertTask.addBindValue(task.createTime);
+            insertTask.addBindValue(task.dueTime.isEmpty() ? QVariant() : QVariant(task.dueTime));
+            insertTask.addBindValue(task.priority);
+            insertTask.addBindValue(task.status);
+            insertTask.addBindValue(task.category);
+            ok = ok && insertTask.exec();
+
+            for (const QString& tag : task.tags) {
+                insertTag.addBindValue(task.id);
+                insertTag.addBindValue(tag);
+                ok = ok && insertTag.exec();
+            }
+        }
+        if (!ok) {
+            qWarning() << "Failed to write version 1 database:" << query.lastError().text()
+                       << insertTask.lastError().text() << insertTag.lastError().text();
+        }
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(V1_CONNECTION);
+    return ok;
+}
+
+QVariant scalar(const QString& statement)
+{
+    QSqlQuery query(QSqlDatabase::database());
+    if (!query.exec(statement) || !query.next()) {
+        return QVariant();
+    }
+    return query.value(0);
+}
+
+QStringList columnNames(const QString& table)
+{
+    QStringList names;
+    QSqlQuery query(QSqlDatabase::database());
+    query.exec(QStringLiteral("PRAGMA table_info(%1)").arg(table));
+    while (query.next()) {
+        names.append(query.value("name").toString());
+    }
+    return names;
+}
+}
+
+class TestMigration : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void updatesVersion();
+    void convertsIdsToBinary();
+    void keepsTasks();
+    void keepsTags();
+    void seedsHierarchy();
+    void addsColumns();
+    void backfillsTitleKeys();
+    void acceptsNewTasks();
+};
+
+void TestMigration::initTestCase()
+{
+    TestDatabase::clear();
+    const QString directory = TestDatabase::dataDirectory();
+    QVERIFY(QDir().mkpath(directory));
+    QVERIFY(writeV1Database(directory + QLatin1Char('/') + DATABASE_NAME));
+
+    QVERIFY(DatabaseManager::instance()->initialize());
+}
+
+void TestMigration::updatesVersion()
+{
+    QCOMPARE(scalar("SELECT value FROM app_config WHERE key = 'database_version'").toInt(), CURRENT_VERSION);
+}
+
+void TestMigration::convertsIdsToBinary()
+{
+    QCOMPARE(scalar("SELECT COUNT(*) FROM tasks").toInt(), V1_TASKS.size());
+    QCOMPARE(scalar("SELECT COUNT(*) FROM tasks WHERE typeof(id) <> 'blob' OR length(id) <> 16").toInt(), 0);
+    QCOMPARE(scalar("SELECT COUNT(*) FROM task_tags WHERE typeof(task_id) <> 'blob'").toInt(), 0);
+}
+
+void TestMigration::keepsTasks()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    for (const V1Task& expected : V1_TASKS) {
+        const Task task = database->getTask(TaskId::fromString(expected.id));
+        QVERIFY2(task.isValid(), qPrintable(expected.id));
+        QCOMPARE(task.title(), expected.title);
+        QCOMPARE(task.description(), expected.description);
+        QCOMPARE(task.createTime(), QDateTime::fromString(expected.createTime, Qt::ISODateWithMs));
+        if (expected.dueTime.isEmpty()) {
+            QVERIFY(!task.hasDueTime());
+        } else {
+            QCOMPARE(task.dueTime(), QDateTime::fromString(expected.dueTime, Qt::ISODateWithMs));
+        }
+        QCOMPARE(int(task.priority()), expected.priority);
+        QCOMPARE(int(task.status()), expected.status);
+        QCOMPARE(task.category(), expected.category);
+        QVERIFY(!task.isRecurring());
+    }
+}
+
+void TestMigration::keepsTags()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    for (const V1Task& expected : V1_TASKS) {
+        QStringList tags = database->getTaskTags(TaskId::fromString(expected.id));
+        tags.sort();
+        QStringList expectedTags = expected.tags;
+        expectedTags.sort();
+        QCOMPARE(tags, expectedTags);
+    }
+}
+
+// Every existing task is a root: its own depth-0 row and nothing else
+void TestMigration::seedsHierarchy()
+{
+    QCOMPARE(scalar("SELECT COUNT(*) FROM task_closure").toInt(), V1_TASKS.size());
+    QCOMPARE(scalar("SELECT COUNT(*) FROM task_closure c JOIN tasks t ON t.id = c.descendant "
+                    "WHERE c.ancestor = c.descendant AND c.depth = 0").toInt(), V1_TASKS.size());
+}
+
+void TestMigration::addsColumns()
+{
+    const QStringList columns = columnNames("tasks");
+    QVERIFY(columns.contains("recurrence"));
+    QVERIFY(columns.contains("title_key"));
+    QCOMPARE(scalar("SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' "
+                    "AND name = 'idx_tasks_title_key'").toInt(), 1);
+}
+
+void TestMigration::backfillsTitleKeys()
+{
+    QSqlQuery query(QSqlDatabase::database());
+    QVERIFY(query.exec("SELECT title, title_key FROM tasks"));
+    int rows = 0;
+    while (query.next()) {
+        QCOMPARE(query.value(1).toString(),
+                 QString::fromUtf8(TaskSorter::titleSortKey(query.value(0).toString())));
+        ++rows;
+    }
+    QCOMPARE(rows, V1_TASKS.size());
+}
+
+void TestMigration::acceptsNewTasks()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    Task task(QStringLiteral("Added after the upgrade"));
+    task.setTags({QStringLiteral("report")});
+    QVERIFY(database->insertTask(task));
+
+    const Task stored = database->getTask(task.id());
+    QCOMPARE(stored.title(), task.title());
+    QCOMPARE(stored.tags(), task.tags());
+    QCOMPARE(database->getAllTasks().size(), V1_TASKS.size() + 1);
+}
+
+QTEST_GUILESS_MAIN(TestMigration)
+#include "tst_migration.moc"
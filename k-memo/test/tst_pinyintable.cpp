@@ -0,0 +1,148 @@
+#include <QtTest>
+#include "models/pinyintable.h"
+
+namespace {
+QString syllableAt(const PinyinTable::Spelling& spelling, int index)
+{
+    const int end = index + 1 < spelling.starts.size() ? spelling.starts.at(index + 1) : spelling.pinyin.size();
+    return spelling.pinyin.mid(spelling.starts.at(index), end - spelling.starts.at(index));
+}
+}
+
+class TestPinyinTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void mainReading();
+    void otherReadings();
+    void spellsTitles_data();
+    void spellsTitles();
+    void refusesTextWithoutIdeographs();
+    void spellsEveryCombination();
+    void capsSpellings();
+};
+
+void TestPinyinTable::initTestCase()
+{
+    QVERIFY(PinyinTable::instance()->isLoaded());
+}
+
+void TestPinyinTable::mainReading()
+{
+    const PinyinTable* table = PinyinTable::instance();
+    QCOMPARE(table->syllable(QChar(0x9879)), QStringLiteral("xiang"));    // 项
+    QCOMPARE(table->syllable(QChar(0x7EFF)), QStringLiteral("lv"));       // 绿
+    QVERIFY(table->syllable(QLatin1Char('a')).isEmpty());
+    QVERIFY(table->syllable(QChar(0x3002)).isEmpty());                    // 。
+}
+
+void TestPinyinTable::otherReadings()
+{
+    const PinyinTable* table = PinyinTable::instance();
+
+    const QStringList chang = table->syllables(QChar(0x957F));            // 长
+    QCOMPARE(chang.first(), table->syllable(QChar(0x957F)));
+    QVERIFY(chang.contains(QStringLiteral("zhang")));
+    QVERIFY(chang.contains(QStringLiteral("chang")));
+
+    const QStringList xing = table->syllables(QChar(0x884C));             // 行
+    QVERIFY(xing.contains(QStringLiteral("xing")));
+    QVERIFY(xing.contains(QStringLiteral("hang")));
+
+    const QStringList zhong = table->syllables(QChar(0x91CD));            // 重
+    QVERIFY(zhong.contains(QStringLiteral("zhong")));
+    QVERIFY(zhong.contains(QStringLiteral("chong")));
+
+    QCOMPARE(table->syllables(QChar(0x9879)).size(), 1);                  // 项
+    QVERIFY(table->syllables(QLatin1Char('a')).isEmpty());
+}
+
+void TestPinyinTable::spellsTitles_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("pinyin");
+    QTest::addColumn<QString>("initials");
+    QTest::addColumn<QVector<int>>("starts");
+
+    QTest::newRow("ideographs") << QStringLiteral("项目周报") << QStringLiteral("xiangmuzhoubao")
+                                << QStringLiteral("xmzb") << QVector<int>{0, 5, 7, 11};
+    QTest::newRow("mixed") << QStringLiteral("q3 项目") << QStringLiteral("q3xiangmu")
+                           << QStringLiteral("qxm") << QVector<int>{0, 2, 7};
+    QTest::newRow("punctuation") << QStringLiteral("周报。") << QStringLiteral("zhoubao")
+                                 << QStringLiteral("zb") << QVector<int>{0, 4};
+}
+
+void TestPinyinTable::spellsTitles()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, pinyin);
+    QFETCH(QString, initials);
+    QFETCH(QVector<int>, starts);
+
+    PinyinTable::Spelling spelling;
+    QVERIFY(PinyinTable::instance()->spell(text, &spelling));
+    QCOMPARE(spelling.pinyin, pinyin);
+    QCOMPARE(spelling.initials, initials);
+    QCOMPARE(spelling.starts, starts);
+
+    const QVector<PinyinTable::Spelling> spellings = PinyinTable::instance()->spellings(text, 4);
+    QCOMPARE(spellings.size(), 1);
+    QCOMPARE(spellings.first().pinyin, pinyin);
+}
+
+void TestPinyinTable::refusesTextWithoutIdeographs()
+{
+    PinyinTable::Spelling spelling;
+    QVERIFY(!PinyinTable::instance()->spell(QStringLiteral("weekly report"), &spelling));
+    QVERIFY(spelling.pinyin.isEmpty());
+    QVERIFY(spelling.starts.isEmpty());
+    QVERIFY(PinyinTable::instance()->spellings(QStringLiteral("weekly report"), 4).isEmpty());
+}
+
+void TestPinyinTable::spellsEveryCombination()
+{
+    // 长行: (zhang | chang) (xing | hang)
+    const QVector<PinyinTable::Spelling> spellings =
+        PinyinTable::instance()->spellings(QStringLiteral("长行"), 8);
+
+    PinyinTable::Spelling main;
+    QVERIFY(PinyinTable::instance()->spell(QStringLiteral("长行"), &main));
+    QCOMPARE(spellings.first().pinyin, main.pinyin);
+
+    QStringList pinyin;
+    for (const PinyinTable::Spelling& spelling : spellings) {
+        pinyin.append(spelling.pinyin);
+        QCOMPARE(spelling.starts.size(), 2);
+        QCOMPARE(spelling.initials.size(), 2);
+    }
+    QCOMPARE(pinyin.size(), 4);
+    QVERIFY(pinyin.contains(QStringLiteral("zhangxing")));
+    QVERIFY(pinyin.contains(QStringLiteral("changxing")));
+    QVERIFY(pinyin.contains(QStringLiteral("zhanghang")));
+    QVERIFY(pinyin.contains(QStringLiteral("changhang")));
+}
+
+void TestPinyinTable::capsSpellings()
+{
+    // Four polyphonic characters are at least 16 combinations; past the cap
+    // each other reading is tried on its own
+    const QString text = QStringLiteral("长行重长");
+    const QVector<PinyinTable::Spelling> spellings = PinyinTable::instance()->spellings(text, 4);
+    QCOMPARE(spellings.size(), 4);
+
+    PinyinTable::Spelling main;
+    QVERIFY(PinyinTable::instance()->spell(text, &main));
+    QCOMPARE(spellings.first().pinyin, main.pinyin);
+    for (int i = 1; i < spellings.size(); ++i) {
+        int changed = 0;
+        for (int s = 0; s < main.starts.size(); ++s) {
+            changed += syllableAt(spellings.at(i), s) != syllableAt(main, s);
+        }
+        QCOMPARE(changed, 1);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestPinyinTable)
+#include "tst_pinyintable.moc"
@@ -0,0 +1,165 @@
+#include <QtTest>
+#include "models/recurrencerule.h"
+
+namespace {
+QDateTime at(int year, int month, int day, int hour = 9)
+{
+    return QDateTime(QDate(year, month, day), QTime(hour, 0));
+}
+}
+
+class TestRecurrenceRule : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrips_data();
+    void roundTrips();
+    void rejects_data();
+    void rejects();
+    void daily();
+    void weeklyOnSelectedDays();
+    void weeklyOnAnchorDay();
+    void monthlySkipsShortMonths();
+    void stopsAtUntil();
+    void jumpsToDistantWindow();
+    void capsOccurrences();
+    void noRecurrence();
+};
+
+void TestRecurrenceRule::roundTrips_data()
+{
+    QTest::addColumn<QString>("rule");
+
+    QTest::newRow("daily") << QStringLiteral("FREQ=DAILY");
+    QTest::newRow("interval") << QStringLiteral("FREQ=DAILY;INTERVAL=3");
+    QTest::newRow("weekly") << QStringLiteral("FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH");
+    QTest::newRow("monthly until") << QStringLiteral("FREQ=MONTHLY;UNTIL=20261231");
+}
+
+void TestRecurrenceRule::roundTrips()
+{
+    QFETCH(QString, rule);
+
+    const RecurrenceRule parsed = RecurrenceRule::fromString(rule);
+    QVERIFY(parsed.isValid());
+    QCOMPARE(parsed.toString(), rule);
+    QVERIFY(RecurrenceRule::fromString(parsed.toString()) == parsed);
+}
+
+void TestRecurrenceRule::rejects_data()
+{
+    QTest::addColumn<QString>("rule");
+
+    QTest::newRow("empty") << QString();
+    QTest::newRow("yearly") << QStringLiteral("FREQ=YEARLY");
+    QTest::newRow("no frequency") << QStringLiteral("INTERVAL=2");
+    QTest::newRow("zero interval") << QStringLiteral("FREQ=DAILY;INTERVAL=0");
+    QTest::newRow("unknown day") << QStringLiteral("FREQ=WEEKLY;BYDAY=XX");
+    QTest::newRow("days when daily") << QStringLiteral("FREQ=DAILY;BYDAY=MO");
+    QTest::newRow("unsupported part") << QStringLiteral("FREQ=DAILY;COUNT=3");
+    QTest::newRow("bad until") << QStringLiteral("FREQ=DAILY;UNTIL=tomorrow");
+    QTest::newRow("garbage") << QStringLiteral("garbage");
+}
+
+void TestRecurrenceRule::rejects()
+{
+    QFETCH(QString, rule);
+
+    QVERIFY(!RecurrenceRule::fromString(rule).isValid());
+}
+
+void TestRecurrenceRule::daily()
+{
+    const RecurrenceRule rule(RecurrenceRule::Daily, 3);
+    const QDateTime anchor = at(2026, 1, 1);
+
+    QCOMPARE(rule.nextOccurrence(anchor, anchor.addSecs(-1)), anchor);
+    QCOMPARE(rule.nextOccurrence(anchor, anchor), at(2026, 1, 4));
+    QCOMPARE(rule.nextOccurrence(anchor, at(2026, 3, 1, 12)), at(2026, 3, 2));
+
+    // Before the anchor, the series starts at the anchor
+    QCOMPARE(rule.nextOccurrence(anchor, at(2025, 6, 1)), anchor);
+}
+
+void TestRecurrenceRule::weeklyOnSelectedDays()
+{
+    // Every other week on Monday and Thursday, from Monday 5 January 2026
+    RecurrenceRule rule(RecurrenceRule::Weekly, 2);
+    rule.setWeekday(Qt::Monday);
+    rule.setWeekday(Qt::Thursday);
+    const QDateTime anchor = at(2026, 1, 5);
+
+    const QVector<QDateTime> expected = {
+        at(2026, 1, 5), at(2026, 1, 8), at(2026, 1, 19), at(2026, 1, 22)
+    };
+    QCOMPARE(rule.occurrencesBetween(anchor, at(2026, 1, 5, 0), at(2026, 2, 2, 0)), expected);
+    QCOMPARE(rule.nextOccurrence(anchor, at(2026, 1, 8)), at(2026, 1, 19));
+}
+
+void TestRecurrenceRule::weeklyOnAnchorDay()
+{
+    const RecurrenceRule rule(RecurrenceRule::Weekly);
+    const QDateTime anchor = at(2026, 1, 7);    // Wednesday
+
+    QCOMPARE(rule.nextOccurrence(anchor, anchor), at(2026, 1, 14));
+    QCOMPARE(rule.nextOccurrence(anchor, at(2026, 1, 15)), at(2026, 1, 21));
+}
+
+void TestRecurrenceRule::monthlySkipsShortMonths()
+{
+    const RecurrenceRule rule(RecurrenceRule::Monthly);
+    const QDateTime anchor = at(2026, 1, 31);
+
+    const QVector<QDateTime> expected = {
+        at(2026, 1, 31), at(2026, 3, 31), at(2026, 5, 31), at(2026, 7, 31)
+    };
+    QCOMPARE(rule.occurrencesBetween(anchor, at(2026, 1, 1), at(2026, 8, 1)), expected);
+    QCOMPARE(rule.nextOccurrence(anchor, anchor), at(2026, 3, 31));
+
+    // The 29th of February only comes round in leap years
+    const RecurrenceRule yearly(RecurrenceRule::Monthly, 12);
+    QCOMPARE(yearly.nextOccurrence(at(2024, 2, 29), at(2024, 2, 29)), at(2028, 2, 29));
+}
+
+void TestRecurrenceRule::stopsAtUntil()
+{
+    RecurrenceRule rule(RecurrenceRule::Daily);
+    rule.setUntil(QDate(2026, 1, 3));
+    const QDateTime anchor = at(2026, 1, 1);
+
+    const QVector<QDateTime> expected = {at(2026, 1, 1), at(2026, 1, 2), at(2026, 1, 3)};
+    QCOMPARE(rule.occurrencesBetween(anchor, at(2026, 1, 1, 0), at(2026, 2, 1, 0)), expected);
+    QVERIFY(!rule.nextOccurrence(anchor, at(2026, 1, 3)).isValid());
+}
+
+void TestRecurrenceRule::jumpsToDistantWindow()
+{
+    const RecurrenceRule rule(RecurrenceRule::Daily, 2);
+    const QDateTime anchor = at(2000, 1, 1);
+
+    // 9497 days after the anchor is odd, so the window starts a day later
+    const QVector<QDateTime> expected = {at(2026, 1, 2), at(2026, 1, 4)};
+    QCOMPARE(rule.occurrencesBetween(anchor, at(2026, 1, 1, 0), at(2026, 1, 5, 0)), expected);
+}
+
+void TestRecurrenceRule::capsOccurrences()
+{
+    const RecurrenceRule rule(RecurrenceRule::Daily);
+    const QDateTime anchor = at(2026, 1, 1);
+
+    QCOMPARE(rule.occurrencesBetween(anchor, anchor, at(2027, 1, 1), 10).size(), 10);
+    QVERIFY(rule.occurrencesBetween(anchor, at(2026, 2, 1), at(2026, 1, 1)).isEmpty());
+}
+
+void TestRecurrenceRule::noRecurrence()
+{
+    const RecurrenceRule rule;
+    QVERIFY(!rule.isValid());
+    QVERIFY(rule.toString().isEmpty());
+    QVERIFY(!rule.nextOccurrence(at(2026, 1, 1), at(2026, 1, 1)).isValid());
+    QVERIFY(rule.occurrencesBetween(at(2026, 1, 1), at(2026, 1, 1), at(2027, 1, 1)).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestRecurrenceRule)
+#include "tst_recurrencerule.moc"
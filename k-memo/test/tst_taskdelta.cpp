@@ -0,0 +1,222 @@
+#include <QtTest>
+#include "models/taskdelta.h"
+
+class TestTaskDelta : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void spliceBetween();
+    void spliceAppliesAndReverts();
+    void spliceRefusesOtherText();
+    void spliceMerges_data();
+    void spliceMerges();
+    void deltaRecordsChangedFields();
+    void deltaAppliesAndReverts();
+    void deltaRefusesOtherTitle();
+    void deltaMergesTyping();
+    void deltaMergeDropsRestoredFields();
+    void deltaMergeRefusesOtherFields();
+};
+
+void TestTaskDelta::spliceBetween()
+{
+    const TextSplice splice = TextSplice::between(QStringLiteral("hello world"),
+                                                  QStringLiteral("hello brave world"));
+    QCOMPARE(splice.prefix, 6);
+    QCOMPARE(splice.suffix, 5);
+    QCOMPARE(splice.removed, QString());
+    QCOMPARE(splice.inserted, QStringLiteral("brave "));
+
+    QVERIFY(TextSplice::between(QStringLiteral("same"), QStringLiteral("same")).isEmpty());
+}
+
+void TestTaskDelta::spliceAppliesAndReverts()
+{
+    const QString before = QStringLiteral("Buy milk and bread");
+    const QString after = QStringLiteral("Buy oat milk and rye bread");
+    const TextSplice splice = TextSplice::between(before, after);
+
+    QString text;
+    QVERIFY(splice.apply(before, &text));
+    QCOMPARE(text, after);
+    QVERIFY(splice.revert(after, &text));
+    QCOMPARE(text, before);
+}
+
+void TestTaskDelta::spliceRefusesOtherText()
+{
+    const TextSplice splice = TextSplice::between(QStringLiteral("abc"), QStringLiteral("abXc"));
+
+    QString text = QStringLiteral("untouched");
+    QVERIFY(!splice.apply(QStringLiteral("abd"), &text));
+    QVERIFY(!splice.apply(QStringLiteral("abcd"), &text));
+    QVERIFY(!splice.revert(QStringLiteral("abYc"), &text));
+    QCOMPARE(text, QStringLiteral("untouched"));
+}
+
+void TestTaskDelta::spliceMerges_data()
+{
+    QTest::addColumn<QString>("first");
+    QTest::addColumn<QString>("second");
+    QTest::addColumn<QString>("third");
+    QTest::addColumn<bool>("mergeable");
+
+    QTest::newRow("typing") << QStringLiteral("abc") << QStringLiteral("abcd") << QStringLiteral("abcde") << true;
+    QTest::newRow("typing inside") << QStringLiteral("Call  today") << QStringLiteral("Call B today")
+                                   << QStringLiteral("Call Bo today") << true;
+    QTest::newRow("backspace") << QStringLiteral("abcde") << QStringLiteral("abcd") << QStringLiteral("abc") << true;
+    QTest::newRow("delete forward") << QStringLiteral("abcde") << QStringLiteral("acde") << QStringLiteral("ade") << true;
+    QTest::newRow("overlapping") << QStringLiteral("hello world") << QStringLiteral("hello there world")
+                                 << QStringLiteral("hello their world") << true;
+    QTest::newRow("undone") << QStringLiteral("abc") << QStringLiteral("abXc") << QStringLiteral("abc") << true;
+    QTest::newRow("far apart") << QStringLiteral("hello world") << QStringLiteral("Xhello world")
+                               << QStringLiteral("Xhello worldY") << false;
+}
+
+void TestTaskDelta::spliceMerges()
+{
+    QFETCH(QString, first);
+    QFETCH(QString, second);
+    QFETCH(QString, third);
+    QFETCH(bool, mergeable);
+
+    TextSplice splice = TextSplice::between(first, second);
+    const TextSplice unmerged = splice;
+    QCOMPARE(splice.mergeWith(TextSplice::between(second, third)), mergeable);
+
+    QString text;
+    if (!mergeable) {
+        // Left as it was
+        QVERIFY(splice.apply(first, &text));
+        QCOMPARE(text, second);
+        QCOMPARE(splice.prefix, unmerged.prefix);
+        return;
+    }
+
+    QVERIFY(splice.apply(first, &text));
+    QCOMPARE(text, third);
+    QVERIFY(splice.revert(third, &text));
+    QCOMPARE(text, first);
+    QCOMPARE(splice.isEmpty(), first == third);
+}
+
+void TestTaskDelta::deltaRecordsChangedFields()
+{
+    const Task before(QStringLiteral("Buy milk"), QStringLiteral("From the corner shop"));
+    Task after = before;
+    QVERIFY(TaskDelta::between(before, after).isEmpty());
+
+    after.setTitle(QStringLiteral("Buy oat milk"));
+    after.setPriority(TaskPriority::High);
+    after.setTags({QStringLiteral("errands")});
+
+    const TaskDelta delta = TaskDelta::between(before, after);
+    QVERIFY(!delta.isEmpty());
+    QCOMPARE(delta.fields(), Task::TitleField | Task::PriorityField | Task::TagsField);
+}
+
+void TestTaskDelta::deltaAppliesAndReverts()
+{
+    Task before(QStringLiteral("Buy milk"), QStringLiteral("From the corner shop"));
+    before.setPriority(TaskPriority::Normal);
+    Task after = before;
+    after.setTitle(QStringLiteral("Buy oat milk"));
+    after.setDescription(QStringLiteral("From the market"));
+    after.setStatus(TaskStatus::Completed);
+    after.setDueTimeMsecs(QDateTime(QDate(2026, 3, 1), QTime(9, 0)).toMSecsSinceEpoch());
+    after.setRecurrence(RecurrenceRule(RecurrenceRule::Weekly));
+    const TaskDelta delta = TaskDelta::between(before, after);
+
+    Task task = before;
+    task.markClean();
+    QVERIFY(delta.apply(&task));
+    QCOMPARE(task.dirtyFields(), delta.fields());
+    QCOMPARE(task.title(), after.title());
+    QCOMPARE(task.description(), after.description());
+    QCOMPARE(task.status(), after.status());
+    QCOMPARE(task.dueTime(), after.dueTime());
+    QCOMPARE(task.recurrence(), after.recurrence());
+    QCOMPARE(task.priority(), before.priority());
+
+    task.markClean();
+    QVERIFY(delta.revert(&task));
+    QCOMPARE(task.dirtyFields(), delta.fields());
+    QCOMPARE(task.title(), before.title());
+    QCOMPARE(task.description(), before.description());
+    QCOMPARE(task.status(), before.status());
+    QCOMPARE(task.dueTime(), before.dueTime());
+    QCOMPARE(task.recurrence(), before.recurrence());
+}
+
+void TestTaskDelta::deltaRefusesOtherTitle()
+{
+    const Task before(QStringLiteral("Buy milk"));
+    Task after = before;
+    after.setTitle(QStringLiteral("Buy oat milk"));
+    after.setPriority(TaskPriority::Urgent);
+    const TaskDelta delta = TaskDelta::between(before, after);
+
+    // Nothing is set when the title doesn't fit
+    Task other(QStringLiteral("Walk the dog"));
+    other.setPriority(TaskPriority::Low);
+    other.markClean();
+    QVERIFY(!delta.apply(&other));
+    QVERIFY(!other.isDirty());
+    QCOMPARE(other.title(), QStringLiteral("Walk the dog"));
+    QCOMPARE(other.priority(), TaskPriority::Low);
+}
+
+void TestTaskDelta::deltaMergesTyping()
+{
+    const Task first(QStringLiteral("Call"));
+    Task second = first;
+    second.setTitle(QStringLiteral("Call B"));
+    Task third = second;
+    third.setTitle(QStringLiteral("Call Bob"));
+
+    TaskDelta delta = TaskDelta::between(first, second);
+    QVERIFY(delta.mergeWith(TaskDelta::between(second, third)));
+    QCOMPARE(delta.fields(), Task::Fields(Task::TitleField));
+
+    Task task = first;
+    QVERIFY(delta.apply(&task));
+    QCOMPARE(task.title(), QStringLiteral("Call Bob"));
+    QVERIFY(delta.revert(&task));
+    QCOMPARE(task.title(), QStringLiteral("Call"));
+}
+
+void TestTaskDelta::deltaMergeDropsRestoredFields()
+{
+    Task first(QStringLiteral("Report"));
+    first.setPriority(TaskPriority::Normal);
+    Task second = first;
+    second.setPriority(TaskPriority::High);
+    Task third = second;
+    third.setPriority(TaskPriority::Normal);
+
+    TaskDelta delta = TaskDelta::between(first, second);
+    QVERIFY(delta.mergeWith(TaskDelta::between(second, third)));
+    QVERIFY(delta.isEmpty());
+}
+
+void TestTaskDelta::deltaMergeRefusesOtherFields()
+{
+    const Task first(QStringLiteral("Report"));
+    Task second = first;
+    second.setTitle(QStringLiteral("Weekly report"));
+    Task third = second;
+    third.setStatus(TaskStatus::Completed);
+
+    TaskDelta delta = TaskDelta::between(first, second);
+    QVERIFY(!delta.mergeWith(TaskDelta::between(second, third)));
+    QCOMPARE(delta.fields(), Task::Fields(Task::TitleField));
+
+    Task task = first;
+    QVERIFY(delta.apply(&task));
+    QCOMPARE(task.title(), QStringLiteral("Weekly report"));
+    QCOMPARE(task.status(), first.status());
+}
+
+QTEST_GUILESS_MAIN(TestTaskDelta)
+#include "tst_taskdelta.moc"
@@ -0,0 +1,211 @@
+#include <QtTest>
+#include <QAbstractItemModelTester>
+#include "models/taskfilterproxymodel.h"
+#include "models/taskmodel.h"
+#include "testdatabase.h"
+
+class TestTaskFilterProxyModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void tightensAndLoosens();
+    void resetsForManyRuns();
+    void signalsFewRuns();
+    void followsSourceChanges();
+
+private:
+    void checkMapping() const;
+    Task addTask(const QString& title, const QString& category);
+
+    TaskModel* m_model = nullptr;
+    TaskFilterProxyModel* m_proxy = nullptr;
+    QAbstractItemModelTester* m_tester = nullptr;     // Checks every signal the proxy sends
+
+    static constexpr int TASK_COUNT = 200;
+};
+
+void TestTaskFilterProxyModel::initTestCase()
+{
+    QVERIFY(TestDatabase::initialize());
+
+    // Sorted by title, "Task 0", "Task 1", "Task 10", ... interleaves the
+    // categories, so a category filter shows and hides many short runs
+    const QStringList categories = {
+        QStringLiteral("Work"), QStringLiteral("Home"), QStringLiteral("Errands")
+    };
+    QVector<Task> tasks;
+    for (int i = 0; i < TASK_COUNT; ++i) {
+        Task task(QStringLiteral("Task %1").arg(i));
+        task.setCategory(categories.at(i % categories.size()));
+        task.setStatus(static_cast<TaskStatus>(i % 4));
+        task.setPriority(i % 67 == 0 ? TaskPriority::Urgent : static_cast<TaskPriority>(1 + i % 3));
+        tasks.append(task);
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks));
+
+    m_model = new TaskModel(this);
+    QCOMPARE(m_model->rowCount(), TASK_COUNT);
+    m_proxy = new TaskFilterProxyModel(m_model, this);
+    m_tester = new QAbstractItemModelTester(m_proxy, QAbstractItemModelTester::FailureReportingMode::QtTest);
+}
+
+void TestTaskFilterProxyModel::cleanupTestCase()
+{
+    delete m_tester;
+    m_tester = nullptr;
+    delete m_proxy;
+    m_proxy = nullptr;
+    delete m_model;
+    m_model = nullptr;
+}
+
+void TestTaskFilterProxyModel::init()
+{
+    m_proxy->clearFilter();
+}
+
+// The visible rows are exactly the source rows the filter accepts, in
+// source order, both ways round
+void TestTaskFilterProxyModel::checkMapping() const
+{
+    const TaskFilter filter = m_proxy->filter();
+    QVector<int> expected;
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        if (filter.matches(m_model->getTask(row))) {
+            expected.append(row);
+        }
+    }
+
+    QCOMPARE(m_proxy->rowCount(), expected.size());
+    for (int row = 0; row < expected.size(); ++row) {
+        QCOMPARE(m_proxy->mapToSource(m_proxy->index(row, 0)).row(), expected.at(row));
+    }
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        QCOMPARE(m_proxy->mapFromSource(m_model->index(row)).row(), expected.indexOf(row));
+    }
+}
+
+Task TestTaskFilterProxyModel::addTask(const QString& title, const QString& category)
+{
+    Task task(title);
+    task.setCategory(category);
+    if (!DatabaseManager::instance()->insertTask(task)) {
+        return Task();
+    }
+    return task;
+}
+
+void TestTaskFilterProxyModel::tightensAndLoosens()
+{
+    checkMapping();
+    QCOMPARE(m_proxy->rowCount(), m_model->rowCount());
+
+    m_proxy->setCategoryFilter(QStringLiteral("Work"));
+    checkMapping();
+    m_proxy->setStatusFilter(TaskStatus::Pending);
+    checkMapping();
+    QVERIFY(m_proxy->rowCount() > 0);
+
+    m_proxy->setStatusFilter(TaskStatus::Completed);
+    checkMapping();
+    m_proxy->setCategoryFilter(QString());
+    checkMapping();
+
+    m_proxy->clearFilter();
+    checkMapping();
+    QCOMPARE(m_proxy->rowCount(), m_model->rowCount());
+}
+
+void TestTaskFilterProxyModel::resetsForManyRuns()
+{
+    QSignalSpy reset(m_proxy, &QAbstractItemModel::modelReset);
+    QSignalSpy removed(m_proxy, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy inserted(m_proxy, &QAbstractItemModel::rowsInserted);
+
+    m_proxy->setCategoryFilter(QStringLiteral("Work"));
+    checkMapping();
+    QCOMPARE(reset.count(), 1);
+    QCOMPARE(removed.count(), 0);
+
+    m_proxy->clearFilter();
+    checkMapping();
+    QCOMPARE(reset.count(), 2);
+    QCOMPARE(inserted.count(), 0);
+}
+
+void TestTaskFilterProxyModel::signalsFewRuns()
+{
+    QSignalSpy reset(m_proxy, &QAbstractItemModel::modelReset);
+    QSignalSpy removed(m_proxy, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy inserted(m_proxy, &QAbstractItemModel::rowsInserted);
+
+    // Three urgent tasks, none next to another
+    TaskFilter filter;
+    filter.priorities = TaskFilter::ALL_PRIORITIES & ~TaskFilter::priorityBit(TaskPriority::Urgent);
+    m_proxy->setFilter(filter);
+    checkMapping();
+    QCOMPARE(m_proxy->rowCount(), m_model->rowCount() - 3);
+    QCOMPARE(removed.count(), 3);
+
+    m_proxy->clearFilter();
+    checkMapping();
+    QCOMPARE(inserted.count(), 3);
+    QCOMPARE(reset.count(), 0);
+}
+
+void TestTaskFilterProxyModel::followsSourceChanges()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    m_proxy->setCategoryFilter(QStringLiteral("Work"));
+    checkMapping();
+
+    const Task shown = addTask(QStringLiteral("Task 55 shown"), QStringLiteral("Work"));
+    QVERIFY(shown.isValid());
+    checkMapping();
+    QVERIFY(m_proxy->mapFromSource(m_model->index(m_model->findTaskRow(shown.id()))).isValid());
+
+    const Task hidden = addTask(QStringLiteral("Task 56 hidden"), QStringLiteral("Home"));
+    QVERIFY(hidden.isValid());
+    checkMapping();
+
+    // Hidden by an edit, shown by an edit that also moves it to the top
+    Task task = database->getTask(shown.id());
+    task.setCategory(QStringLiteral("Home"));
+    QVERIFY(database->updateTask(task));
+    checkMapping();
+
+    task = database->getTask(hidden.id());
+    task.setCategory(QStringLiteral("Work"));
+    task.setTitle(QStringLiteral("A task first"));
+    QVERIFY(database->updateTask(task));
+    checkMapping();
+    QCOMPARE(m_proxy->mapToSource(m_proxy->index(0, 0)).row(), m_model->findTaskRow(hidden.id()));
+
+    // A visible row moves down
+    task = database->getTask(hidden.id());
+    task.setTitle(QStringLiteral("Task 99z"));
+    QVERIFY(database->updateTask(task));
+    checkMapping();
+
+    QVERIFY(database->deleteTask(hidden.id()));
+    checkMapping();
+    QVERIFY(database->deleteTask(shown.id()));
+    checkMapping();
+
+    // A batch lands at once
+    QVector<Task> tasks;
+    for (int i = 0; i < 10; ++i) {
+        Task batched(QStringLiteral("Task %1 batched").arg(i * 20));
+        batched.setCategory(i % 2 ? QStringLiteral("Work") : QStringLiteral("Errands"));
+        tasks.append(batched);
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks));
+    checkMapping();
+}
+
+QTEST_GUILESS_MAIN(TestTaskFilterProxyModel)
+#include "tst_taskfilterproxymodel.moc"
@@ -0,0 +1,136 @@
+#include <QtTest>
+#include "models/tasksearchindex.h"
+#include "testdatabase.h"
+
+class TestTaskSearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void finds_data();
+    void finds();
+    void ranksTitleStartFirst();
+    void tracksEdits();
+
+private:
+    bool found(const QString& query, const QString& title) const;
+
+    TaskSearchIndex* m_index = nullptr;
+    QHash<QString, TaskId> m_ids;       // By title
+};
+
+void TestTaskSearchIndex::initTestCase()
+{
+    QVERIFY(TestDatabase::initialize());
+
+    const QStringList titles = {
+        QStringLiteral("项目周报"),
+        QStringLiteral("去银行开户"),
+        QStringLiteral("长江游船"),
+        QStringLiteral("重新安装系统"),
+        QStringLiteral("Q3 项目预算"),
+        QStringLiteral("Review the project plan"),
+        QStringLiteral("Call the bank")
+    };
+    QVector<Task> tasks;
+    for (const QString& title : titles) {
+        Task task(title);
+        m_ids.insert(title, task.id());
+        tasks.append(task);
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks));
+
+    m_index = new TaskSearchIndex(this);
+    QCOMPARE(m_index->size(), titles.size());
+}
+
+void TestTaskSearchIndex::cleanupTestCase()
+{
+    delete m_index;
+    m_index = nullptr;
+}
+
+bool TestTaskSearchIndex::found(const QString& query, const QString& title) const
+{
+    const TaskId taskId = m_ids.value(title);
+    for (const TaskSearchIndex::Hit& hit : m_index->search(query)) {
+        if (hit.taskId == taskId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TestTaskSearchIndex::finds_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("title");
+    QTest::addColumn<bool>("expected");
+
+    // Text
+    QTest::newRow("substring") << QStringLiteral("proj") << QStringLiteral("Review the project plan") << true;
+    QTest::newRow("case folded") << QStringLiteral("REVIEW") << QStringLiteral("Review the project plan") << true;
+    QTest::newRow("typo") << QStringLiteral("projetc plan") << QStringLiteral("Review the project plan") << true;
+    QTest::newRow("too far off") << QStringLiteral("prxxxx") << QStringLiteral("Review the project plan") << false;
+    QTest::newRow("one letter") << QStringLiteral("k") << QStringLiteral("Call the bank") << true;
+    QTest::newRow("two letters") << QStringLiteral("nk") << QStringLiteral("Call the bank") << true;
+    QTest::newRow("two letters absent") << QStringLiteral("kx") << QStringLiteral("Call the bank") << false;
+    QTest::newRow("last ideograph") << QStringLiteral("报") << QStringLiteral("项目周报") << true;
+    QTest::newRow("ideographs") << QStringLiteral("周报") << QStringLiteral("项目周报") << true;
+
+    // Pinyin prefixes
+    QTest::newRow("pinyin") << QStringLiteral("xiangmu") << QStringLiteral("项目周报") << true;
+    QTest::newRow("pinyin inside") << QStringLiteral("zhoubao") << QStringLiteral("项目周报") << true;
+    QTest::newRow("pinyin partial") << QStringLiteral("xiangmuzh") << QStringLiteral("项目周报") << true;
+    QTest::newRow("pinyin spaced") << QStringLiteral("xiang mu") << QStringLiteral("项目周报") << true;
+    QTest::newRow("initials") << QStringLiteral("xmzb") << QStringLiteral("项目周报") << true;
+    QTest::newRow("mixed title") << QStringLiteral("xmys") << QStringLiteral("Q3 项目预算") << true;
+    QTest::newRow("wrong pinyin") << QStringLiteral("zhoubo") << QStringLiteral("项目周报") << false;
+
+    // Other readings of polyphonic characters
+    QTest::newRow("yinhang") << QStringLiteral("yinhang") << QStringLiteral("去银行开户") << true;
+    QTest::newRow("yh") << QStringLiteral("yh") << QStringLiteral("去银行开户") << true;
+    QTest::newRow("changjiang") << QStringLiteral("changjiang") << QStringLiteral("长江游船") << true;
+    QTest::newRow("zhangjiang") << QStringLiteral("zhangjiang") << QStringLiteral("长江游船") << true;
+    QTest::newRow("chongxin") << QStringLiteral("chongxin") << QStringLiteral("重新安装系统") << true;
+    QTest::newRow("cxaz") << QStringLiteral("cxaz") << QStringLiteral("重新安装系统") << true;
+    QTest::newRow("other reading inside") << QStringLiteral("hangkai") << QStringLiteral("去银行开户") << true;
+}
+
+void TestTaskSearchIndex::finds()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, title);
+    QFETCH(bool, expected);
+
+    QCOMPARE(found(query, title), expected);
+}
+
+void TestTaskSearchIndex::ranksTitleStartFirst()
+{
+    // "xm" starts 项目周报 and is inside Q3 项目预算
+    const QVector<TaskSearchIndex::Hit> hits = m_index->search(QStringLiteral("xm"));
+    QVERIFY(hits.size() >= 2);
+    QCOMPARE(hits.first().taskId, m_ids.value(QStringLiteral("项目周报")));
+}
+
+void TestTaskSearchIndex::tracksEdits()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    Task task = database->getTask(m_ids.value(QStringLiteral("Call the bank")));
+    task.setTitle(QStringLiteral("行程安排"));
+    QVERIFY(database->updateTask(task));
+
+    QVERIFY(!found(QStringLiteral("bank"), QStringLiteral("Call the bank")));
+    QVERIFY(found(QStringLiteral("xingcheng"), QStringLiteral("Call the bank")));
+    QVERIFY(found(QStringLiteral("hangcheng"), QStringLiteral("Call the bank")));
+
+    QVERIFY(database->deleteTask(task.id()));
+    QVERIFY(!found(QStringLiteral("xingcheng"), QStringLiteral("Call the bank")));
+    QCOMPARE(m_index->size(), m_ids.size() - 1);
+}
+
+QTEST_GUILESS_MAIN(TestTaskSearchIndex)
+#include "tst_tasksearchindex.moc"
@@ -0,0 +1,190 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QCborStreamWriter>
+#include "models/taskserializer.h"
+
+class TestTaskSerializer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTripsEveryField();
+    void roundTripsUnsetTimes();
+    void keepsDescriptionCompressed();
+    void roundTripsThroughDevice();
+    void readsStreamWithoutRecurrence();
+    void skipsTrailingFields();
+    void rejectsNewerVersion();
+    void rejectsTruncatedStream();
+
+private:
+    static Task sampleTask();
+    static QByteArray streamWithFields(const Task& task, int fieldCount);
+};
+
+Task TestTaskSerializer::sampleTask()
+{
+    Task task(QStringLiteral("写周报 weekly report"), QStringLiteral("Summary for the team"));
+    task.setCreateTimeMsecs(1700000000123);
+    task.setDueTimeMsecs(1700086400456);
+    task.setPriority(TaskPriority::High);
+    task.setStatus(TaskStatus::InProgress);
+    task.setCategory(QStringLiteral("Work"));
+    task.setTags({QStringLiteral("report"), QStringLiteral("周报")});
+    task.setReminderEnabled(true);
+    task.setReminderMinutes(45);
+    task.setRecurrence(RecurrenceRule::fromString(QStringLiteral("FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH")));
+    return task;
+}
+
+// A stream holding one task with only its first fieldCount fields, or with
+// made-up extra ones after them
+QByteArray TestTaskSerializer::streamWithFields(const Task& task, int fieldCount)
+{
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writer.startArray(2);
+    writer.append(TaskSerializer::FORMAT_VERSION);
+    writer.startArray(1);
+    writer.startArray(fieldCount);
+
+    writer.append(task.id().toRfc4122());
+    writer.append(task.title());
+    writer.append(task.description());
+    writer.append(task.createTimeMsecs());
+    writer.append(task.dueTimeMsecs());
+    writer.append(static_cast<quint64>(task.priority()));
+    writer.append(static_cast<quint64>(task.status()));
+    writer.append(task.category());
+    writer.startArray(0);
+    writer.endArray();
+    writer.append(task.reminderEnabled());
+    writer.append(static_cast<qint64>(task.reminderMinutes()));
+    for (int field = 11; field < fieldCount; ++field) {
+        writer.append(field == 11 ? task.recurrence().toString() : QStringLiteral("future"));
+    }
+
+    writer.endArray();
+    writer.endArray();
+    writer.endArray();
+    return data;
+}
+
+void TestTaskSerializer::roundTripsEveryField()
+{
+    const Task task = sampleTask();
+
+    Task copy;
+    QVERIFY(TaskSerializer::deserialize(TaskSerializer::serialize(task), &copy));
+    QCOMPARE(copy.id(), task.id());
+    QCOMPARE(copy.title(), task.title());
+    QCOMPARE(copy.description(), task.description());
+    QCOMPARE(copy.createTimeMsecs(), task.createTimeMsecs());
+    QCOMPARE(copy.dueTimeMsecs(), task.dueTimeMsecs());
+    QCOMPARE(copy.priority(), task.priority());
+    QCOMPARE(copy.status(), task.status());
+    QCOMPARE(copy.category(), task.category());
+    QCOMPARE(copy.tags(), task.tags());
+    QCOMPARE(copy.reminderEnabled(), task.reminderEnabled());
+    QCOMPARE(copy.reminderMinutes(), task.reminderMinutes());
+    QVERIFY(copy.recurrence() == task.recurrence());
+}
+
+void TestTaskSerializer::roundTripsUnsetTimes()
+{
+    Task task(QStringLiteral("No dates"));
+    task.setCreateTimeMsecs(Task::NO_TIME);
+    task.setDueTimeMsecs(Task::NO_TIME);
+
+    Task copy;
+    QVERIFY(TaskSerializer::deserialize(TaskSerializer::serialize(task), &copy));
+    QCOMPARE(copy.createTimeMsecs(), Task::NO_TIME);
+    QCOMPARE(copy.dueTimeMsecs(), Task::NO_TIME);
+    QVERIFY(!copy.hasDueTime());
+    QVERIFY(!copy.isRecurring());
+}
+
+void TestTaskSerializer::keepsDescriptionCompressed()
+{
+    const QString description = QStringLiteral("Long enough to be worth compressing. ").repeated(200);
+    Task task(QStringLiteral("Compressed"));
+    task.setCompressedDescription(compressDescription(description));
+
+    Task copy;
+    QVERIFY(TaskSerializer::deserialize(TaskSerializer::serialize(task), &copy));
+    QVERIFY(copy.hasCompressedDescription());
+    QCOMPARE(copy.compressedDescription(), task.compressedDescription());
+    QCOMPARE(copy.description(), description);
+}
+
+void TestTaskSerializer::roundTripsThroughDevice()
+{
+    QVector<Task> tasks;
+    for (int i = 0; i < 1000; ++i) {
+        Task task(QStringLiteral("Task %1").arg(i));
+        task.setPriority(static_cast<TaskPriority>(1 + i % 4));
+        tasks.append(task);
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    QVERIFY(TaskSerializer::write(&buffer, tasks));
+    buffer.seek(0);
+
+    QVector<Task> copies;
+    QVERIFY(TaskSerializer::read(&buffer, &copies));
+    QCOMPARE(copies.size(), tasks.size());
+    for (int i = 0; i < tasks.size(); ++i) {
+        QCOMPARE(copies.at(i).id(), tasks.at(i).id());
+        QCOMPARE(copies.at(i).title(), tasks.at(i).title());
+        QCOMPARE(copies.at(i).priority(), tasks.at(i).priority());
+    }
+}
+
+void TestTaskSerializer::readsStreamWithoutRecurrence()
+{
+    const Task task = sampleTask();
+
+    Task copy;
+    QVERIFY(TaskSerializer::deserialize(streamWithFields(task, 11), &copy));
+    QCOMPARE(copy.id(), task.id());
+    QCOMPARE(copy.reminderMinutes(), task.reminderMinutes());
+    QVERIFY(!copy.isRecurring());
+}
+
+void TestTaskSerializer::skipsTrailingFields()
+{
+    const Task task = sampleTask();
+
+    Task copy;
+    QVERIFY(TaskSerializer::deserialize(streamWithFields(task, 14), &copy));
+    QCOMPARE(copy.id(), task.id());
+    QVERIFY(copy.recurrence() == task.recurrence());
+}
+
+void TestTaskSerializer::rejectsNewerVersion()
+{
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writer.startArray(2);
+    writer.append(TaskSerializer::FORMAT_VERSION + 1);
+    writer.startArray(0);
+    writer.endArray();
+    writer.endArray();
+
+    QVector<Task> tasks;
+    QVERIFY(!TaskSerializer::deserialize(data, &tasks));
+}
+
+void TestTaskSerializer::rejectsTruncatedStream()
+{
+    QByteArray data = TaskSerializer::serialize(QVector<Task>{sampleTask(), sampleTask()});
+    data.chop(10);
+
+    QVector<Task> tasks;
+    QVERIFY(!TaskSerializer::deserialize(data, &tasks));
+    QVERIFY(tasks.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestTaskSerializer)
+#include "tst_taskserializer.moc"
@@ -0,0 +1,287 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include "models/tasksorter.h"
+#include "models/taskmodel.h"
+#include "testdatabase.h"
+
+Q_DECLARE_METATYPE(TaskSorter::Column)
+
+namespace {
+const qint64 START_MSECS = QDateTime(QDate(2026, 1, 1), QTime(0, 0)).toMSecsSinceEpoch();
+const qint64 MINUTE_MSECS = 60000;
+
+// Few distinct values per column, so most comparisons go down to the
+// later columns and the id
+QVector<Task> generateTasks(int count, quint32 seed)
+{
+    const QStringList titles = {
+        QStringLiteral("apple"), QStringLiteral("Apple"), QStringLiteral("Äpfel"),
+        QStringLiteral("banana"), QStringLiteral("项目周报"), QStringLiteral("西安"),
+        QStringLiteral("先"), QStringLiteral("zebra"), QStringLiteral("Q3 预算"), QStringLiteral("apple pie")
+    };
+    // Lower case sorts first when collated but last byte by byte
+    const QStringList categories = {
+        QStringLiteral("Work"), QStringLiteral("Home"), QStringLiteral("errands")
+    };
+
+    QRandomGenerator random(seed);
+    QVector<Task> tasks;
+    tasks.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Task task(titles.at(random.bounded(titles.size())));
+        task.setCreateTimeMsecs(START_MSECS + random.bounded(100) * MINUTE_MSECS);
+        if (random.bounded(2)) {
+            task.setDueTimeMsecs(task.createTimeMsecs() + random.bounded(100) * MINUTE_MSECS);
+        }
+        task.setPriority(static_cast<TaskPriority>(1 + random.bounded(4)));
+        task.setStatus(static_cast<TaskStatus>(random.bounded(4)));
+        task.setCategory(categories.at(random.bounded(categories.size())));
+        tasks.append(task);
+    }
+    return tasks;
+}
+
+QStringList idsOf(const QVector<Task>& tasks)
+{
+    QStringList ids;
+    for (const Task& task : tasks) {
+        ids.append(task.id().toString());
+    }
+    return ids;
+}
+
+QStringList idsOf(const TaskModel& model)
+{
+    QStringList ids;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        ids.append(model.getTask(row).id().toString());
+    }
+    return ids;
+}
+}
+
+class TestTaskSorter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void titleKeys();
+    void sortAgreesWithCompare_data();
+    void sortAgreesWithCompare();
+    void insertionAgreesWithLoad_data();
+    void insertionAgreesWithLoad();
+    void sqlPageAgreesWithSort_data();
+    void sqlPageAgreesWithSort();
+    void sqlPageFollowsChanges();
+
+private:
+    void addColumnRows();
+    bool passPushdownThreshold();
+};
+
+void TestTaskSorter::initTestCase()
+{
+    QVERIFY(TestDatabase::initialize());
+}
+
+void TestTaskSorter::titleKeys()
+{
+    QCOMPARE(TaskSorter::titleSortKey(QStringLiteral("apple")), TaskSorter::titleSortKey(QStringLiteral("APPLE")));
+    QVERIFY(TaskSorter::titleSortKey(QStringLiteral("Äpfel")) < TaskSorter::titleSortKey(QStringLiteral("banana")));
+
+    // Chinese by pinyin, among Latin titles
+    QVERIFY(TaskSorter::titleSortKey(QStringLiteral("北京")) < TaskSorter::titleSortKey(QStringLiteral("上海")));
+    QVERIFY(TaskSorter::titleSortKey(QStringLiteral("work")) < TaskSorter::titleSortKey(QStringLiteral("项目")));
+    QVERIFY(TaskSorter::titleSortKey(QStringLiteral("项目")) < TaskSorter::titleSortKey(QStringLiteral("zebra")));
+
+    // xi an before xian
+    QVERIFY(TaskSorter::titleSortKey(QStringLiteral("西安")) < TaskSorter::titleSortKey(QStringLiteral("先")));
+}
+
+void TestTaskSorter::addColumnRows()
+{
+    QTest::addColumn<QVector<TaskSorter::Column>>("columns");
+
+    QTest::newRow("title") << QVector<TaskSorter::Column>{{TaskSorter::Title, Qt::AscendingOrder}};
+    QTest::newRow("title descending") << QVector<TaskSorter::Column>{{TaskSorter::Title, Qt::DescendingOrder}};
+    QTest::newRow("priority, due, title")
+        << QVector<TaskSorter::Column>{{TaskSorter::Priority, Qt::AscendingOrder},
+                                       {TaskSorter::DueTime, Qt::AscendingOrder},
+                                       {TaskSorter::Title, Qt::DescendingOrder}};
+    QTest::newRow("status, category, created")
+        << QVector<TaskSorter::Column>{{TaskSorter::Status, Qt::DescendingOrder},
+                                       {TaskSorter::Category, Qt::AscendingOrder},
+                                       {TaskSorter::CreateTime, Qt::AscendingOrder}};
+    QTest::newRow("due descending") << QVector<TaskSorter::Column>{{TaskSorter::DueTime, Qt::DescendingOrder}};
+}
+
+void TestTaskSorter::sortAgreesWithCompare_data()
+{
+    addColumnRows();
+}
+
+// The bulk sort, serial and parallel, gives the order compare() defines
+void TestTaskSorter::sortAgreesWithCompare()
+{
+    QFETCH(QVector<TaskSorter::Column>, columns);
+
+    TaskSorter sorter;
+    sorter.setColumns(columns);
+
+    for (int count : {500, TaskSorter::PARALLEL_THRESHOLD + 1000}) {
+        const QVector<Task> tasks = generateTasks(count, 42);
+        QVector<Task> sorted = tasks;
+        sorter.sort(&sorted);
+
+        QCOMPARE(sorted.size(), tasks.size());
+        for (int i = 1; i < sorted.size(); ++i) {
+            QVERIFY2(sorter.compare(sorted.at(i - 1), sorted.at(i)) < 0,
+                     qPrintable(QStringLiteral("rows %1 and %2 of %3").arg(i - 1).arg(i).arg(count)));
+        }
+
+        QStringList before = idsOf(tasks);
+        QStringList after = idsOf(sorted);
+        before.sort();
+        after.sort();
+        QCOMPARE(after, before);
+    }
+}
+
+void TestTaskSorter::insertionAgreesWithLoad_data()
+{
+    addColumnRows();
+}
+
+// Rows placed one at a time (inserts, edits) end up where a fresh load
+// puts them
+void TestTaskSorter::insertionAgreesWithLoad()
+{
+    QFETCH(QVector<TaskSorter::Column>, columns);
+
+    DatabaseManager* database = DatabaseManager::instance();
+    TaskModel model;
+    model.setSortColumns(columns);
+
+    const QVector<Task> tasks = generateTasks(300, qHash(QByteArray(QTest::currentDataTag())));
+    for (int i = 0; i < 200; ++i) {
+        QVERIFY(database->insertTask(tasks.at(i)));
+    }
+    QVERIFY(TestDatabase::insertTasks(tasks.mid(200)));
+
+    for (int i = 0; i < tasks.size(); i += 7) {
+        Task task = database->getTask(tasks.at(i).id());
+        task.setTitle(tasks.at((i * 3) % tasks.size()).title());
+        task.setPriority(tasks.at((i * 5) % tasks.size()).priority());
+        task.setDueTimeMsecs(task.createTimeMsecs() + i * MINUTE_MSECS);
+        QVERIFY(database->updateTask(task));
+    }
+    for (int i = 3; i < tasks.size(); i += 11) {
+        QVERIFY(database->deleteTask(tasks.at(i).id()));
+    }
+
+    TaskModel loaded;
+    loaded.setSortColumns(columns);
+    QCOMPARE(model.rowCount(), loaded.rowCount());
+    QCOMPARE(idsOf(model), idsOf(loaded));
+}
+
+void TestTaskSorter::sqlPageAgreesWithSort_data()
+{
+    QTest::addColumn<QVector<TaskSorter::Column>>("columns");
+
+    QTest::newRow("title") << QVector<TaskSorter::Column>{{TaskSorter::Title, Qt::AscendingOrder}};
+    QTest::newRow("title descending") << QVector<TaskSorter::Column>{{TaskSorter::Title, Qt::DescendingOrder}};
+    QTest::newRow("due descending") << QVector<TaskSorter::Column>{{TaskSorter::DueTime, Qt::DescendingOrder}};
+    QTest::newRow("priority, status, title")
+        << QVector<TaskSorter::Column>{{TaskSorter::Priority, Qt::AscendingOrder},
+                                       {TaskSorter::Status, Qt::DescendingOrder},
+                                       {TaskSorter::Title, Qt::AscendingOrder}};
+    QTest::newRow("category, title")
+        << QVector<TaskSorter::Column>{{TaskSorter::Category, Qt::AscendingOrder},
+                                       {TaskSorter::Title, Qt::AscendingOrder}};
+}
+
+// Past the pushdown threshold SQLite picks the page by the stored columns
+// (title_key for titles); it is the head of the order the sorter gives
+void TestTaskSorter::sqlPageAgreesWithSort()
+{
+    QFETCH(QVector<TaskSorter::Column>, columns);
+
+    DatabaseManager* database = DatabaseManager::instance();
+    QVERIFY(passPushdownThreshold());
+
+    TaskModel model;
+    model.setSortColumns(columns);
+    QVERIFY(model.isSqlBacked());
+    QCOMPARE(model.rowCount(), int(TaskModel::SQL_PAGE_SIZE));
+
+    TaskSorter sorter;
+    sorter.setColumns(columns);
+    QVector<Task> all = database->getAllTasks();
+    sorter.sort(&all);
+    QCOMPARE(idsOf(model), idsOf(all.mid(0, TaskModel::SQL_PAGE_SIZE)));
+}
+
+bool TestTaskSorter::passPushdownThreshold()
+{
+    const int stored = DatabaseManager::instance()->getAllTasks().size();
+    return stored > TaskModel::SQL_PUSHDOWN_THRESHOLD
+        || TestDatabase::insertTasks(generateTasks(TaskModel::SQL_PUSHDOWN_THRESHOLD + 1 - stored, 7));
+}
+
+// Rows that leave a full page, deleted or edited past its end, are made up
+// from SQL, so the page stays what a fresh load selects
+void TestTaskSorter::sqlPageFollowsChanges()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    QVERIFY(passPushdownThreshold());
+
+    TaskModel model;
+    QVERIFY(model.isSqlBacked());
+    const QString last = QStringLiteral("zzz");
+
+    QVERIFY(database->deleteTask(model.getTask(0).id()));
+    QVERIFY(database->deleteTask(model.getTask(10).id()));
+    QCOMPARE(model.rowCount(), int(TaskModel::SQL_PAGE_SIZE));
+    QCOMPARE(idsOf(model), idsOf(TaskModel()));
+
+    // Moved to the end of the page, and edited while already there
+    Task task = database->getTask(model.getTask(5).id());
+    task.setTitle(last);
+    QVERIFY(database->updateTask(task));
+    QCOMPARE(idsOf(model), idsOf(TaskModel()));
+    task = database->getTask(model.getTask(model.rowCount() - 1).id());
+    task.setTitle(last);
+    QVERIFY(database->updateTask(task));
+    QCOMPARE(idsOf(model), idsOf(TaskModel()));
+
+    // A row from past the page, edited into it
+    QVector<Task> all = database->getAllTasks();
+    TaskSorter sorter;
+    sorter.sort(&all);
+    task = all.at(TaskModel::SQL_PAGE_SIZE + 100);
+    task.setTitle(QStringLiteral("aaa"));
+    QVERIFY(database->updateTask(task));
+    QCOMPARE(idsOf(model), idsOf(TaskModel()));
+
+    // The same in one batch
+    {
+        TaskChangeBatch batch(database);
+        QVERIFY(database->beginTransaction());
+        for (int row : {0, 1, 50}) {
+            QVERIFY(database->deleteTask(model.getTask(row).id()));
+        }
+        for (int row : {20, 30, int(TaskModel::SQL_PAGE_SIZE) - 1}) {
+            task = database->getTask(model.getTask(row).id());
+            task.setTitle(last);
+            QVERIFY(database->updateTask(task));
+        }
+        QVERIFY(database->commitTransaction());
+    }
+    QCOMPARE(model.rowCount(), int(TaskModel::SQL_PAGE_SIZE));
+    QCOMPARE(idsOf(model), idsOf(TaskModel()));
+}
+
+QTEST_GUILESS_MAIN(TestTaskSorter)
+#include "tst_tasksorter.moc"
@@ -0,0 +1,334 @@
+#include <QtTest>
+#include <QAbstractItemModelTester>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include "models/tasktreemodel.h"
+#include "testdatabase.h"
+
+class TestTaskTreeModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void loadsLazily();
+    void keepsClosureRows();
+    void movesSubtrees_data();
+    void movesSubtrees();
+    void refusesCycles();
+    void updatesOverdue();
+
+private:
+    Task addTask(const QString& title, const Task& parent = Task());
+    bool move(const Task& task, const Task& parent);
+    bool expand(const Task& task);
+    int descendantCount(const TaskId& taskId) const;
+    void checkTree(const QModelIndex& parent = QModelIndex()) const;
+    void checkClosure() const;
+
+    TaskTreeModel* m_model = nullptr;
+    // Fetches every node it can whenever it runs, so only the tests that
+    // don't look at lazy loading attach it
+    QAbstractItemModelTester* m_tester = nullptr;
+    QHash<TaskId, TaskId> m_parents;    // Every task, to its parent (null for roots)
+};
+
+void TestTaskTreeModel::initTestCase()
+{
+    QVERIFY(TestDatabase::initialize());
+}
+
+void TestTaskTreeModel::init()
+{
+    m_model = new TaskTreeModel(this);
+}
+
+void TestTaskTreeModel::cleanup()
+{
+    delete m_tester;
+    m_tester = nullptr;
+    delete m_model;
+    m_model = nullptr;
+}
+
+// Inserted as a root, then moved, as the app does it
+Task TestTaskTreeModel::addTask(const QString& title, const Task& parent)
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    const Task task(title);
+    if (!database->insertTask(task)
+        || (parent.isValid() && !database->setTaskParent(task.id(), parent.id()))) {
+        return Task();
+    }
+    m_parents.insert(task.id(), parent.id());
+    return task;
+}
+
+bool TestTaskTreeModel::move(const Task& task, const Task& parent)
+{
+    if (!m_model->moveTask(task.id(), parent.id())) {
+        return false;
+    }
+    m_parents[task.id()] = parent.id();
+    return true;
+}
+
+bool TestTaskTreeModel::expand(const Task& task)
+{
+    const QModelIndex index = m_model->indexForTask(task.id());
+    if (!index.isValid()) {
+        return false;
+    }
+    if (m_model->canFetchMore(index)) {
+        m_model->fetchMore(index);
+    }
+    return !m_model->canFetchMore(index);
+}
+
+int TestTaskTreeModel::descendantCount(const TaskId& taskId) const
+{
+    int count = 0;
+    for (auto it = m_parents.constBegin(); it != m_parents.constEnd(); ++it) {
+        for (TaskId above = it.value(); !above.isNull(); above = m_parents.value(above)) {
+            if (above == taskId) {
+                ++count;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+// Loaded rows are exactly the children the hierarchy gives, with counts and
+// progress to match; unexpanded rows have a count and nothing loaded
+void TestTaskTreeModel::checkTree(const QModelIndex& parent) const
+{
+    const TaskId parentId = m_model->getTask(parent).id();
+    QSet<TaskId> children;
+    for (auto it = m_parents.constBegin(); it != m_parents.constEnd(); ++it) {
+        if (it.value() == parentId) {
+            children.insert(it.key());
+        }
+    }
+
+    if (parent.isValid()) {
+        QCOMPARE(m_model->data(parent, TaskTreeModel::ChildCountRole).toInt(), children.size());
+        QCOMPARE(m_model->hasChildren(parent), !children.isEmpty());
+        QCOMPARE(m_model->data(parent, TaskTreeModel::SubtreeTotalRole).toInt(), descendantCount(parentId));
+        if (m_model->canFetchMore(parent)) {
+            QCOMPARE(m_model->rowCount(parent), 0);
+            for (const TaskId& child : qAsConst(children)) {
+                QVERIFY(!m_model->indexForTask(child).isValid());
+            }
+            return;
+        }
+    }
+
+    QSet<TaskId> rows;
+    for (int row = 0; row < m_model->rowCount(parent); ++row) {
+        const QModelIndex index = m_model->index(row, 0, parent);
+        QCOMPARE(index.parent(), parent);
+        QCOMPARE(m_model->indexForTask(m_model->getTask(index).id()), index);
+        rows.insert(m_model->getTask(index).id());
+        checkTree(index);
+    }
+    QCOMPARE(rows, children);
+}
+
+// One row per task and ancestor, itself included, at its distance
+void TestTaskTreeModel::checkClosure() const
+{
+    QSet<QString> expected;
+    for (auto it = m_parents.constBegin(); it != m_parents.constEnd(); ++it) {
+        int depth = 0;
+        for (TaskId above = it.key(); !above.isNull(); above = m_parents.value(above)) {
+            expected.insert(QStringLiteral("%1 %2 %3").arg(above.toString(), it.key().toString()).arg(depth++));
+        }
+    }
+
+    QSet<QString> stored;
+    QSqlQuery query(QSqlDatabase::database());
+    QVERIFY(query.exec("SELECT ancestor, descendant, depth FROM task_closure"));
+    while (query.next()) {
+        stored.insert(QStringLiteral("%1 %2 %3")
+                          .arg(TaskId::fromRfc4122(query.value(0).toByteArray()).toString(),
+                               TaskId::fromRfc4122(query.value(1).toByteArray()).toString())
+                          .arg(query.value(2).toInt()));
+    }
+    QCOMPARE(stored, expected);
+}
+
+// Expanding a node loads its children and their counts, nothing deeper
+void TestTaskTreeModel::loadsLazily()
+{
+    const Task house = addTask(QStringLiteral("Renovate"));
+    const Task kitchen = addTask(QStringLiteral("Kitchen"), house);
+    const Task bathroom = addTask(QStringLiteral("Bathroom"), house);
+    const Task tiles = addTask(QStringLiteral("Tiles"), kitchen);
+    const Task grout = addTask(QStringLiteral("Grout"), tiles);
+    QVERIFY(grout.isValid());
+    QVERIFY(bathroom.isValid());
+
+    m_model->refresh();
+    const QModelIndex houseIndex = m_model->indexForTask(house.id());
+    QVERIFY(houseIndex.isValid());
+    QVERIFY(m_model->canFetchMore(houseIndex));
+    QCOMPARE(m_model->rowCount(houseIndex), 0);
+    QCOMPARE(m_model->data(houseIndex, TaskTreeModel::ChildCountRole).toInt(), 2);
+    checkTree();
+
+    QSignalSpy inserted(m_model, &QAbstractItemModel::rowsInserted);
+    m_model->fetchMore(houseIndex);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(m_model->rowCount(houseIndex), 2);
+    QVERIFY(!m_model->canFetchMore(houseIndex));
+
+    const QModelIndex kitchenIndex = m_model->indexForTask(kitchen.id());
+    QVERIFY(kitchenIndex.isValid());
+    QVERIFY(m_model->canFetchMore(kitchenIndex));
+    QVERIFY(!m_model->canFetchMore(m_model->indexForTask(bathroom.id())));
+    QVERIFY(!m_model->indexForTask(tiles.id()).isValid());
+    checkTree();
+
+    QVERIFY(expand(kitchen));
+    QVERIFY(!m_model->indexForTask(grout.id()).isValid());
+    checkTree();
+}
+
+void TestTaskTreeModel::keepsClosureRows()
+{
+    // A chain four deep, and a second branch
+    const Task root = addTask(QStringLiteral("Chain"));
+    Task above = root;
+    QVector<Task> chain{root};
+    for (int i = 1; i < 4; ++i) {
+        above = addTask(QStringLiteral("Link %1").arg(i), above);
+        QVERIFY(above.isValid());
+        chain.append(above);
+    }
+    const Task branch = addTask(QStringLiteral("Branch"));
+    const Task leaf = addTask(QStringLiteral("Branch leaf"), branch);
+    QVERIFY(leaf.isValid());
+    checkClosure();
+
+    // The lower half of the chain moves as one, under a leaf and back up
+    QVERIFY(move(chain.at(2), leaf));
+    checkClosure();
+    QVERIFY(move(chain.at(2), Task()));
+    checkClosure();
+    QVERIFY(move(branch, chain.at(3)));
+    checkClosure();
+}
+
+void TestTaskTreeModel::movesSubtrees_data()
+{
+    QTest::addColumn<bool>("tester");
+
+    QTest::newRow("lazy") << false;
+    QTest::newRow("tester") << true;
+}
+
+// Every path through onTaskMoved: loaded or not, into an expanded parent or
+// a collapsed one, with the counts and progress of both ends kept up
+void TestTaskTreeModel::movesSubtrees()
+{
+    QFETCH(bool, tester);
+
+    const Task a = addTask(QStringLiteral("Project A"));
+    const Task a1 = addTask(QStringLiteral("A1"), a);
+    const Task a1x = addTask(QStringLiteral("A1x"), a1);
+    const Task a2 = addTask(QStringLiteral("A2"), a);
+    const Task b = addTask(QStringLiteral("Project B"));
+    const Task b1 = addTask(QStringLiteral("B1"), b);
+    const Task b1x = addTask(QStringLiteral("B1x"), b1);
+    const Task b1xa = addTask(QStringLiteral("B1xa"), b1x);
+    const Task b1xa1 = addTask(QStringLiteral("B1xa1"), b1xa);
+    QVERIFY(a1x.isValid() && a2.isValid() && b1xa1.isValid());
+
+    m_model->refresh();
+    if (tester) {
+        m_tester = new QAbstractItemModelTester(m_model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    }
+    QVERIFY(expand(a));
+    QVERIFY(expand(a1));
+    QVERIFY(expand(b));
+    checkTree();
+
+    // Loaded, into a collapsed parent
+    QVERIFY(move(a1, b1));
+    checkTree();
+
+    // Loaded, between expanded parents; its loaded children go along
+    QVERIFY(expand(b1));
+    QVERIFY(expand(a1));
+    QSignalSpy moved(m_model, &QAbstractItemModel::rowsMoved);
+    QVERIFY(move(a1, a));
+    QCOMPARE(moved.count(), 1);
+    QVERIFY(m_model->indexForTask(a1x.id()).isValid());
+    checkTree();
+
+    // Up to the root
+    QVERIFY(move(a1, Task()));
+    QCOMPARE(m_model->indexForTask(a1.id()).parent(), QModelIndex());
+    checkTree();
+
+    // Not loaded, out of a collapsed parent into an expanded one, and back
+    QVERIFY(move(b1xa, a));
+    checkTree();
+    QVERIFY(move(b1xa, b1x));
+    checkTree();
+
+    // Out of a parent that isn't loaded either, and into one: the loaded
+    // ancestors above it (B1x, B1, B) still count the subtree
+    QVERIFY(move(b1xa1, Task()));
+    checkTree();
+    QVERIFY(move(b1xa1, b1xa));
+    checkTree();
+
+    // Collapsed, with its children unloaded
+    QVERIFY(move(b1x, Task()));
+    checkTree();
+    checkClosure();
+}
+
+void TestTaskTreeModel::refusesCycles()
+{
+    m_tester = new QAbstractItemModelTester(m_model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    const Task top = addTask(QStringLiteral("Top"));
+    const Task middle = addTask(QStringLiteral("Middle"), top);
+    const Task bottom = addTask(QStringLiteral("Bottom"), middle);
+    QVERIFY(bottom.isValid());
+
+    QVERIFY(!move(top, bottom));
+    QVERIFY(!move(top, middle));
+    QVERIFY(!move(middle, middle));
+    checkTree();
+    checkClosure();
+}
+
+// IsOverdueRole turns without a refresh once the due time passes
+void TestTaskTreeModel::updatesOverdue()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    const Task parent = addTask(QStringLiteral("Errands"));
+    Task task(QStringLiteral("Post the letter"));
+    task.setDueTimeMsecs(TaskClock::currentMSecsSinceEpoch() + 2000);
+    QVERIFY(database->insertTask(task));
+    QVERIFY(database->setTaskParent(task.id(), parent.id()));
+    m_parents.insert(task.id(), parent.id());
+    QVERIFY(expand(parent));
+
+    const QModelIndex index = m_model->indexForTask(task.id());
+    QVERIFY(index.isValid());
+    QVERIFY(!m_model->data(index, TaskModel::IsOverdueRole).toBool());
+
+    QSignalSpy changed(m_model, &QAbstractItemModel::dataChanged);
+    QTRY_VERIFY(m_model->data(index, TaskModel::IsOverdueRole).toBool());
+    QVERIFY(!changed.isEmpty());
+    QCOMPARE(changed.last().at(0).value<QModelIndex>(), index);
+}
+
+QTEST_GUILESS_MAIN(TestTaskTreeModel)
+#include "tst_tasktreemodel.moc"
@@ -0,0 +1,145 @@
+#include <QtTest>
+#include <QBuffer>
+#include "database/attachmentstore.h"
+#include "managers/undomanager.h"
+#include "testdatabase.h"
+
+namespace {
+QByteArray pattern(int size)
+{
+    QByteArray bytes(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) {
+        bytes[i] = char(i * 31 + i / 251);
+    }
+    return bytes;
+}
+
+qint64 addAttachment(const TaskId& taskId, const QString& fileName, const QByteArray& content)
+{
+    QByteArray data = content;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    return DatabaseManager::instance()->attachmentStore()->addAttachment(
+        taskId, fileName, QStringLiteral("application/octet-stream"), &buffer);
+}
+
+QByteArray readAttachment(qint64 attachmentId)
+{
+    QByteArray content;
+    QBuffer buffer(&content);
+    buffer.open(QIODevice::WriteOnly);
+    if (!DatabaseManager::instance()->attachmentStore()->readAttachment(attachmentId, &buffer)) {
+        return QByteArray();
+    }
+    return content;
+}
+}
+
+class TestUndoManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void deleteRestoresSubtree();
+    void deleteRestoresAttachments();
+
+private:
+    void checkAttachments(const TaskId& taskId, const QList<TaskAttachment>& expected,
+                          const QVector<QByteArray>& contents);
+};
+
+void TestUndoManager::initTestCase()
+{
+    QVERIFY(TestDatabase::initialize());
+}
+
+void TestUndoManager::checkAttachments(const TaskId& taskId, const QList<TaskAttachment>& expected,
+                                       const QVector<QByteArray>& contents)
+{
+    const QList<TaskAttachment> attachments =
+        DatabaseManager::instance()->attachmentStore()->attachmentsForTask(taskId);
+    QCOMPARE(attachments.size(), expected.size());
+    for (int i = 0; i < attachments.size(); ++i) {
+        QCOMPARE(attachments.at(i).id, expected.at(i).id);
+        QCOMPARE(attachments.at(i).taskId, expected.at(i).taskId);
+        QCOMPARE(attachments.at(i).fileName, expected.at(i).fileName);
+        QCOMPARE(attachments.at(i).mimeType, expected.at(i).mimeType);
+        QCOMPARE(attachments.at(i).size, expected.at(i).size);
+        QCOMPARE(attachments.at(i).createTime, expected.at(i).createTime);
+        QCOMPARE(readAttachment(attachments.at(i).id), contents.at(i));
+    }
+}
+
+void TestUndoManager::deleteRestoresSubtree()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    UndoManager undo;
+
+    const Task parent(QStringLiteral("Plan the move"));
+    const Task child(QStringLiteral("Book the van"));
+    const Task other(QStringLiteral("Pack the books"));
+    QVERIFY(database->insertTask(parent));
+    QVERIFY(database->insertTask(child));
+    QVERIFY(database->insertTask(other));
+    QVERIFY(database->setTaskParent(child.id(), parent.id()));
+    QVERIFY(database->addTaskDependency(other.id(), child.id()));
+
+    QVERIFY(undo.removeTask(parent.id()));
+    QVERIFY(database->getTask(parent.id()).id().isNull());
+    QVERIFY(database->getTask(child.id()).id().isNull());
+
+    QVERIFY(undo.undo());
+    QCOMPARE(database->getTask(child.id()).title(), child.title());
+    QCOMPARE(database->getParentTask(child.id()), parent.id());
+    QVERIFY(database->getAllTaskDependencies().contains(qMakePair(other.id(), child.id())));
+
+    QVERIFY(undo.redo());
+    QVERIFY(database->getTask(child.id()).id().isNull());
+    QVERIFY(undo.undo());
+    QCOMPARE(database->getParentTask(child.id()), parent.id());
+}
+
+void TestUndoManager::deleteRestoresAttachments()
+{
+    DatabaseManager* database = DatabaseManager::instance();
+    AttachmentStore* store = database->attachmentStore();
+    UndoManager undo;
+
+    const Task parent(QStringLiteral("Tax return"));
+    const Task child(QStringLiteral("Receipts"));
+    QVERIFY(database->insertTask(parent));
+    QVERIFY(database->insertTask(child));
+    QVERIFY(database->setTaskParent(child.id(), parent.id()));
+
+    // Larger than a blob I/O chunk, and an empty one
+    const QVector<QByteArray> parentContents = {pattern(200 * 1024), QByteArray()};
+    const QVector<QByteArray> childContents = {QByteArrayLiteral("receipt")};
+    QVERIFY(addAttachment(parent.id(), QStringLiteral("return.pdf"), parentContents.at(0)) >= 0);
+    QVERIFY(addAttachment(parent.id(), QStringLiteral("notes.txt"), parentContents.at(1)) >= 0);
+    QVERIFY(addAttachment(child.id(), QStringLiteral("receipt.txt"), childContents.at(0)) >= 0);
+    const QList<TaskAttachment> parentAttachments = store->attachmentsForTask(parent.id());
+    const QList<TaskAttachment> childAttachments = store->attachmentsForTask(child.id());
+
+    QVERIFY(undo.removeTask(parent.id()));
+    QCOMPARE(store->attachmentCount(parent.id()), 0);
+    QCOMPARE(store->attachmentCount(child.id()), 0);
+    QVERIFY(readAttachment(parentAttachments.at(0).id).isEmpty());
+
+    QVERIFY(undo.undo());
+    checkAttachments(parent.id(), parentAttachments, parentContents);
+    checkAttachments(child.id(), childAttachments, childContents);
+
+    QVERIFY(undo.redo());
+    QCOMPARE(store->attachmentCount(parent.id()), 0);
+    QVERIFY(undo.undo());
+    checkAttachments(parent.id(), parentAttachments, parentContents);
+    checkAttachments(child.id(), childAttachments, childContents);
+
+    // New attachments don't take the restored ids
+    const qint64 added = addAttachment(parent.id(), QStringLiteral("later.txt"), QByteArrayLiteral("later"));
+    QVERIFY(added > childAttachments.at(0).id);
+}
+
+QTEST_GUILESS_MAIN(TestUndoManager)
+#include "tst_undomanager.moc"
@@ -6,10 +6,13 @@
 #include <QLabel>
 #include <QFrame>
 #include <QString>
+#include "../../managers/undomanager.h"
 
 SimpleTaskListWidget::SimpleTaskListWidget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::SimpleTaskListWidget)
+    , m_completedCount(0)
+    , m_undoManager(nullptr)
     , m_statusFilter(-1)
     , m_priorityFilter(-1)
 {
@@ -32,8 +35,8 @@ SimpleTaskListWidget::~SimpleTaskListWidget()
 void SimpleTaskListWidget::setTasks(const QList<Task> &tasks)
 {
     clearTasks();
-    m_tasks = tasks;
 
+    // addTask 负责加入 m_tasks 并计数
     for (const Task &task : tasks) {
         addTask(task);
     }
@@ -53,10 +56,13 @@ void SimpleTaskListWidget::addTask(const Task &task)
 
     // 添加到任务列表
     m_tasks.append(task);
+    if (task.status() == TaskStatus::Completed) {
+        m_completedCount++;
+    }
 
     // 创建列表项
     QListWidgetItem *item = new QListWidgetItem(ui->taskListWidget);
-    item->setData(Qt::UserRole, task.id());
+    item->setData(Qt::UserRole, QVariant::fromValue(task.id()));
 
     // 创建任务Widget
     QWidget *taskWidget = createTaskItemWidget(task);
@@ -77,7 +83,7 @@ void SimpleTaskListWidget::addTask(const Task &task)
     emit taskCountChanged(getTaskCount(), getCompletedCount());
 }
 
-void SimpleTaskListWidget::removeTask(const QString &taskId)
+void SimpleTaskListWidget::removeTask(const TaskId &taskId)
 {
     // 从映射中移除
     if (m_itemMap.contains(taskId)) {
@@ -89,6 +95,9 @@ void SimpleTaskListWidget::removeTask(const QString &taskId)
     // 从任务列表中移除
     for (auto it = m_tasks.begin(); it != m_tasks.end(); ++it) {
         if (it->id() == taskId) {
+            if (it->status() == TaskStatus::Completed) {
+                m_completedCount--;
+            }
             m_tasks.erase(it);
             break;
         }
@@ -106,6 +115,8 @@ void SimpleTaskListWidget::updateTask(const Task &task)
     // 更新任务列表中的数据
     for (auto &existingTask : m_tasks) {
         if (existingTask.id() == task.id()) {
+            m_completedCount += (task.status() == TaskStatus::Completed)
+                              - (existingTask.status() == TaskStatus::Completed);
             existingTask = task;
             break;
         }
@@ -131,6 +142,7 @@ void SimpleTaskListWidget::clearTasks()
     ui->taskListWidget->clear();
     m_itemMap.clear();
     m_tasks.clear();
+    m_completedCount = 0;
 
     updateCountDisplay();
     updateEmptyState();
@@ -145,13 +157,7 @@ int SimpleTaskListWidget::getTaskCount() const
 
 int SimpleTaskListWidget::getCompletedCount() const
 {
-    int count = 0;
-    for (const Task &task : m_tasks) {
-        if (task.status() == TaskStatus::Completed) {
-            count++;
-        }
-    }
-    return count;
+    return m_completedCount;
 }
 
 void SimpleTaskListWidget::refreshList()
@@ -184,16 +190,39 @@ void SimpleTaskListWidget::onTaskCheckStateChanged()
     QCheckBox *checkBox = qobject_cast<QCheckBox*>(sender());
     if (!checkBox) return;
 
-    QString taskId = checkBox->property("taskId").toString();
+    TaskId taskId = checkBox->property("taskId").value<TaskId>();
     bool completed = checkBox->isChecked();
 
-    // 更新任务状态
-    for (auto &task : m_tasks) {
-        if (task.id() == taskId) {
-            task.setStatus(completed ? TaskStatus::Completed : TaskStatus::Pending);
+    int index = -1;
+    for (int i = 0; i < m_tasks.size(); ++i) {
+        if (m_tasks.at(i).id() == taskId) {
+            index = i;
             break;
         }
     }
+    if (index < 0) return;
+
+    // 已完成的任务取消勾选后重新打开为“进行中”（不允许直接回到“待办”）
+    const TaskStatus oldStatus = m_tasks.at(index).status();
+    const TaskStatus newStatus = completed ? TaskStatus::Completed : TaskStatus::InProgress;
+    bool accepted = oldStatus == newStatus || Task::isValidTransition(oldStatus, newStatus);
+
+    // 经由撤销管理器保存，误点可以撤销
+    if (accepted && m_undoManager) {
+        accepted = m_undoManager->setTaskStatus(taskId, newStatus);
+    }
+
+    // 不允许或保存失败的转换：复选框恢复原状
+    if (!accepted) {
+        checkBox->blockSignals(true);
+        checkBox->setChecked(!completed);
+        checkBox->blockSignals(false);
+        return;
+    }
+
+    // 更新任务状态
+    m_completedCount += (newStatus == TaskStatus::Completed) - (oldStatus == TaskStatus::Completed);
+    m_tasks[index].setStatus(newStatus);
 
     // 更新显示
     updateCountDisplay();
@@ -206,7 +235,7 @@ void SimpleTaskListWidget::onTaskItemDoubleClicked(QListWidgetItem *item)
 {
     if (!item) return;
 
-    QString taskId = item->data(Qt::UserRole).toString();
+    TaskId taskId = item->data(Qt::UserRole).value<TaskId>();
     emit taskDoubleClicked(taskId);
 }
 
@@ -228,7 +257,7 @@ QWidget* SimpleTaskListWidget::createTaskItemWidget(const Task &task)
     QCheckBox *checkBox = new QCheckBox();
     checkBox->setText(task.title());
     checkBox->setChecked(task.status() == TaskStatus::Completed);
-    checkBox->setProperty("taskId", task.id());
+    checkBox->setProperty("taskId", QVariant::fromValue(task.id()));
 
     // 设置已完成任务的样式
     if (task.status() == TaskStatus::Completed) {
@@ -300,24 +329,10 @@ void SimpleTaskListWidget::updateEmptyState()
 
 void SimpleTaskListWidget::applyFilters()
 {
-    for (int i = 0; i < ui->taskListWidget->count(); ++i) {
-        QListWidgetItem *item = ui->taskListWidget->item(i);
-        QString taskId = item->data(Qt::UserRole).toString();
-
-        // 查找对应的任务
-        Task task;
-        bool found = false;
-        for (const Task &t : m_tasks) {
-            if (t.id() == taskId) {
-                task = t;
-                found = true;
-                break;
-            }
-        }
-
-        if (found) {
-            bool visible = isTaskVisible(task);
-            item->setHidden(!visible);
+    for (const Task &task : m_tasks) {
+        QListWidgetItem *item = m_itemMap.value(task.id());
+        if (item) {
+            item->setHidden(!isTaskVisible(task));
         }
     }
 }
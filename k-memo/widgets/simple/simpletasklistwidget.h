@@ -8,12 +8,15 @@
 #include <QHBoxLayout>
 #include <QFrame>
 #include <QLabel>
+#include <QHash>
 #include "../../models/task.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class SimpleTaskListWidget; }
 QT_END_NAMESPACE
 
+class UndoManager;
+
 /**
  * @brief 简化的任务列表组件
  *
@@ -44,7 +47,7 @@ public:
      * @brief 移除任务
      * @param taskId 任务ID
      */
-    void removeTask(const QString &taskId);
+    void removeTask(const TaskId &taskId);
 
     /**
      * @brief 更新任务
@@ -92,25 +95,31 @@ public slots:
      */
     void clearFilters();
 
+    /**
+     * @brief 设置撤销管理器
+     * @param undoManager 设置后勾选框的状态切换经由它保存，可以撤销
+     */
+    void setUndoManager(UndoManager *undoManager) { m_undoManager = undoManager; }
+
 signals:
     /**
      * @brief 任务状态改变信号
      * @param taskId 任务ID
      * @param completed 是否完成
      */
-    void taskStatusChanged(const QString &taskId, bool completed);
+    void taskStatusChanged(const TaskId &taskId, bool completed);
 
     /**
      * @brief 任务被点击信号
      * @param taskId 任务ID
      */
-    void taskClicked(const QString &taskId);
+    void taskClicked(const TaskId &taskId);
 
     /**
      * @brief 任务被双击信号（进入编辑模式）
      * @param taskId 任务ID
      */
-    void taskDoubleClicked(const QString &taskId);
+    void taskDoubleClicked(const TaskId &taskId);
 
     /**
      * @brief 任务数量变化信号
@@ -171,7 +180,9 @@ private:
 private:
     Ui::SimpleTaskListWidget *ui;
     QList<Task> m_tasks;              // 所有任务列表
-    QMap<QString, QListWidgetItem*> m_itemMap;  // 任务ID到列表项的映射
+    QHash<TaskId, QListWidgetItem*> m_itemMap;  // 任务ID到列表项的映射
+    int m_completedCount;             // 已完成任务数，随增删改增量维护
+    UndoManager *m_undoManager;       // 可为空
 
     // 过滤条件
     int m_statusFilter;    // 状态过滤（-1表示不过滤）